@@ -0,0 +1,76 @@
+/*
+* The Sleuth Kit
+*
+* This software is distributed under the Common Public License 1.0
+*/
+
+/*
+ * Checks when the inode index of a BTRFS filesystem tree is built: listing
+ * one directory must use tree searches only, a recursive listing builds
+ * the index, and later listings of one directory print the same entries
+ * from it.
+ *
+ * usage: btrfs_index_test pool_directory
+ */
+#include "tsk/tsk_tools_i.h"
+#include "tsk/pool/TSK_POOL_INFO.h"
+#include "tsk/pool/BTRFS_POOL.h"
+#include "tsk/fs/btrfs/Trees/Trees.h"
+#include "tsk/fs/btrfs/Examiners/Examiners.h"
+
+#include <sstream>
+
+using namespace btrForensics;
+
+static bool
+test(const FilesystemTree *tree)
+{
+    std::ostringstream direct;
+    tree->listDirItemsById(tree->rootDirId, true, true, false, 0, direct);
+    if (tree->hasIndex()) {
+        fprintf(stderr, "Error: listing one directory built the index\n");
+        return false;
+    }
+
+    std::ostringstream recursive;
+    tree->listDirItemsById(tree->rootDirId, true, true, true, 0, recursive);
+    if (!tree->hasIndex()) {
+        fprintf(stderr, "Error: recursive listing did not build the index\n");
+        return false;
+    }
+
+    std::ostringstream indexed;
+    tree->listDirItemsById(tree->rootDirId, true, true, false, 0, indexed);
+    if (indexed.str() != direct.str()) {
+        fprintf(stderr, "Error: listing from the index differs from the tree search\n");
+        return false;
+    }
+
+    printf("%zu inodes indexed, root directory listed the same both ways\n",
+        tree->getIndex()->size());
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s pool_directory\n", argv[0]);
+        return 1;
+    }
+
+    TSK_POOL_INFO *pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[1]);
+    TSK_POOL *pool = pool_info->createPoolObject();
+    BTRFS_POOL *btrfs = dynamic_cast<BTRFS_POOL *>(pool);
+    if (btrfs == nullptr) {
+        fprintf(stderr, "Error: %s is not a BTRFS pool\n", argv[1]);
+        delete pool;
+        delete pool_info;
+        return 1;
+    }
+
+    bool ok = test(btrfs->examiner->fsTree);
+    delete pool;
+    delete pool_info;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+/*
+* The Sleuth Kit
+*
+* This software is distributed under the Common Public License 1.0
+*/
+
+/*
+ * Throughput benchmark for the crc32c() used to verify BTRFS tree nodes.
+ * Checksums a buffer in node sized blocks with the dispatched and the
+ * portable implementation, checks that both agree and prints MB/s.
+ *
+ * usage: crc32c_bench [node_size] [total_MB]
+ */
+#include "tsk/tsk_tools_i.h"
+#include "tsk/utils/Tools.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+typedef uint32_t (*Crc32cFunc)(uint32_t, const uint8_t *, uint64_t);
+
+static double
+run(const char *name, Crc32cFunc func, const std::vector<uint8_t> &buf,
+    size_t nodeSize, uint32_t *result)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t acc = 0;
+    for (size_t off = 0; off + nodeSize <= buf.size(); off += nodeSize)
+        acc ^= func(0, &buf[off], nodeSize);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double mbps = buf.size() / (1024.0 * 1024.0) / elapsed.count();
+    printf("%-10s %10.1f MB/s\n", name, mbps);
+    *result = acc;
+    return mbps;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t nodeSize = 16384;
+    size_t totalMB = 256;
+    if (argc > 1)
+        nodeSize = strtoul(argv[1], NULL, 10);
+    if (argc > 2)
+        totalMB = strtoul(argv[2], NULL, 10);
+    if (nodeSize == 0 || totalMB == 0) {
+        fprintf(stderr, "usage: %s [node_size] [total_MB]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<uint8_t> buf(totalMB * 1024 * 1024);
+    srand(1);
+    for (auto &b : buf)
+        b = (uint8_t) rand();
+
+    printf("node size %zu bytes, %zu MB, hardware crc32: %s\n", nodeSize, totalMB,
+        crc32c_hardware_available() ? "yes" : "no");
+
+    uint32_t dispatched, software;
+    run("crc32c", crc32c, buf, nodeSize, &dispatched);
+    run("software", crc32c_software, buf, nodeSize, &software);
+
+    if (dispatched != software) {
+        fprintf(stderr, "Error: implementations disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+/*
+* The Sleuth Kit
+*
+* This software is distributed under the Common Public License 1.0
+*/
+
+/*
+ * Reads a pool volume through tsk_img_open_pool() and compares the data
+ * with direct reads of the volume: sequential reads in odd sized pieces,
+ * random reads and reads across the end of the volume. Without arguments
+ * an in-memory volume with a failing range is used, which also checks
+ * that read errors reach the caller. Otherwise the volume is opened from
+ * the pool in the given directory, '/' for the address space of the pool.
+ *
+ * usage: pool_img_test [pool_directory volume]
+ */
+#include "tsk/tsk_tools_i.h"
+#include "tsk/pool/TSK_POOL_INFO.h"
+#include "tsk/pool/TSK_POOL_IMG.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/* volume whose bytes are a function of their offset */
+class PatternVolume : public TSK_POOL_VOLUME {
+public:
+    PatternVolume(uint64_t size, uint64_t blockSize, uint64_t badOffset)
+        : size(size), blockSize(blockSize), badOffset(badOffset), reads(0) {}
+
+    uint64_t getSize() const { return size; }
+    uint64_t getBlockSize() const { return blockSize; }
+
+    bool read(uint64_t offset, uint64_t length, char *buffer) {
+        reads++;
+        if (offset <= badOffset && badOffset < offset + length)
+            return false;
+        for (uint64_t i = 0; i < length; i++)
+            buffer[i] = (char) (((offset + i) * 2654435761ULL) >> 13);
+        return true;
+    }
+
+    uint64_t size;
+    uint64_t blockSize;
+    uint64_t badOffset;
+    uint64_t reads;
+};
+
+class PatternPool : public TSK_POOL {
+public:
+    PatternPool(uint64_t badOffset) : badOffset(badOffset) {}
+
+    void fsstat(string, int) {}
+    void fls(string, int) {}
+    void istat(int, string, int) {}
+    void icat(int, string, int) {}
+    void print(std::ostream &os) const { os << "pattern pool" << endl; }
+
+    TSK_POOL_VOLUME *openVolume(string, int) {
+        return new PatternVolume(37 * 1024 * 1024 + 1234, 128 * 1024, badOffset);
+    }
+
+    uint64_t badOffset;
+};
+
+static bool
+compare(TSK_IMG_INFO *img, TSK_POOL_VOLUME *volume, TSK_OFF_T offset, size_t length)
+{
+    std::vector<char> viaImage(length), direct(length);
+    ssize_t read = tsk_img_read(img, offset, viaImage.data(), length);
+    size_t expected = (size_t) std::min<uint64_t>(length, volume->getSize() - offset);
+    if (read != (ssize_t) expected) {
+        fprintf(stderr, "Error: read of %zu at %" PRIdOFF " returned %zd, expected %zu\n", length, offset,
+            read, expected);
+        return false;
+    }
+    if (!volume->read(offset, expected, direct.data())) {
+        fprintf(stderr, "Error: direct read of %zu at %" PRIdOFF " failed\n", expected, offset);
+        return false;
+    }
+    if (memcmp(viaImage.data(), direct.data(), expected) != 0) {
+        fprintf(stderr, "Error: data of %zu at %" PRIdOFF " differs\n", expected, offset);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Compare reads through the image with direct reads. Reads near the cache
+ * block that holds badOffset are skipped, that block cannot be read.
+ */
+static bool
+test(TSK_POOL *pool, const std::string &volumeName, uint64_t badOffset)
+{
+    TSK_IMG_INFO *img = tsk_img_open_pool(pool, volumeName, -1, 16 * 1024 * 1024);
+    if (img == NULL) {
+        tsk_error_print(stderr);
+        return false;
+    }
+    TSK_POOL_VOLUME *volume = pool->openVolume(volumeName, -1);
+    uint64_t size = volume->getSize();
+    uint64_t blockSize = ((IMG_POOL_INFO *) img)->cache->getBlockSize();
+    /* small reads are widened to TSK_IMG_INFO_CACHE_LEN by tsk_img_read */
+    uint64_t skipStart = 0, skipEnd = 0;
+    if (badOffset < size) {
+        skipStart = badOffset - badOffset % blockSize;
+        skipEnd = skipStart + blockSize;
+        skipStart = skipStart > TSK_IMG_INFO_CACHE_LEN ? skipStart - TSK_IMG_INFO_CACHE_LEN : 0;
+    }
+    bool ok = ((uint64_t) img->size == size);
+    if (!ok)
+        fprintf(stderr, "Error: image size %" PRIdOFF " differs from volume size %" PRIu64 "\n", img->size, size);
+
+    /* sequential pieces that do not line up with cache blocks */
+    uint64_t limit = std::min<uint64_t>(size, 64 * 1024 * 1024);
+    for (uint64_t offset = 0; ok && offset < limit; offset += 100003) {
+        if (offset < skipEnd && skipStart < offset + 100003)
+            continue;
+        ok = compare(img, volume, offset, 100003);
+    }
+
+    srand(1);
+    for (int i = 0; ok && i < 2000; i++) {
+        uint64_t offset = ((uint64_t) rand() * RAND_MAX + rand()) % size;
+        size_t length = 1 + rand() % 70000;
+        if (offset < skipEnd && skipStart < offset + length)
+            continue;
+        ok = compare(img, volume, offset, length);
+    }
+
+    /* across the end */
+    if (ok && size > 4096 && skipEnd <= size - 4096)
+        ok = compare(img, volume, size - 4096, 8192);
+
+    if (ok)
+        printf("%" PRIu64 " bytes compared, cache block size %" PRIu64 "\n", size, blockSize);
+
+    delete volume;
+    img->close(img);
+    return ok;
+}
+
+static bool
+testErrors()
+{
+    const uint64_t badOffset = 20 * 1024 * 1024 + 7;
+    PatternPool pool(badOffset);
+    if (!test(&pool, "", badOffset))
+        return false;
+
+    TSK_IMG_INFO *img = tsk_img_open_pool(&pool, "", -1, 16 * 1024 * 1024);
+    if (img == NULL) {
+        tsk_error_print(stderr);
+        return false;
+    }
+    char buffer[512];
+    ssize_t read = tsk_img_read(img, badOffset - 100, buffer, sizeof(buffer));
+    img->close(img);
+    if (read != -1) {
+        fprintf(stderr, "Error: read of a failing range returned %zd\n", read);
+        return false;
+    }
+    printf("failing range reported as read error\n");
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc == 1)
+        return testErrors() ? 0 : 1;
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s [pool_directory volume]\n", argv[0]);
+        return 1;
+    }
+
+    TSK_POOL_INFO *pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[1]);
+    TSK_POOL *pool = pool_info->createPoolObject();
+    if (pool == nullptr) {
+        delete pool_info;
+        return 1;
+    }
+    std::string volume = argv[2];
+    if (volume == "/")
+        volume = "";
+    bool ok = test(pool, volume, UINT64_MAX);
+    delete pool;
+    delete pool_info;
+    return ok ? 0 : 1;
+}
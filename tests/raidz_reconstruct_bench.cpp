@@ -0,0 +1,119 @@
+/*
+* The Sleuth Kit
+*
+* This software is distributed under the Common Public License 1.0
+*/
+
+/*
+ * Throughput benchmark for the in-memory part of reading RAIDZ rows.
+ * Compares assembling a row from healthy data columns with rebuilding one,
+ * two and three missing data columns from P, Q and R parity, checks the
+ * rebuilt data and prints MB/s of logical data. Columns are not read from
+ * devices, so the concurrent per-child reads are not part of the numbers.
+ *
+ * usage: raidz_reconstruct_bench [data_columns] [column_KB] [total_MB]
+ */
+#include "tsk/tsk_tools_i.h"
+#include "tsk/pool/RAIDZ.h"
+#include "tsk/utils/GF256.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef std::vector<std::vector<char>> Row;
+
+static void
+assemble(const Row &row, uint64_t nparity, std::vector<char> &out)
+{
+    out.resize(0);
+    for (size_t c = nparity; c < row.size(); c++)
+        out.insert(out.end(), row[c].begin(), row[c].end());
+}
+
+static bool
+run(const char *name, const Row &original, uint64_t nparity, uint64_t missing, size_t rows)
+{
+    Row row(original);
+    std::vector<bool> present(row.size(), true);
+    for (uint64_t m = 0; m < missing; m++)
+        present[nparity + m] = false;
+
+    std::vector<char> expected, out;
+    assemble(original, nparity, expected);
+
+    double seconds = 0;
+    for (size_t i = 0; i < rows; i++) {
+        for (uint64_t m = 0; m < missing; m++)
+            memset(row[nparity + m].data(), 0, row[nparity + m].size());
+
+        auto start = std::chrono::steady_clock::now();
+        if (!raidzReconstruct(row, nparity, present)) {
+            fprintf(stderr, "Error: %s could not be rebuilt\n", name);
+            return false;
+        }
+        assemble(row, nparity, out);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        seconds += elapsed.count();
+    }
+
+    if (out != expected) {
+        fprintf(stderr, "Error: %s rebuilt wrong data\n", name);
+        return false;
+    }
+    printf("%-26s %10.1f MB/s\n", name, expected.size() * rows / (1024.0 * 1024.0) / seconds);
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    size_t dataColumns = 8;
+    size_t columnKB = 16;
+    size_t totalMB = 512;
+    if (argc > 1)
+        dataColumns = strtoul(argv[1], NULL, 10);
+    if (argc > 2)
+        columnKB = strtoul(argv[2], NULL, 10);
+    if (argc > 3)
+        totalMB = strtoul(argv[3], NULL, 10);
+    if (dataColumns < 3 || columnKB == 0 || totalMB == 0) {
+        fprintf(stderr, "usage: %s [data_columns >= 3] [column_KB] [total_MB]\n", argv[0]);
+        return 1;
+    }
+
+    //the last data column is one sector short, as in rows that do not fill all columns
+    const uint64_t nparity = 3;
+    Row row(nparity + dataColumns);
+    srand(1);
+    for (size_t c = 0; c < row.size(); c++) {
+        size_t size = columnKB * 1024;
+        if (c == row.size() - 1)
+            size -= 512;
+        row[c].resize(size);
+        if (c >= nparity) {
+            for (auto &b : row[c])
+                b = (char) rand();
+        }
+    }
+    raidzGenerateParity(row, nparity);
+
+    size_t rows = totalMB * 1024 / (columnKB * dataColumns);
+    if (rows == 0)
+        rows = 1;
+    printf("%zu data columns of %zu KB, %zu rows, kernels: %s\n", dataColumns, columnKB, rows,
+        gf256_implementation());
+
+    //parity columns are only used for rebuilding, dropping R and Q gives RAIDZ2 and RAIDZ1 rows
+    Row raidz1(row);
+    raidz1.erase(raidz1.begin() + 1, raidz1.begin() + 3);
+    Row raidz2(row);
+    raidz2.erase(raidz2.begin() + 2);
+
+    bool ok = run("healthy, assemble only", row, nparity, 0, rows)
+        && run("raidz1, 1 missing (P)", raidz1, 1, 1, rows)
+        && run("raidz2, 2 missing (PQ)", raidz2, 2, 2, rows)
+        && run("raidz3, 3 missing (PQR)", row, nparity, 3, rows);
+    return ok ? 0 : 1;
+}
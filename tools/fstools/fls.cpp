@@ -24,6 +24,7 @@
 #include <time.h>
 #include "tsk/pool/TSK_POOL_INFO.h"
 #include "tsk/pool/ZFS_POOL.h"
+#include "tsk/pool/TSK_POOL_IMG.h"
 
 static TSK_TCHAR *progname;
 
@@ -33,7 +34,7 @@ usage()
     TFPRINTF(stderr,
         _TSK_T
         ("usage: %s [-adDFlpruvV] [-f fstype] [-i imgtype] [-b dev_sector_size] [-m dir/] [-o imgoffset] [-z ZONE] "
-                 "[-s seconds] [-P] [-S sub_file_system] [-T transaction] image [images] [inode]\n"),
+                 "[-s seconds] [-P] [-S sub_file_system] [-c sub_file_system] [-T transaction] [-Z volume] image [images] [inode]\n"),
         progname);
     tsk_fprintf(stderr,
         "\tIf [inode] is not given, the root directory is used\n");
@@ -62,7 +63,11 @@ usage()
                 "\t-S: Specify sub file system (only used for pools)\n");
     tsk_fprintf(stderr,
                 "\t-T: Specify transaction or generation number to use\n");
+    tsk_fprintf(stderr,
+                "\t-c sub_fs: List only inodes changed between -S and this sub file system (only used for pools)\n");
     tsk_fprintf(stderr, "\t-r: Recurse on directory entries\n");
+    tsk_fprintf(stderr,
+                "\t-Z volume: Analyze the file system in a volume of a pool, e.g. a zvol, use '/' for the address space of the pool (expect directory of pool members as input)\n");
     tsk_fprintf(stderr, "\t-u: Display undeleted entries only\n");
     tsk_fprintf(stderr, "\t-v: verbose output to stderr\n");
     tsk_fprintf(stderr, "\t-V: Print version\n");
@@ -78,8 +83,9 @@ int
 main(int argc, char **argv1)
 {
     TSK_IMG_TYPE_ENUM imgtype = TSK_IMG_TYPE_DETECT;
-    TSK_IMG_INFO *img;
-    TSK_POOL_INFO *pool_info;
+    TSK_IMG_INFO *img = NULL;
+    TSK_POOL_INFO *pool_info = NULL;
+    TSK_POOL *pool = NULL;
 
     TSK_OFF_T imgaddr = 0;
     TSK_FS_TYPE_ENUM fstype = TSK_FS_TYPE_DETECT;
@@ -92,7 +98,11 @@ main(int argc, char **argv1)
     int fls_flags;
     int transaction = -1;
     string sub_file_system = "";
+    string compare_file_system = "";
+    bool isCompare = false;
     bool isPool = false;
+    bool isPoolVolume = false;
+    string pool_volume = "";
     int32_t sec_skew = 0;
     static TSK_TCHAR *macpre = NULL;
     TSK_TCHAR **argv;
@@ -116,7 +126,7 @@ main(int argc, char **argv1)
     fls_flags = TSK_FS_FLS_DIR | TSK_FS_FLS_FILE;
 
     while ((ch =
-            GETOPT(argc, argv, _TSK_T("ab:dDf:Fi:m:lo:Pprs:S:T:uvVz:"))) > 0) {
+            GETOPT(argc, argv, _TSK_T("ab:c:dDf:Fi:m:lo:Pprs:S:T:uvVz:Z:"))) > 0) {
         switch (ch) {
         case _TSK_T('?'):
         default:
@@ -136,6 +146,10 @@ main(int argc, char **argv1)
                 usage();
             }
             break;
+        case _TSK_T('c'):
+            compare_file_system = OPTARG;
+            isCompare = true;
+            break;
         case _TSK_T('d'):
             name_flags &= ~TSK_FS_DIR_WALK_FLAG_ALLOC;
             break;
@@ -227,6 +241,12 @@ main(int argc, char **argv1)
                 TZSET();
             }
             break;
+        case _TSK_T('Z'):
+            isPoolVolume = true;
+            pool_volume = OPTARG;
+            if (pool_volume == "/")
+                pool_volume = "";
+            break;
 
         }
     }
@@ -237,12 +257,34 @@ main(int argc, char **argv1)
         usage();
     }
 
-    if(isPool){
+    if (isPoolVolume) {
+        /* the volume is read through the image cache of the pool, an inode
+         * address may still follow the pool directory */
+        pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[OPTIND]);
+        pool = pool_info->createPoolObject();
+        if (pool == nullptr) {
+            delete pool_info;
+            exit(1);
+        }
+        if ((img = tsk_img_open_pool(pool, pool_volume, transaction)) == NULL) {
+            tsk_error_print(stderr);
+            exit(1);
+        }
+    }
+
+    if(isPool && !isPoolVolume){
         pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[OPTIND]);
-        TSK_POOL* pool = pool_info->createPoolObject();
+        pool = pool_info->createPoolObject();
+        if (pool == nullptr) {
+            delete pool_info;
+            exit(1);
+        }
 
         try {
-            pool->fls(sub_file_system, transaction);
+            if (isCompare)
+                pool->diff(sub_file_system, compare_file_system, transaction);
+            else
+                pool->fls(sub_file_system, transaction);
 
         }
         catch (...) {
@@ -286,7 +328,7 @@ main(int argc, char **argv1)
          */
         if (tsk_fs_parse_inum(argv[argc - 1], &inode, NULL, NULL, NULL, NULL)) {
             /* Not an inode at the end */
-            if ((img =
+            if (img == NULL && (img =
                          tsk_img_open(argc - OPTIND, &argv[OPTIND],
                                       imgtype, ssize)) == NULL) {
                 tsk_error_print(stderr);
@@ -315,7 +357,7 @@ main(int argc, char **argv1)
                 usage();
             }
 
-            if ((img =
+            if (img == NULL && (img =
                          tsk_img_open(argc - OPTIND - 1, &argv[OPTIND],
                                       imgtype, ssize)) == NULL) {
                 tsk_error_print(stderr);
@@ -351,5 +393,7 @@ main(int argc, char **argv1)
         img->close(img);
     }
 
+    delete pool;
+    delete pool_info;
     exit(0);
 }
@@ -25,6 +25,7 @@
 #include <locale.h>
 #include "tsk/pool/TSK_POOL_INFO.h"
 #include "tsk/pool/ZFS_POOL.h"
+#include "tsk/pool/TSK_POOL_IMG.h"
 
 /* usage - explain and terminate */
 
@@ -36,7 +37,7 @@ usage()
     TFPRINTF(stderr,
         _TSK_T
         ("usage: %s [-hrRsvV] [-f fstype] [-i imgtype] [-b dev_sector_size] [-o imgoffset] [-P] [-S sub_file_system]"
-                 "[-T transaction] image [images] inum[-typ[-id]]\n"),
+                 "[-T transaction] [-Z volume] image [images] inum[-typ[-id]]\n"),
         progname);
     tsk_fprintf(stderr, "\t-h: Do not display holes in sparse files\n");
     tsk_fprintf(stderr, "\t-r: Recover deleted file\n");
@@ -57,6 +58,8 @@ usage()
                 "\t-P: Analyze as pool (expect directory of pool members as input)\n");
     tsk_fprintf(stderr,
                 "\t-T: Specify transaction or generation number to use\n");
+    tsk_fprintf(stderr,
+                "\t-Z volume: Read the file system in a volume of a pool, e.g. a zvol, use '/' for the address space of the pool (expect directory of pool members as input)\n");
     tsk_fprintf(stderr, "\t-v: verbose to stderr\n");
     tsk_fprintf(stderr, "\t-V: Print version\n");
 
@@ -67,8 +70,9 @@ int
 main(int argc, char **argv1)
 {
     TSK_IMG_TYPE_ENUM imgtype = TSK_IMG_TYPE_DETECT;
-    TSK_IMG_INFO *img;
-    TSK_POOL_INFO *pool_info;
+    TSK_IMG_INFO *img = NULL;
+    TSK_POOL_INFO *pool_info = NULL;
+    TSK_POOL *pool = NULL;
 
     TSK_OFF_T imgaddr = 0;
     TSK_FS_TYPE_ENUM fstype = TSK_FS_TYPE_DETECT;
@@ -82,6 +86,8 @@ main(int argc, char **argv1)
     uint8_t id_used = 0, type_used = 0;
     int retval;
     bool isPool = false;
+    bool isPoolVolume = false;
+    string pool_volume = "";
     string sub_file_system = "";
     int transaction = -1;
     int suppress_recover_error = 0;
@@ -103,7 +109,7 @@ main(int argc, char **argv1)
     progname = argv[0];
     setlocale(LC_ALL, "");
 
-    while ((ch = GETOPT(argc, argv, _TSK_T("b:f:F:hi:o:PrR:S:sT:vV"))) > 0) {
+    while ((ch = GETOPT(argc, argv, _TSK_T("b:f:F:hi:o:PrR:S:sT:vVZ:"))) > 0) {
         switch (ch) {
         case _TSK_T('?'):
         default:
@@ -177,6 +183,12 @@ main(int argc, char **argv1)
         case _TSK_T('V'):
             tsk_version_print(stdout);
             exit(0);
+        case _TSK_T('Z'):
+            isPoolVolume = true;
+            pool_volume = OPTARG;
+            if (pool_volume == "/")
+                pool_volume = "";
+            break;
         }
     }
 
@@ -186,9 +198,27 @@ main(int argc, char **argv1)
         usage();
     }
 
-    if(isPool){
+    if (isPoolVolume) {
+        /* the volume is read through the image cache of the pool */
+        pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[OPTIND]);
+        pool = pool_info->createPoolObject();
+        if (pool == nullptr) {
+            delete pool_info;
+            exit(1);
+        }
+        if ((img = tsk_img_open_pool(pool, pool_volume, transaction)) == NULL) {
+            tsk_error_print(stderr);
+            exit(1);
+        }
+    }
+
+    if(isPool && !isPoolVolume){
         pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[OPTIND]);
-        TSK_POOL* pool = pool_info->createPoolObject();
+        pool = pool_info->createPoolObject();
+        if (pool == nullptr) {
+            delete pool_info;
+            exit(1);
+        }
         try {
             if (OPTIND + 1 < argc) {
                 pool->icat(stoi(argv[OPTIND + 1]), sub_file_system, transaction);
@@ -210,7 +240,7 @@ main(int argc, char **argv1)
             usage();
         }
 
-        if ((img =
+        if (img == NULL && (img =
                      tsk_img_open(argc - OPTIND - 1, &argv[OPTIND],
                                   imgtype, ssize)) == NULL) {
             tsk_error_print(stderr);
@@ -265,5 +295,7 @@ main(int argc, char **argv1)
         img->close(img);
     }
 
+    delete pool;
+    delete pool_info;
     exit(0);
 }
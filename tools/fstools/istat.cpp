@@ -203,6 +203,10 @@ main(int argc, char **argv1)
     if(isPool){
         pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[OPTIND]);
         TSK_POOL* pool = pool_info->createPoolObject();
+        if (pool == nullptr) {
+            delete pool_info;
+            exit(1);
+        }
 
         try {
             if (OPTIND + 1 < argc) {
@@ -33,13 +33,27 @@
 static TSK_TCHAR *progname;
 
 void usage() {
-    TFPRINTF(stderr, _TSK_T ("usage: %s images\n"), progname);
+    TFPRINTF(stderr, _TSK_T ("usage: %s [-Hsv] [-S dataset] [-T transaction] images\n"), progname);
+    tsk_fprintf(stderr,
+                "\t-H: Hash all files of all datasets and snapshots, reading shared blocks once\n");
+    tsk_fprintf(stderr,
+                "\t-S dataset: Hash only this dataset or subvolume and its snapshots, or a single snapshot\n");
+    tsk_fprintf(stderr,
+                "\t-s: Scrub: verify the checksums of all blocks and report damaged copies\n");
+    tsk_fprintf(stderr,
+                "\t-T: Specify transaction or generation number to use\n");
+    tsk_fprintf(stderr, "\t-v: verbose output to stderr\n");
+    tsk_fprintf(stderr, "\t-V: Print version\n");
     exit(1);
 }
 
 int main(int argc, char **argv1) {
     TSK_POOL_INFO *pool_info;
-    extern int OPTIND;
+    int ch;
+    bool scrub = false;
+    bool hash = false;
+    string dataset = "";
+    int transaction = -1;
     static TSK_TCHAR *macpre = NULL;
     TSK_TCHAR **argv;
     unsigned int ssize = 0;
@@ -58,17 +72,67 @@ int main(int argc, char **argv1) {
     progname = argv[0];
     setlocale(LC_ALL, "");
 
+    while ((ch = GETOPT(argc, argv, _TSK_T("HsS:T:vV"))) > 0) {
+        switch (ch) {
+        case _TSK_T('?'):
+        default:
+            TFPRINTF(stderr, _TSK_T("Invalid argument: %s\n"),
+                argv[OPTIND]);
+            usage();
+        case _TSK_T('H'):
+            hash = true;
+            break;
+        case _TSK_T('s'):
+            scrub = true;
+            break;
+        case _TSK_T('S'):
+            dataset = OPTARG;
+            break;
+        case _TSK_T('T'):
+            transaction = TATOI(OPTARG);
+            break;
+        case _TSK_T('v'):
+            tsk_verbose++;
+            break;
+        case _TSK_T('V'):
+            tsk_version_print(stdout);
+            exit(0);
+        }
+    }
+
     /* We need at least one more argument */
-    if (OPTIND == argc) {
+    if (OPTIND >= argc) {
         tsk_fprintf(stderr, "Missing path to directory containing images\n");
         usage();
     }
     //TODO: analyze only single device!!!
-    pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[1]);
+    pool_info = new TSK_POOL_INFO(TSK_LIT_ENDIAN, argv[OPTIND]);
     TSK_POOL* pool = pool_info->createPoolObject();
+    if (pool == nullptr) {
+        delete pool_info;
+        exit(1);
+    }
     cout << *pool << endl;
     //cout << *pool->getUberblockArray() << endl;
 
+    if (scrub) {
+        try {
+            pool->scrub(transaction);
+        }
+        catch (...) {
+            cerr << "Scrub failed. Used an older uberblock?" << endl;
+        }
+    }
+
+    if (hash) {
+        try {
+            pool->hash(dataset, transaction);
+        }
+        catch (...) {
+            cerr << "Hashing failed. Used an older uberblock?" << endl;
+        }
+    }
+
     delete pool;
     delete pool_info;
 
@@ -40,11 +40,14 @@ namespace btrForensics{
         //! Return true if the header indicates it is a leaf node.
         const bool isLeafNode() const { return level == 0; }
         const uint64_t getGeneration() const {return generation;};
+        const uint64_t getLogicalAddr() const { return address; } //!< Return logical address of the node.
+        const uint8_t getLevel() const { return level; } //!< Return level of the node, 0 for leaves.
         
         friend std::ostream &operator<<(
             std::ostream &os, const BtrfsHeader &header);
 
         static const int SIZE_OF_HEADER = 0x65; //!< Size of node header in bytes.
+        static const int SIZE_OF_CSUM = 0x20; //!< Size of checksum field at start of a node.
     };
 
 }
@@ -21,6 +21,7 @@ namespace btrForensics{
         arIndex += 8;
 
         uint8_t type = arr[arIndex++];
+        typeCode = type;
 
         offset = read64Bit(endian, arr + arIndex);
 
@@ -107,6 +108,34 @@ namespace btrForensics{
 
 
 
+    //! Constructor of key, used to build search keys.
+    //!
+    //! \param objId Object id.
+    //! \param type Item type.
+    //! \param offset Offset, meaning depends on the item type.
+    //!
+    BtrfsKey::BtrfsKey(uint64_t objId, ItemType type, uint64_t offset)
+        :objId(objId), itemType(type), offset(offset), typeCode((uint8_t)type) {}
+
+
+    //! Compare two keys in tree order.
+    //!
+    //! \param other Key to compare with.
+    //! \return Negative, zero or positive if this key is less than,
+    //!         equal to or greater than the other one.
+    //!
+    int BtrfsKey::compare(const BtrfsKey& other) const
+    {
+        if(objId != other.objId)
+            return objId < other.objId ? -1 : 1;
+        if(typeCode != other.typeCode)
+            return typeCode < other.typeCode ? -1 : 1;
+        if(offset != other.offset)
+            return offset < other.offset ? -1 : 1;
+        return 0;
+    }
+
+
     //! Overloaded stream operator.
     std::ostream &operator<<(std::ostream &os, const BtrfsKey &key)
     {
@@ -115,6 +144,8 @@ namespace btrForensics{
         os << " (0x" << key.objId << ")\n";
         os << "Key - Item type: " << key.getItemTypeStr() << '\n';
         os << "Key - Offset: 0x" << key.offset << '\n';
+
+        return os;
     }
 
 
@@ -20,10 +20,24 @@ namespace btrForensics{
         uint64_t offset; //!< The meaning depends on the item type.
 
         //Total bytes: 0x11
+    private:
+        uint8_t typeCode; //!< Item type as stored on disk, kept for unknown types.
+
     public:
         BtrfsKey(TSK_ENDIAN_ENUM endian, uint8_t arr[]);
+        BtrfsKey(uint64_t objId, ItemType type, uint64_t offset);
         ~BtrfsKey() = default; //!< Destructor
 
+        int compare(const BtrfsKey& other) const;
+
+        //! Keys are ordered by object id, item type and offset.
+        bool operator<(const BtrfsKey& other) const { return compare(other) < 0; }
+        bool operator<=(const BtrfsKey& other) const { return compare(other) <= 0; }
+        bool operator>(const BtrfsKey& other) const { return compare(other) > 0; }
+        bool operator>=(const BtrfsKey& other) const { return compare(other) >= 0; }
+        bool operator==(const BtrfsKey& other) const { return compare(other) == 0; }
+        bool operator!=(const BtrfsKey& other) const { return compare(other) != 0; }
+
         friend std::ostream &operator<<(
             std::ostream &os, const BtrfsKey &key);
 
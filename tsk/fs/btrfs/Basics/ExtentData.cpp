@@ -15,7 +15,8 @@ namespace btrForensics {
     //! \param address Physical address of current Btrfs item data part.
     //!
     ExtentData::ExtentData(ItemHead* head, TSK_ENDIAN_ENUM endian, uint8_t arr[], uint64_t address)
-        :BtrfsItem(head)
+        :BtrfsItem(head), dataAddress(0), logicalAddress(0), extentSize(0),
+        extentOffset(0), numOfBytes(0)
     {
         int arIndex(0);
 
@@ -34,6 +35,7 @@ namespace btrForensics {
 
         if(type == 0) {
             dataAddress = address + PART_ONE_SIZE;
+            extentSize = head->getDataSize() - PART_ONE_SIZE;
         }
         else {
             logicalAddress = read64Bit(endian, arr + arIndex);
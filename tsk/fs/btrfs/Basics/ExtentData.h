@@ -24,7 +24,7 @@ namespace btrForensics {
         uint8_t type; //!< 0 if inline.
 
         uint64_t logicalAddress; //!< Logical address of extent for non-inline file.
-        uint64_t extentSize; //!< Size of extent for non-inline file.
+        uint64_t extentSize; //!< Size of extent on disk, size of inline data for inline file.
         uint64_t extentOffset; //!< Offset within extent for non-inline file.
         uint64_t numOfBytes; //!< Logical number of bytes in extent for non-inline file.
 
@@ -68,6 +68,17 @@ namespace btrForensics{
 
     }
 
+    //! Print time info.
+    std::string InodeData::printTime() const
+    {
+        std::stringstream oss;
+        oss << "Created time:  " << std::asctime(std::localtime(&createdTime));
+        oss << "Access time:   " << std::asctime(std::localtime(&accessTime));
+        oss << "Modified time: " << std::asctime(std::localtime(&modifiedTime));
+        return oss.str();
+    }
+
+
     //! Return infomation about the item data as string.
     std::string InodeData::dataInfo() const
     {
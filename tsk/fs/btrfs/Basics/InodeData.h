@@ -43,6 +43,7 @@ namespace btrForensics{
         //! Get size of the file.
         uint64_t getSize() const { return stSize; }
 
+        std::string printTime() const;
         std::string dataInfo() const ;
         
         static const int SIZE_OF_INODE_DATA= 0xa0; //!< Size of an inode in bytes.
@@ -24,11 +24,7 @@ namespace btrForensics{
     //! Print time info.
     std::string InodeItem::printTime() const
     {
-        std::stringstream oss;
-        oss << "Created time:  " << std::asctime(std::localtime(&data.createdTime));
-        oss << "Access time:   " << std::asctime(std::localtime(&data.accessTime));
-        oss << "Modified time: " << std::asctime(std::localtime(&data.modifiedTime));
-        return oss.str();
+        return data.printTime();
     }
     
 
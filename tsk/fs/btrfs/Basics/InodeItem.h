@@ -27,6 +27,9 @@ namespace btrForensics{
         //! Get size of the file.
         uint64_t getSize() const { return data.getSize(); }
 
+        //! Get the decoded inode data.
+        const InodeData& getData() const { return data; }
+
         std::string dataInfo() const override;
     };
 }
@@ -10,18 +10,12 @@
 #include <string>
 #include <tsk/libtsk.h>
 #include "BtrfsKey.h"
-//#include "Trees/BtrfsNode.h"
-
-class BTRFS_POOL;
 
 namespace btrForensics{
-    class BtrfsNode;
-
     //! Key pointers stored in internal nodes, stored right after node header.
     class KeyPtr{
     public:
         const BtrfsKey key; //!< Key of the key pointer.
-        const BtrfsNode* childNode; //!< Pointer to the child node pointed by this key pointer.
     private:
         uint64_t blkNum;
         uint64_t generation;
@@ -29,11 +23,11 @@ namespace btrForensics{
         //Total bytes: 0x21
 
     public:
-        KeyPtr(BTRFS_POOL *pool, TSK_ENDIAN_ENUM endian, uint8_t arr[], bool = false);
-        ~KeyPtr();
+        KeyPtr(TSK_ENDIAN_ENUM endian, uint8_t arr[]);
+        ~KeyPtr() = default; //!< Destructor
 
         const uint64_t getBlkNum() const { return blkNum; }  //!< Return block number.
-        const uint32_t getGeneration() const { return generation; }  //!< Return generation.
+        const uint64_t getGeneration() const { return generation; }  //!< Return generation.
 
         friend std::ostream &operator<<(
             std::ostream &os, const KeyPtr &keyPtr);
@@ -6,6 +6,8 @@
 
 #include "../Trees/Trees.h"
 
+#include "NodeCache.h"
+#include "ExtentDecoder.h"
 #include "TreeExaminer.h"
 #include "Functions.h"
 
@@ -0,0 +1,276 @@
+//! \file
+//! \author Shujian Yang
+//!
+//! Implementation of class ExtentDecoder.
+
+#include <algorithm>
+#include <functional>
+#include "tsk/tsk_config.h"
+#include "ExtentDecoder.h"
+#include "../Trees/SuperBlock.h"
+#include "../../../pool/BTRFS_POOL.h"
+#include "../../../utils/Decompress.h"
+#include "../../../utils/ReadInt.h"
+#include "../../../utils/ThreadPool.h"
+
+namespace btrForensics {
+    const uint64_t ExtentDecoder::DEFAULT_CAPACITY;
+    const uint8_t ExtentDecoder::COMPRESS_ZLIB;
+    const uint8_t ExtentDecoder::COMPRESS_LZO;
+    const uint8_t ExtentDecoder::COMPRESS_ZSTD;
+    const uint64_t ExtentDecoder::MAX_EXTENT_SIZE;
+
+    //! Constructor of extent decoder.
+    //!
+    //! \param pool Pool compressed data is read from.
+    //! \param capacity Maximum decoded bytes held by the cache.
+    //!
+    ExtentDecoder::ExtentDecoder(BTRFS_POOL* pool, uint64_t capacity)
+        :pool(pool), capacity(capacity), usedBytes(0),
+        hits(0), misses(0), evictions(0)
+    {
+        sectorSize = pool->getSuperblock()->getSectorSize();
+        if(sectorSize == 0)
+            sectorSize = 4096;
+    }
+
+
+    //! Check if extents with a compression algorithm can be decoded.
+    //!
+    //! \param compression Compression field of the extent, 0 for none.
+    //!
+    bool ExtentDecoder::isSupported(uint8_t compression)
+    {
+        switch(compression) {
+            case 0:
+            case COMPRESS_LZO:
+                return true;
+            case COMPRESS_ZLIB:
+#ifdef HAVE_LIBZ
+                return true;
+#else
+                return false;
+#endif
+            case COMPRESS_ZSTD:
+#ifdef HAVE_LIBZSTD
+                return true;
+#else
+                return false;
+#endif
+            default:
+                return false;
+        }
+    }
+
+
+    //! Get the decoded content of an extent, decompressing it on a miss.
+    //!
+    //! \param request Location and encoding of the extent.
+    //! \return Decoded content, nullptr if the data is corrupt or unsupported.
+    //!
+    ExtentDecoder::DecodedExtent ExtentDecoder::decode(const Request& request)
+    {
+        {
+            std::lock_guard<std::mutex> guard(cacheLock);
+            auto found = entries.find(request.address);
+            if(found != entries.end()) {
+                ++hits;
+                lruList.splice(lruList.begin(), lruList, found->second);
+                return found->second->data;
+            }
+            ++misses;
+        }
+
+        //Decompress outside the lock so other extents are decoded concurrently.
+        DecodedExtent data(decompress(request));
+        if(data == nullptr)
+            return data;
+
+        std::lock_guard<std::mutex> guard(cacheLock);
+        auto found = entries.find(request.address);
+        if(found != entries.end()) //Another thread decoded it meanwhile.
+            return found->second->data;
+
+        lruList.push_front(Entry{request.address, data});
+        entries[request.address] = lruList.begin();
+        usedBytes += data->size();
+        evict();
+
+        return data;
+    }
+
+
+    //! Decode several extents in parallel on the shared worker pool.
+    //!
+    //! Must not be called from a task running on the shared pool.
+    //!
+    //! \param requests Extents to decode.
+    //! \return Decoded contents in the order of the requests.
+    //!
+    std::vector<ExtentDecoder::DecodedExtent> ExtentDecoder::decodeAll(const std::vector<Request>& requests)
+    {
+        std::vector<DecodedExtent> results(requests.size());
+        if(requests.size() == 1) {
+            results[0] = decode(requests[0]);
+            return results;
+        }
+
+        std::vector<std::future<void>> pending;
+        for(size_t i = 0; i < requests.size(); ++i) {
+            pending.push_back(ThreadPool::shared().submit(
+                [this, &requests, &results, i]() { results[i] = decode(requests[i]); }));
+        }
+        ThreadPool::waitAll(pending);
+
+        return results;
+    }
+
+
+    //! Read and decompress one extent.
+    //!
+    //! \param request Location and encoding of the extent.
+    //! \return Decoded content, nullptr if the data is corrupt or unsupported.
+    //!
+    ExtentDecoder::DecodedExtent ExtentDecoder::decompress(const Request& request) const
+    {
+        if(request.diskSize > MAX_EXTENT_SIZE || request.decodedSize > MAX_EXTENT_SIZE)
+            return nullptr;
+
+        std::vector<char> compressed;
+        pool->readData(request.address, request.diskSize, compressed);
+
+        const uint8_t* src = (const uint8_t*)compressed.data();
+        std::shared_ptr<std::vector<char>> data = std::make_shared<std::vector<char>>(request.decodedSize);
+        uint8_t* dst = (uint8_t*)data->data();
+        size_t produced(0);
+        bool success(false);
+
+        switch(request.compression) {
+            case COMPRESS_ZLIB:
+                success = zlibDecompress(src, request.diskSize, dst, request.decodedSize, &produced);
+                break;
+            case COMPRESS_LZO:
+                success = decodeLzo(src, request.diskSize, dst, request.decodedSize);
+                produced = request.decodedSize;
+                break;
+            case COMPRESS_ZSTD:
+                success = zstdDecompress(src, request.diskSize, dst, request.decodedSize, &produced);
+                break;
+        }
+        if(!success)
+            return nullptr;
+
+        //Streams may end early when the tail of the extent is zeros.
+        if(produced < request.decodedSize)
+            std::fill(data->begin() + produced, data->end(), 0);
+        return data;
+    }
+
+
+    //! Decode btrfs lzo framing.
+    //!
+    //! The data starts with its total length, followed by segments of at
+    //! most one sector of file data, each prefixed with its length. A
+    //! segment header never crosses a sector boundary, the rest of the
+    //! sector is padded instead.
+    //!
+    //! \return True if all segments are decoded.
+    //!
+    bool ExtentDecoder::decodeLzo(const uint8_t* src, uint64_t srcLen, uint8_t* dst, uint64_t dstLen) const
+    {
+        const uint64_t LEN_SIZE = 4;
+        if(srcLen < LEN_SIZE)
+            return false;
+        uint64_t totalLen = read32Bit(TSK_LIT_ENDIAN, src);
+        if(totalLen > srcLen)
+            return false;
+
+        uint64_t inPos(LEN_SIZE);
+        uint64_t outPos(0);
+        while(inPos < totalLen && outPos < dstLen) {
+            if(totalLen - inPos < LEN_SIZE)
+                return false;
+            uint64_t segmentLen = read32Bit(TSK_LIT_ENDIAN, src + inPos);
+            inPos += LEN_SIZE;
+            if(segmentLen > totalLen - inPos)
+                return false;
+
+            size_t produced(0);
+            if(!lzo1xDecompress(src + inPos, segmentLen, dst + outPos, dstLen - outPos, &produced))
+                return false;
+            inPos += segmentLen;
+            outPos += produced;
+
+            uint64_t sectorLeft = sectorSize - inPos % sectorSize;
+            if(sectorLeft < LEN_SIZE)
+                inPos += sectorLeft;
+        }
+
+        if(outPos < dstLen)
+            std::fill(dst + outPos, dst + dstLen, 0);
+        return true;
+    }
+
+
+    //! Drop least recently used extents until the cache fits its capacity.
+    //! Must be called with the cache lock held.
+    void ExtentDecoder::evict()
+    {
+        while(usedBytes > capacity && !lruList.empty()) {
+            usedBytes -= lruList.back().data->size();
+            entries.erase(lruList.back().address);
+            lruList.pop_back();
+            ++evictions;
+        }
+    }
+
+
+    //! Change the maximum decoded bytes held by the cache.
+    void ExtentDecoder::setCapacity(uint64_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        capacity = bytes;
+        evict();
+    }
+
+
+    //! Drop all cached extents.
+    void ExtentDecoder::clear()
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        entries.clear();
+        lruList.clear();
+        usedBytes = 0;
+    }
+
+
+    uint64_t ExtentDecoder::getCapacity() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return capacity;
+    }
+
+    uint64_t ExtentDecoder::getUsedBytes() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return usedBytes;
+    }
+
+    uint64_t ExtentDecoder::getHits() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return hits;
+    }
+
+    uint64_t ExtentDecoder::getMisses() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return misses;
+    }
+
+    uint64_t ExtentDecoder::getEvictions() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return evictions;
+    }
+}
@@ -0,0 +1,86 @@
+//! \file
+//! \author Shujian Yang
+//!
+//! Header file of class ExtentDecoder.
+
+#ifndef EXTENT_DECODER_H
+#define EXTENT_DECODER_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <tsk/libtsk.h>
+
+class BTRFS_POOL;
+
+namespace btrForensics {
+    //! Decompresses file extents, with a byte-bounded LRU cache of results.
+    //!
+    //! A compressed extent holds at most 128 KiB of file data and is
+    //! decoded as a whole, so extents are independent units of work.
+    //! Results are keyed by the logical address of the compressed data.
+    class ExtentDecoder {
+    public:
+        //! Decoded content of one extent, shared with the cache.
+        typedef std::shared_ptr<const std::vector<char>> DecodedExtent;
+
+        //! Location and encoding of one compressed extent.
+        struct Request {
+            uint64_t address; //!< Logical address of the compressed data.
+            uint64_t diskSize; //!< Bytes of compressed data.
+            uint64_t decodedSize; //!< Bytes after decompression.
+            uint8_t compression; //!< Compression algorithm.
+        };
+
+    private:
+        //! One cached extent.
+        struct Entry {
+            uint64_t address;
+            DecodedExtent data;
+        };
+
+        BTRFS_POOL* pool;
+        uint32_t sectorSize; //!< Lzo segment headers never cross a sector.
+        uint64_t capacity; //!< Maximum decoded bytes held by the cache.
+        uint64_t usedBytes;
+
+        std::list<Entry> lruList; //!< Most recently used extent first.
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> entries;
+        mutable std::mutex cacheLock;
+
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+
+        DecodedExtent decompress(const Request& request) const;
+        bool decodeLzo(const uint8_t* src, uint64_t srcLen, uint8_t* dst, uint64_t dstLen) const;
+        void evict();
+
+    public:
+        ExtentDecoder(BTRFS_POOL* pool, uint64_t capacity = DEFAULT_CAPACITY);
+        ~ExtentDecoder() = default; //!< Destructor
+
+        DecodedExtent decode(const Request& request);
+        std::vector<DecodedExtent> decodeAll(const std::vector<Request>& requests);
+        void setCapacity(uint64_t bytes);
+        void clear();
+
+        uint64_t getCapacity() const; //!< Return maximum decoded bytes held by the cache.
+        uint64_t getUsedBytes() const; //!< Return decoded bytes currently held by the cache.
+        uint64_t getHits() const; //!< Return number of extents served from the cache.
+        uint64_t getMisses() const; //!< Return number of extents decompressed.
+        uint64_t getEvictions() const; //!< Return number of extents dropped from the cache.
+
+        static bool isSupported(uint8_t compression);
+
+        static const uint64_t DEFAULT_CAPACITY = 16 * 1024 * 1024; //!< Default cache size in bytes.
+        static const uint64_t MAX_EXTENT_SIZE = 128 * 1024; //!< Largest compressed extent, before and after decoding.
+        static const uint8_t COMPRESS_ZLIB = 1; //!< Zlib compression.
+        static const uint8_t COMPRESS_LZO = 2; //!< Lzo compression, split into per-sector segments.
+        static const uint8_t COMPRESS_ZSTD = 3; //!< Zstd compression.
+    };
+}
+
+#endif
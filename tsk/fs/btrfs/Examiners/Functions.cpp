@@ -5,7 +5,9 @@
 
 #include <algorithm>
 #include <cmath>
+#include <sstream>
 #include "Functions.h"
+#include "../../../utils/Tools.h"
 
 namespace btrForensics{
     //! Prints names of files stored in a leaf node.
@@ -92,74 +94,36 @@ namespace btrForensics{
     }
 
 
-    //! Get the physical address by comparing givel logical address with chunk items in a leaf node.
+    //! Caculate the physical address by comparing givel logical address
+    //! with (logical, physical) address pair stored in a chunk item.
     //!
-    //! \param leaf Pointer to the leaf node.
-    //! \param targetLogAddr Logical address to convert.
-    //! \param targetPhyAddr Converted physical address.
+    //! \param logicalAddr Logical address to convert.
+    //! \param key Key storing logical address.
+    //! \param chunkData Chunk item data storing corresponding physical address.
     //!
-    //! \return Return true when the address is acquired.
+    //! \return Mapped physical address. 0 if not valid.
     //!
-    bool getPhyAddr(const LeafNode* leaf, uint64_t targetLogAddr,
-           vector<BTRFSPhyAddr>& physAddr)
+    vector<BTRFSPhyAddr> getChunkAddr(uint64_t logicalAddr,
+            const BtrfsKey* key, const ChunkData* chunkData)
     {
-        bool found = false;
-        const BtrfsItem* target(nullptr);
-        const ChunkItem* chunk(nullptr);
-        for(auto item : leaf->itemList) {
-            //The item must be a chunk item.
-            if(item->getItemType() != ItemType::CHUNK_ITEM)
-                continue;
-            //Chunk logical address should be just smaller than or equal to
-            //target logical address.
-            //In other words, find the chunk with logical address that is the
-            //largest one but smaller or equal to target logical address.
-            //cout << *item << endl;
-            chunk = static_cast<const ChunkItem*>(item);
-            if(item->itemHead->key.offset <= targetLogAddr &&
-               (targetLogAddr < item->itemHead->key.offset + chunk->data.getChunkSize())) {
-                target = item;
-                found = true;
-                //cout << "TARGET FOUND: " << targetLogAddr << " in " << item->itemHead->key.offset << " - "
-                //     << item->itemHead->key.offset + chunk->data.getChunkSize() << "!" << endl;
-                break;
-            }
-
-        }
-
-        //TODO: Fallback for multi-device and nullptr
-        //Matched chunk may not be found.
-        //Then physical address equals to logical address?(Not 100% sure.)
-        /*if(target == nullptr)
-            targetPhyAddr = targetLogAddr;*/
-
-        //Read the chunk to calculate actual physical address.
-        if(found){
-            physAddr =
-                    getChunkAddr(targetLogAddr, &chunk->itemHead->key, &chunk->data);
-            return true;
-        } else {
-            return false;
-        }
-
+        //Key offset stores logical address.
+        return getChunkAddr(logicalAddr, key->offset, chunkData);
     }
 
 
-    //! Caculate the physical address by comparing givel logical address
-    //! with (logical, physical) address pair stored in a chunk item.
+    //! Caculate the physical address of a logical address inside a chunk.
     //!
     //! \param logicalAddr Logical address to convert.
-    //! \param key Key storing logical address.
+    //! \param chunkLogical Logical address of the chunk start.
     //! \param chunkData Chunk item data storing corresponding physical address.
     //!
-    //! \return Mapped physical address. 0 if not valid.
+    //! \return Mapped physical addresses, one per available copy.
     //!
     vector<BTRFSPhyAddr> getChunkAddr(uint64_t logicalAddr,
-            const BtrfsKey* key, const ChunkData* chunkData)
+            uint64_t chunkLogical, const ChunkData* chunkData)
     {
         vector<BTRFSPhyAddr> addresses;
         uint64_t physicalAddr;
-        uint64_t chunkLogical = key->offset; //Key offset stores logical address.
         uint64_t chunkPhysical = chunkData->getOffset(); //Data offset stores physical address.
         uint16_t numStripes = chunkData->getNumStripe();
         uint64_t stripeLength = chunkData->getStripeLength();
@@ -220,46 +184,83 @@ namespace btrForensics{
         return addresses;
     }
 
-    //TODO: shorten function
-    uint64_t getChunkLog(const LeafNode* leaf, uint64_t logicalAddr, uint64_t& chunkLogical){
-        bool found = false;
-        const BtrfsItem* target(nullptr);
-        const ChunkItem* chunk(nullptr);
+    //! Check the crc32c stored at the start of a tree node.
+    //!
+    //! \param data Raw bytes of the whole node.
+    //! \param nodeSize Size of the node in bytes.
+    //!
+    static bool nodeChecksumValid(const uint8_t *data, uint32_t nodeSize)
+    {
+        uint32_t stored = read32Bit(TSK_LIT_ENDIAN, data);
+        uint32_t computed = crc32c(0, data + BtrfsHeader::SIZE_OF_CSUM,
+                nodeSize - BtrfsHeader::SIZE_OF_CSUM);
+        return stored == computed;
+    }
+
 
-        for(auto item : leaf->itemList) {
-            //The item must be a chunk item.
-            if(item->getItemType() != ItemType::CHUNK_ITEM)
-                continue;
-            //Chunk logical address should be just smaller than or equal to
-            //target logical address.
-            //In other words, find the chunk with logical address that is the
-            //largest one but smaller or equal to target logical address.
-            //cout << *item << endl;
-            chunk = static_cast<const ChunkItem*>(item);
-            if(item->itemHead->key.offset <= logicalAddr &&
-               (logicalAddr < (item->itemHead->key.offset + chunk->data.getChunkSize()))) {
-                target = item;
-                found = true;
-                break;
+    //! Read a whole tree node with a single read and decode it.
+    //!
+    //! When checksum verification is enabled and the filesystem uses
+    //! crc32c, the node checksum is verified. A node failing the check is
+    //! read again from the other mirrors of its chunk.
+    //!
+    //! \param pool Pool the node is stored in.
+    //! \param endian The endianess of the node.
+    //! \param logicalAddr Logical address of the node.
+    //!
+    //! \return Pointer to the new node, to be deleted by the caller.
+    //!
+    const BtrfsNode* readNode(BTRFS_POOL *pool, TSK_ENDIAN_ENUM endian,
+            uint64_t logicalAddr)
+    {
+        const SuperBlock *superBlk = pool->getSuperblock();
+        uint32_t nodeSize = superBlk->getNodeSize();
+        if(nodeSize <= BtrfsHeader::SIZE_OF_HEADER)
+            throw FsDamagedException("Invalid node size in superblock.");
+
+        vector<char> nodeArr;
+        pool->readData(logicalAddr, nodeSize, nodeArr);
+        const uint8_t *data = (const uint8_t*)nodeArr.data();
+
+        if(pool->getVerifyChecksums() && superBlk->getCsumType() == 0
+                && !nodeChecksumValid(data, nodeSize)) {
+            //The first available copy was read above, try the others.
+            bool repaired(false);
+            bool firstCopy(true);
+            for(auto &mirror : pool->getPhysicalAddress(logicalAddr)) {
+                if(pool->getDeviceByID(mirror.device) == nullptr)
+                    continue;
+                if(firstCopy) {
+                    firstCopy = false;
+                    continue;
+                }
+                pool->readRawData(mirror.device, mirror.offset, nodeSize, nodeArr);
+                data = (const uint8_t*)nodeArr.data();
+                if(nodeChecksumValid(data, nodeSize)) {
+                    repaired = true;
+                    break;
+                }
             }
 
+            if(!repaired) {
+                std::ostringstream oss;
+                oss << "Checksum mismatch in tree node at logical address 0x"
+                    << std::hex << logicalAddr << ".";
+                throw FsDamagedException(oss.str());
+            }
+            if(tsk_verbose)
+                tsk_fprintf(stderr, "readNode: node at logical address 0x%" PRIx64
+                        " read from another mirror after a checksum mismatch\n", logicalAddr);
         }
 
-        //TODO: Fallback for multi-device and nullptr
-        //Matched chunk may not be found.
-        //Then physical address equals to logical address?(Not 100% sure.)
-        /*if(target == nullptr)
-            targetPhyAddr = targetLogAddr;*/
-
-        //Read the chunk to calculate actual physical address.
-        if(found){
-            chunkLogical = chunk->itemHead->key.offset;
-            return true;
-        } else {
-            return false;
-        }
+        BtrfsHeader *header = new BtrfsHeader(endian, (uint8_t*)data);
+        if(header->isLeafNode())
+            return new LeafNode(header, endian, data, nodeSize, logicalAddr);
+        else
+            return new InternalNode(header, endian, data, nodeSize);
     }
 
+
     //TODO: Does not belong into Examiners/Functions...
      char const* getRAIDFromFlag(uint64_t type){
         char * result = new char[30];
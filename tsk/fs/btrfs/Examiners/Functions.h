@@ -21,12 +21,14 @@ namespace btrForensics {
 
     void filterItems(const LeafNode *, ItemType, vector<const BtrfsItem *> &);
 
-    bool getPhyAddr(const LeafNode *leaf, uint64_t targetLogAddr, vector<BTRFSPhyAddr>& physAddr);
-
     vector<BTRFSPhyAddr> getChunkAddr(uint64_t logicalAddr,
                               const BtrfsKey *key, const ChunkData *chunkData);
 
-    uint64_t getChunkLog(const LeafNode *, uint64_t, uint64_t &);
+    vector<BTRFSPhyAddr> getChunkAddr(uint64_t logicalAddr,
+                              uint64_t chunkLogical, const ChunkData *chunkData);
+
+    const BtrfsNode* readNode(BTRFS_POOL *pool, TSK_ENDIAN_ENUM endian,
+                              uint64_t logicalAddr);
 
     std::ostream &operator<<(std::ostream &os, const DirItemType &type);
 
@@ -0,0 +1,122 @@
+//! \file
+//! \author Shujian Yang
+//!
+//! Implementation of class NodeCache.
+
+#include "NodeCache.h"
+#include "Functions.h"
+#include "../Trees/SuperBlock.h"
+#include "../../../pool/BTRFS_POOL.h"
+
+namespace btrForensics {
+    //! Constructor of node cache.
+    //!
+    //! \param pool Pool nodes are read from.
+    //! \param endian The endianess of the nodes.
+    //! \param capacity Maximum bytes held by the cache.
+    //!
+    NodeCache::NodeCache(BTRFS_POOL* pool, TSK_ENDIAN_ENUM endian, uint64_t capacity)
+        :pool(pool), endian(endian), capacity(capacity), usedBytes(0),
+        hits(0), misses(0), evictions(0)
+    {
+        nodeSize = pool->getSuperblock()->getNodeSize();
+    }
+
+
+    //! Get the node at a logical address, reading it on a miss.
+    //!
+    //! \param logicalAddr Logical address of the node.
+    //! \return Handle to the node, which keeps it alive while held.
+    //!
+    NodeHandle NodeCache::getNode(uint64_t logicalAddr)
+    {
+        {
+            std::lock_guard<std::mutex> guard(cacheLock);
+            auto found = entries.find(logicalAddr);
+            if(found != entries.end()) {
+                ++hits;
+                lruList.splice(lruList.begin(), lruList, found->second);
+                return found->second->node;
+            }
+            ++misses;
+        }
+
+        //Read outside the lock so other threads are not blocked by the I/O.
+        NodeHandle node(readNode(pool, endian, logicalAddr));
+
+        std::lock_guard<std::mutex> guard(cacheLock);
+        auto found = entries.find(logicalAddr);
+        if(found != entries.end()) //Another thread read it meanwhile.
+            return found->second->node;
+
+        lruList.push_front(Entry{logicalAddr, node});
+        entries[logicalAddr] = lruList.begin();
+        usedBytes += nodeSize;
+        evict();
+
+        return node;
+    }
+
+
+    //! Drop least recently used nodes until the cache fits its capacity.
+    //! Must be called with the cache lock held.
+    void NodeCache::evict()
+    {
+        while(usedBytes > capacity && !lruList.empty()) {
+            entries.erase(lruList.back().logicalAddr);
+            lruList.pop_back();
+            usedBytes -= nodeSize;
+            ++evictions;
+        }
+    }
+
+
+    //! Change the maximum bytes held by the cache.
+    void NodeCache::setCapacity(uint64_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        capacity = bytes;
+        evict();
+    }
+
+
+    //! Drop all cached nodes.
+    void NodeCache::clear()
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        entries.clear();
+        lruList.clear();
+        usedBytes = 0;
+    }
+
+
+    uint64_t NodeCache::getCapacity() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return capacity;
+    }
+
+    uint64_t NodeCache::getUsedBytes() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return usedBytes;
+    }
+
+    uint64_t NodeCache::getHits() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return hits;
+    }
+
+    uint64_t NodeCache::getMisses() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return misses;
+    }
+
+    uint64_t NodeCache::getEvictions() const
+    {
+        std::lock_guard<std::mutex> guard(cacheLock);
+        return evictions;
+    }
+}
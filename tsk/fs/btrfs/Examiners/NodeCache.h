@@ -0,0 +1,64 @@
+//! \file
+//! \author Shujian Yang
+//!
+//! Header file of class NodeCache.
+
+#ifndef NODE_CACHE_H
+#define NODE_CACHE_H
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <tsk/libtsk.h>
+#include "../Trees/BtrfsNode.h"
+
+class BTRFS_POOL;
+
+namespace btrForensics {
+    //! Byte-bounded LRU cache of decoded tree nodes, keyed by logical address.
+    //!
+    //! Nodes are handed out as reference counted handles. An evicted node
+    //! stays alive until the last handle to it is released.
+    class NodeCache {
+    private:
+        //! One cached node.
+        struct Entry {
+            uint64_t logicalAddr;
+            NodeHandle node;
+        };
+
+        BTRFS_POOL* pool;
+        TSK_ENDIAN_ENUM endian;
+        uint64_t nodeSize; //!< Bytes charged for each cached node.
+        uint64_t capacity; //!< Maximum bytes held by the cache.
+        uint64_t usedBytes;
+
+        std::list<Entry> lruList; //!< Most recently used node first.
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> entries;
+        mutable std::mutex cacheLock;
+
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+
+        void evict();
+
+    public:
+        NodeCache(BTRFS_POOL* pool, TSK_ENDIAN_ENUM endian, uint64_t capacity = DEFAULT_CAPACITY);
+        ~NodeCache() = default; //!< Destructor
+
+        NodeHandle getNode(uint64_t logicalAddr);
+        void setCapacity(uint64_t bytes);
+        void clear();
+
+        uint64_t getCapacity() const; //!< Return maximum bytes held by the cache.
+        uint64_t getUsedBytes() const; //!< Return bytes currently held by the cache.
+        uint64_t getHits() const; //!< Return number of lookups served from the cache.
+        uint64_t getMisses() const; //!< Return number of lookups that read the node.
+        uint64_t getEvictions() const; //!< Return number of nodes dropped from the cache.
+
+        static const uint64_t DEFAULT_CAPACITY = 64 * 1024 * 1024; //!< Default cache size in bytes.
+    };
+}
+
+#endif
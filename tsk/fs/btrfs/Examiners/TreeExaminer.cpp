@@ -4,10 +4,13 @@
 //! Implementation of class TreeExaminer.
 
 #include <map>
+#include <limits>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
 #include <functional>
+#include <cstring>
 #include "TreeExaminer.h"
 #include "Functions.h"
 
@@ -23,8 +26,11 @@ namespace btrForensics {
     //!
     TreeExaminer::TreeExaminer(BTRFS_POOL* pool, TSK_ENDIAN_ENUM end,
             const SuperBlock* superBlk)
-        :pool(pool), endian(end)
+        :rootTree(nullptr), endian(end), pool(pool)
     {
+        nodeCache = new NodeCache(pool, endian);
+        extentDecoder = new ExtentDecoder(pool);
+
         //Chunk tree is needed at the very beginning
         //to convert logical address to physical address.
         chunkTree = new ChunkTree(superBlk, this);
@@ -40,15 +46,13 @@ namespace btrForensics {
     //!
     TreeExaminer::TreeExaminer(BTRFS_POOL* pool, TSK_ENDIAN_ENUM end,
             const SuperBlock* superBlk, uint64_t fsRootId)
-        :pool(pool), endian(end)
+        :endian(end), pool(pool)
     {
+        nodeCache = new NodeCache(pool, endian);
+        extentDecoder = new ExtentDecoder(pool);
         initializeRootTree(superBlk);
 
-        const BtrfsItem* foundItem;
-        if(treeSearchById(rootTree, fsRootId,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::ROOT_BACKREF, foundItem); })) {
-            //const RootRef* dir = static_cast<const RootRef*>(foundItem);
+        if(findItem(rootTree, fsRootId, ItemType::ROOT_BACKREF) != nullptr) {
             fsTree = new FilesystemTree(rootTree, fsRootId, this);
             fsTreeDefault = fsTree;
         }
@@ -69,6 +73,10 @@ namespace btrForensics {
             delete fsTreeDefault;
         if(rootTree != nullptr)
             delete rootTree;
+        if(nodeCache != nullptr)
+            delete nodeCache;
+        if(extentDecoder != nullptr)
+            delete extentDecoder;
     }
 
 
@@ -125,20 +133,7 @@ namespace btrForensics {
         //uint64_t rootTreelogAddr = 40714240;
         //cerr << "DBG: RootTreeLogAddr: " << rootTreelogAddr << endl;
 
-        vector<char> diskArr;
-        pool->readData(rootTreelogAddr, BtrfsHeader::SIZE_OF_HEADER, diskArr);
-        BtrfsHeader* rootHeader = new BtrfsHeader(endian, (uint8_t*)diskArr.data());
-
-        //cerr << "using rootTree at logical address: "  << rootTreelogAddr << " (transaction "
-        //     << rootHeader->getGeneration() << ")" << endl << endl;
-
-        //cerr << "DBG: CreatedRootHeader" << endl;
-
-        uint64_t itemListStart = rootTreelogAddr + BtrfsHeader::SIZE_OF_HEADER;
-        if(rootHeader->isLeafNode())
-            rootTree = new LeafNode(pool, rootHeader, endian, itemListStart);
-        else
-            rootTree = new InternalNode(pool, rootHeader, endian, itemListStart);
+        rootTree = readNode(pool, endian, rootTreelogAddr);
 
         //cerr << "DBG: CreatedRootTree " << endl;
     }
@@ -155,10 +150,9 @@ namespace btrForensics {
 
         //cerr << "DBG: getDefaultFsId()" << endl;
 
-        const BtrfsItem* foundItem;
-        if(treeSearchById(rootTree, defaultDirId,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::DIR_ITEM, foundItem); })) {
+        NodePins pins;
+        const BtrfsItem* foundItem = findItem(rootTree, defaultDirId, ItemType::DIR_ITEM, &pins);
+        if(foundItem != nullptr) {
             const DirItem* dir = static_cast<const DirItem*>(foundItem);
             defaultId = dir->targetKey.objId; //This is id of root item to filesystem tree.
         }
@@ -178,6 +172,7 @@ namespace btrForensics {
     const void TreeExaminer::navigateNodes(const BtrfsNode* root, ostream& os, istream& is) const
     {
         const BtrfsNode *node = root;
+        NodeHandle current; //Keeps the displayed node alive.
         const BtrfsHeader *header;
         while(true) {
             header = node->nodeHeader;
@@ -234,46 +229,10 @@ namespace btrForensics {
             }
             os << endl;
 
-            bool nodeExisted(false);
-            using ConstNodePtr = const BtrfsNode*;
-            ConstNodePtr* childPtr(nullptr);
-            if(!header->isLeafNode()) {
-                const InternalNode* internal = static_cast<const InternalNode*>(node);
-
-                for(auto ptr : internal->keyPointers) {
-                    if(ptr->key.objId == inputId && ptr->childNode != nullptr) {
-                        node = ptr->childNode;
-                        nodeExisted = true;
-                        break;
-                    }
-                    else if(ptr->key.objId == inputId) {
-                        childPtr = &ptr->childNode;
-                        break;
-                    }
-                }
-            }
-            if(nodeExisted) continue; //The child node has already been built.
-
             //TODO: Support for vector addr
             offset = nodeAddrs[inputId];
-            BTRFSPhyAddr physicalAddr = getPhysicalAddr(offset).at(0);
-
-            char *headerArr = new char[BtrfsHeader::SIZE_OF_HEADER]();
-            tsk_img_read(image, physicalAddr.offset, headerArr, BtrfsHeader::SIZE_OF_HEADER);
-            header = new BtrfsHeader(TSK_LIT_ENDIAN, (uint8_t*)headerArr);
-            delete [] headerArr;
-
-            uint64_t itemOffset = physicalAddr.offset + BtrfsHeader::SIZE_OF_HEADER;
-
-            if(header->isLeafNode()){
-                node = new LeafNode(pool, header, endian, itemOffset);
-            }
-            else {
-                node = new InternalNode(pool, header, endian, itemOffset);
-            }
-
-            if(childPtr!=nullptr)
-                *childPtr = node;
+            current = nodeCache->getNode(offset);
+            node = current.get();
         }
     }
 
@@ -287,8 +246,9 @@ namespace btrForensics {
     const bool TreeExaminer::switchFsTrees(ostream& os, istream& is)
     {
         vector<const BtrfsItem*> foundRootRefs;
+        NodePins pins;
         treeTraverse(rootTree, [&foundRootRefs](const LeafNode* leaf)
-                { return filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs); });
+                { return filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs); }, &pins);
         
         if(foundRootRefs.size() == 0) {
             os << "\nNo subvolumes or snapshots are found.\n" << endl;
@@ -333,9 +293,11 @@ namespace btrForensics {
     //! \param node Node being processed.
     //! \param readOnlyFunc A function type which accepts a LeafNode* 
     //!        and a vector<uint64_t>& parameters and returns void.
+    //! \param pins Optional, receives handles to every leaf passed to the function,
+    //!        so items found in them stay valid after the call.
     //!
     void TreeExaminer::treeTraverse(const BtrfsNode *node,
-            function<void(const LeafNode*)> readOnlyFunc) const
+            function<void(const LeafNode*)> readOnlyFunc, NodePins* pins) const
     {
         if(node->nodeHeader->isLeafNode()){
             const LeafNode* leaf = static_cast<const LeafNode*>(node);
@@ -343,31 +305,13 @@ namespace btrForensics {
         }
         else {
             const InternalNode* internal = static_cast<const InternalNode*>(node);
-            const BtrfsNode *newNode;
 
             for(auto ptr : internal->keyPointers) {
-                if(ptr->childNode != nullptr) {
-                    newNode = ptr->childNode;
-                }
-                else {
-                    vector<char> headerArr;
-                    pool->readData(ptr->getBlkNum(), BtrfsHeader::SIZE_OF_HEADER, headerArr);
-                    BtrfsHeader *header = new BtrfsHeader(TSK_LIT_ENDIAN, (uint8_t*)headerArr.data());
+                NodeHandle newNode = nodeCache->getNode(ptr->getBlkNum());
+                if(pins != nullptr && newNode->nodeHeader->isLeafNode())
+                    pins->push_back(newNode);
 
-                    uint64_t itemOffset = ptr->getBlkNum() + BtrfsHeader::SIZE_OF_HEADER;
-
-                    if(header->isLeafNode()){
-                        newNode = new LeafNode(pool, header, endian, itemOffset);
-                    }
-                    else {
-                        newNode = new InternalNode(pool, header, endian, itemOffset);
-                    }
-
-                    ptr->childNode = newNode;
-                }
-
-                if(newNode != nullptr)
-                    treeTraverse(newNode, readOnlyFunc);
+                treeTraverse(newNode.get(), readOnlyFunc, pins);
             }
         }
     }
@@ -378,10 +322,12 @@ namespace btrForensics {
     //! \param node Node being processed.
     //! \param searchFunc A function type which accepts a LeafNode* 
     //!        parameter and returns true if certain object is found.
+    //! \param pins Optional, receives handles to every leaf passed to the function,
+    //!        so items found in them stay valid after the call.
     //! \return True if target is found in leaf node.
     //!
     bool TreeExaminer::treeSearch(const BtrfsNode *node,
-            function<bool(const LeafNode*)> searchFunc) const
+            function<bool(const LeafNode*)> searchFunc, NodePins* pins) const
     {
         if(node->nodeHeader->isLeafNode()){
             const LeafNode *leaf = static_cast<const LeafNode*>(node);
@@ -389,30 +335,13 @@ namespace btrForensics {
         }
         else {
             const InternalNode *internal = static_cast<const InternalNode*>(node);
-            const BtrfsNode *newNode;
 
             for(auto ptr : internal->keyPointers) {
-                if(ptr->childNode != nullptr) {
-                    newNode = ptr->childNode;
-                }
-                else {
-                    vector<char> headerArr;
-                    pool->readData(ptr->getBlkNum(), BtrfsHeader::SIZE_OF_HEADER, headerArr);
-                    BtrfsHeader *header = new BtrfsHeader(TSK_LIT_ENDIAN, (uint8_t*)headerArr.data());
-
-                    uint64_t itemOffset = ptr->getBlkNum() + BtrfsHeader::SIZE_OF_HEADER;
-                    
-                    if(header->isLeafNode()){
-                        newNode = new LeafNode(pool, header, endian, itemOffset);
-                    }
-                    else {
-                        newNode = new InternalNode(pool, header, endian, itemOffset);
-                    }
-
-                    ptr->childNode = newNode;
-                }
+                NodeHandle newNode = nodeCache->getNode(ptr->getBlkNum());
+                if(pins != nullptr && newNode->nodeHeader->isLeafNode())
+                    pins->push_back(newNode);
 
-                if(newNode != nullptr && treeSearch(newNode, searchFunc))
+                if(treeSearch(newNode.get(), searchFunc, pins))
                     return true;
             }
             return false;
@@ -426,10 +355,12 @@ namespace btrForensics {
     //! \param targetId Object id of target to search for.
     //! \param searchFunc A function type which accepts a LeafNode* 
     //!        parameter and returns true if certain object is found.
+    //! \param pins Optional, receives handles to every leaf passed to the function,
+    //!        so items found in them stay valid after the call.
     //! \return True if target is found in leaf node.
     //!
     bool TreeExaminer::treeSearchById(const BtrfsNode *node, uint64_t targetId,
-            function<bool(const LeafNode*, uint64_t)> searchFunc) const
+            function<bool(const LeafNode*, uint64_t)> searchFunc, NodePins* pins) const
     {
         //cerr << "DBG: treeSearchById" << endl;
         //cerr << node->info() << endl;
@@ -443,7 +374,6 @@ namespace btrForensics {
         }
         else {
             const InternalNode *internal = static_cast<const InternalNode*>(node);
-            const BtrfsNode *newNode;
 
             const auto &vecPtr = internal->keyPointers;
             //cerr << "FOUND INTERNAL NODE WITH " << vecPtr.size() << " CHILD NODES!" << endl;
@@ -456,30 +386,289 @@ namespace btrForensics {
                         && vecPtr[i+1]->key.objId<targetId)
                     continue;
 
-                if(ptr->childNode != nullptr) {
-                    newNode = ptr->childNode;
+                NodeHandle newNode = nodeCache->getNode(ptr->getBlkNum());
+                if(pins != nullptr && newNode->nodeHeader->isLeafNode())
+                    pins->push_back(newNode);
+
+                if(treeSearchById(newNode.get(), targetId, searchFunc, pins))
+                    return true;
+            }
+            return false;
+        }
+    }
+
+
+    //! Visit all items with keys in [first, last] in key order.
+    //!
+    //! Descends the tree with binary searches on the full key, so only
+    //! the nodes covering the range are read.
+    //!
+    //! \param node Node being processed.
+    //! \param first Smallest key to visit.
+    //! \param last Largest key to visit.
+    //! \param visitFunc A function type which accepts a BtrfsItem*
+    //!        and returns false to stop the search.
+    //! \param pins Optional, receives handles to every leaf visited,
+    //!        so items found in them stay valid after the call.
+    //! \return False if the search was stopped by visitFunc.
+    //!
+    bool TreeExaminer::rangeSearch(const BtrfsNode *node, const BtrfsKey& first,
+            const BtrfsKey& last, function<bool(const BtrfsItem*)> visitFunc,
+            NodePins* pins) const
+    {
+        if(node->nodeHeader->isLeafNode()) {
+            const LeafNode *leaf = static_cast<const LeafNode*>(node);
+            const auto &items = leaf->itemList;
+
+            auto it = lower_bound(items.begin(), items.end(), first,
+                    [](const BtrfsItem* item, const BtrfsKey& key)
+                    { return item->itemHead->key < key; });
+            for(; it != items.end() && (*it)->itemHead->key <= last; ++it) {
+                if(!visitFunc(*it))
+                    return false;
+            }
+            return true;
+        }
+
+        const InternalNode *internal = static_cast<const InternalNode*>(node);
+        const auto &ptrs = internal->keyPointers;
+
+        //Child i holds keys in [key i, key i+1), start at the last child with key <= first.
+        auto it = upper_bound(ptrs.begin(), ptrs.end(), first,
+                [](const BtrfsKey& key, const KeyPtr* ptr)
+                { return key < ptr->key; });
+        if(it != ptrs.begin())
+            --it;
+
+        for(auto start = it; it != ptrs.end(); ++it) {
+            if(it != start && (*it)->key > last)
+                break;
+
+            NodeHandle child = nodeCache->getNode((*it)->getBlkNum());
+            if(pins != nullptr && child->nodeHeader->isLeafNode())
+                pins->push_back(child);
+
+            if(!rangeSearch(child.get(), first, last, visitFunc, pins))
+                return false;
+        }
+        return true;
+    }
+
+
+    //! Find the first item with given id and type.
+    //!
+    //! \param node Root of the tree to search.
+    //! \param objId Object id of the item.
+    //! \param type Type of the item.
+    //! \param pins Optional, keeps the leaf holding the item alive.
+    //! \return Pointer to the item, nullptr if not found.
+    //!
+    const BtrfsItem* TreeExaminer::findItem(const BtrfsNode *node, uint64_t objId,
+            ItemType type, NodePins* pins) const
+    {
+        const BtrfsItem* foundItem(nullptr);
+        rangeSearch(node, BtrfsKey(objId, type, 0),
+                BtrfsKey(objId, type, numeric_limits<uint64_t>::max()),
+                [&foundItem](const BtrfsItem* item)
+                { foundItem = item; return false; }, pins);
+        return foundItem;
+    }
+
+
+    //! Find all items with given id and type, ordered by key offset.
+    //!
+    //! \param node Root of the tree to search.
+    //! \param objId Object id of the items.
+    //! \param type Type of the items.
+    //! \param foundItems Vector storing found items.
+    //! \param pins Optional, keeps the leaves holding the items alive.
+    //!
+    void TreeExaminer::findItems(const BtrfsNode *node, uint64_t objId, ItemType type,
+            vector<const BtrfsItem*>& foundItems, NodePins* pins) const
+    {
+        rangeSearch(node, BtrfsKey(objId, type, 0),
+                BtrfsKey(objId, type, numeric_limits<uint64_t>::max()),
+                [&foundItems](const BtrfsItem* item)
+                { foundItems.push_back(item); return true; }, pins);
+    }
+
+
+    namespace {
+        //! Position in a tree while it is compared with another one.
+        //!
+        //! Points either at a key pointer of an internal node or at an
+        //! item of a leaf. Nodes on the current path are held by handles.
+        class DiffCursor {
+        private:
+            struct Frame {
+                NodeHandle node;
+                size_t slot;
+            };
+
+            const TreeExaminer* examiner;
+            vector<Frame> path;
+
+            static size_t count(const BtrfsNode* node)
+            {
+                if(node->nodeHeader->isLeafNode())
+                    return static_cast<const LeafNode*>(node)->itemList.size();
+                return static_cast<const InternalNode*>(node)->keyPointers.size();
+            }
+
+            void enter(NodeHandle node)
+            {
+                path.push_back(Frame{node, 0});
+                if(count(node.get()) == 0) {
+                    path.pop_back();
+                    next();
                 }
-                else {
-                    vector<char> headerArr;
-                    pool->readData(ptr->getBlkNum(), BtrfsHeader::SIZE_OF_HEADER, headerArr);
-                    BtrfsHeader *header = new BtrfsHeader(TSK_LIT_ENDIAN, (uint8_t*)headerArr.data());
+            }
 
-                    uint64_t itemOffset = ptr->getBlkNum() + BtrfsHeader::SIZE_OF_HEADER;
-                    
-                    if(header->isLeafNode()){
-                        newNode = new LeafNode(pool, header, endian, itemOffset);
-                    }
-                    else {
-                        newNode = new InternalNode(pool, header, endian, itemOffset);
-                    }
+            //! Raw data of the current item, kept by the verified leaf on the path.
+            const uint8_t* itemData() const
+            {
+                return static_cast<const LeafNode*>(path.back().node.get())->getItemData(item());
+            }
+
+        public:
+            DiffCursor(const TreeExaminer* examiner, const BtrfsNode* root)
+                :examiner(examiner)
+            {
+                //The root is owned by the caller.
+                enter(NodeHandle(root, [](const BtrfsNode*) {}));
+            }
+
+            bool atEnd() const { return path.empty(); }
+            int level() const { return path.back().node->nodeHeader->getLevel(); }
+
+            const KeyPtr* keyPtr() const
+            {
+                const Frame& top = path.back();
+                return static_cast<const InternalNode*>(top.node.get())->keyPointers[top.slot];
+            }
+
+            const BtrfsItem* item() const
+            {
+                const Frame& top = path.back();
+                return static_cast<const LeafNode*>(top.node.get())->itemList[top.slot];
+            }
+
+            const BtrfsKey& key() const
+            {
+                return level() == 0 ? item()->itemHead->key : keyPtr()->key;
+            }
+
+            //! Compare raw data of the current items of two leaf cursors.
+            bool sameData(const DiffCursor& other) const
+            {
+                uint32_t size = item()->itemHead->getDataSize();
+                if(size != other.item()->itemHead->getDataSize())
+                    return false;
+                return memcmp(itemData(), other.itemData(), size) == 0;
+            }
 
-                    ptr->childNode = newNode;
+            //! Move to the next slot, skipping the subtree below the current one.
+            void next()
+            {
+                while(!path.empty()) {
+                    Frame& top = path.back();
+                    if(++top.slot < count(top.node.get()))
+                        return;
+                    path.pop_back();
                 }
+            }
 
-                if(newNode != nullptr && treeSearchById(newNode, targetId, searchFunc))
-                    return true;
+            //! Move to the next item, descending into the subtree below the current slot.
+            void advance()
+            {
+                if(level() == 0)
+                    next();
+                else
+                    enter(examiner->nodeCache->getNode(keyPtr()->getBlkNum()));
             }
-            return false;
+        };
+    }
+
+
+    //! Compare two trees and report items that differ.
+    //!
+    //! Both trees are walked in lockstep in key order. Subtrees referenced
+    //! by the same block and generation in both trees are shared and are
+    //! skipped without being read, so only the changed paths are visited.
+    //!
+    //! \param oldRoot Root of the older tree.
+    //! \param newRoot Root of the newer tree.
+    //! \param diffFunc Called with the type of difference, the item in the
+    //!        old tree and the item in the new tree, either may be nullptr.
+    //!        Items are only valid during the call.
+    //!
+    void TreeExaminer::treeDiff(const BtrfsNode* oldRoot, const BtrfsNode* newRoot,
+            function<void(DiffType, const BtrfsItem*, const BtrfsItem*)> diffFunc) const
+    {
+        const BtrfsHeader* oldHeader = oldRoot->nodeHeader;
+        const BtrfsHeader* newHeader = newRoot->nodeHeader;
+        if(oldHeader->getLogicalAddr() == newHeader->getLogicalAddr()
+                && oldHeader->getGeneration() == newHeader->getGeneration())
+            return;
+
+        DiffCursor left(this, oldRoot);
+        DiffCursor right(this, newRoot);
+
+        while(!left.atEnd() || !right.atEnd()) {
+            if(left.atEnd()) {
+                if(right.level() == 0)
+                    diffFunc(DiffType::ADDED, nullptr, right.item());
+                right.advance();
+                continue;
+            }
+            if(right.atEnd()) {
+                if(left.level() == 0)
+                    diffFunc(DiffType::REMOVED, left.item(), nullptr);
+                left.advance();
+                continue;
+            }
+
+            int leftLevel = left.level();
+            int rightLevel = right.level();
+            if(leftLevel == 0 && rightLevel == 0) {
+                int cmp = left.key().compare(right.key());
+                if(cmp < 0) {
+                    diffFunc(DiffType::REMOVED, left.item(), nullptr);
+                    left.next();
+                }
+                else if(cmp > 0) {
+                    diffFunc(DiffType::ADDED, nullptr, right.item());
+                    right.next();
+                }
+                else {
+                    if(!left.sameData(right))
+                        diffFunc(DiffType::CHANGED, left.item(), right.item());
+                    left.next();
+                    right.next();
+                }
+            }
+            else if(leftLevel == rightLevel) {
+                int cmp = left.key().compare(right.key());
+                if(cmp < 0)
+                    left.advance();
+                else if(cmp > 0)
+                    right.advance();
+                else if(left.keyPtr()->getBlkNum() == right.keyPtr()->getBlkNum()
+                        && left.keyPtr()->getGeneration() == right.keyPtr()->getGeneration()) {
+                    //Shared subtree, identical in both trees.
+                    left.next();
+                    right.next();
+                }
+                else {
+                    left.advance();
+                    right.advance();
+                }
+            }
+            //Descend the higher cursor until both are on the same level.
+            else if(leftLevel < rightLevel)
+                right.advance();
+            else
+                left.advance();
         }
     }
 }
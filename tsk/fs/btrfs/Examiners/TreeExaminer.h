@@ -13,8 +13,13 @@
 #include "../Basics/Basics.h"
 #include "../Trees/Trees.h"
 #include "../../../pool/BTRFS_POOL.h"
+#include "NodeCache.h"
+#include "ExtentDecoder.h"
 
 namespace btrForensics {
+    //! Kind of difference between two trees reported by treeDiff.
+    enum class DiffType { ADDED, REMOVED, CHANGED };
+
     //! Examine a tree in btrfs.
     class TreeExaminer {
     public:
@@ -22,6 +27,8 @@ namespace btrForensics {
         FilesystemTree* fsTree; //!< The file system tree.
         FilesystemTree* fsTreeDefault; //!< Default file system tree.
         const BtrfsNode* rootTree; //!< Root node of the root tree.
+        NodeCache* nodeCache; //!< Cache of nodes below the tree roots.
+        ExtentDecoder* extentDecoder; //!< Decoder and cache of compressed extents.
 
         TSK_IMG_INFO* image; //!< Image file.
         TSK_ENDIAN_ENUM endian; //!< Endianness.
@@ -43,13 +50,29 @@ namespace btrForensics {
         const bool switchFsTrees(std::ostream& os, std::istream& is);
 
         void treeTraverse(const BtrfsNode* node,
-            std::function<void(const LeafNode*)> readOnlyFunc) const;
+            std::function<void(const LeafNode*)> readOnlyFunc,
+            NodePins* pins = nullptr) const;
 
         bool treeSearch(const BtrfsNode* node,
-            std::function<bool(const LeafNode*)> searchFunc) const;
+            std::function<bool(const LeafNode*)> searchFunc,
+            NodePins* pins = nullptr) const;
 
         bool treeSearchById(const BtrfsNode* node, uint64_t targetId,
-            std::function<bool(const LeafNode*, uint64_t)> searchFunc) const;
+            std::function<bool(const LeafNode*, uint64_t)> searchFunc,
+            NodePins* pins = nullptr) const;
+
+        bool rangeSearch(const BtrfsNode* node, const BtrfsKey& first, const BtrfsKey& last,
+            std::function<bool(const BtrfsItem*)> visitFunc,
+            NodePins* pins = nullptr) const;
+
+        const BtrfsItem* findItem(const BtrfsNode* node, uint64_t objId, ItemType type,
+            NodePins* pins = nullptr) const;
+
+        void findItems(const BtrfsNode* node, uint64_t objId, ItemType type,
+            vector<const BtrfsItem*>& foundItems, NodePins* pins = nullptr) const;
+
+        void treeDiff(const BtrfsNode* oldRoot, const BtrfsNode* newRoot,
+            std::function<void(DiffType, const BtrfsItem*, const BtrfsItem*)> diffFunc) const;
     };
 }
 
@@ -8,6 +8,8 @@
 
 #include <iostream>
 #include <string>
+#include <memory>
+#include <vector>
 #include <tsk/libtsk.h>
 #include "../../../utils/Uuid.h"
 #include "../../../utils/ReadInt.h"
@@ -20,13 +22,19 @@ namespace btrForensics{
         const BtrfsHeader *nodeHeader; //!< Header of a node.
 
         BtrfsNode(const BtrfsHeader *header);
-        ~BtrfsNode() { if(nodeHeader!=nullptr) delete nodeHeader; } //! Destructor
+        virtual ~BtrfsNode() { if(nodeHeader!=nullptr) delete nodeHeader; } //! Destructor
 
         //! Return infomation about the node.
         //! Virtual function to be overridden by derived classes.
         virtual const std::string info() const = 0;
     };
 
+    //! Reference counted handle to a cached node.
+    using NodeHandle = std::shared_ptr<const BtrfsNode>;
+
+    //! Handles keeping nodes alive while items inside them are in use.
+    using NodePins = std::vector<NodeHandle>;
+
 }
 
 #endif
@@ -4,6 +4,7 @@
 //! Header file of class ChunkTree
 
 #include <iostream>
+#include <algorithm>
 #include "ChunkTree.h"
 #include "../Examiners/Functions.h"
 
@@ -16,19 +17,9 @@ namespace btrForensics {
     ChunkTree::ChunkTree(const SuperBlock* superBlk, const TreeExaminer* treeExaminer)
             :examiner(treeExaminer)
     {
-        vector<char> diskArr;
-        examiner->pool->readData(superBlk->getChunkLogAddr(), BtrfsHeader::SIZE_OF_HEADER, diskArr);
-        BtrfsHeader *chunkHeader = new BtrfsHeader(examiner->endian, (uint8_t*)diskArr.data());
-
-        uint64_t itemListStart = superBlk->getChunkLogAddr() + BtrfsHeader::SIZE_OF_HEADER;
-
-        //TODO: pool for internal node
-        const BtrfsNode* chunkTree;
-        if(chunkHeader->isLeafNode())
-            chunkRoot = new LeafNode(examiner->pool, chunkHeader, examiner->endian, itemListStart);
-        else
-            chunkRoot = new InternalNode(examiner->pool, chunkHeader, examiner->endian, itemListStart, true);
+        chunkRoot = readNode(examiner->pool, examiner->endian, superBlk->getChunkLogAddr());
 
+        buildChunkMap();
     }
 
 
@@ -40,32 +31,72 @@ namespace btrForensics {
     }
 
 
+    //! Flatten all chunk items into a table sorted by logical address.
+    //!
+    //! Chunks never change while the pool is open, so the tree is walked
+    //! once here and every later translation is a binary search.
+    //!
+    void ChunkTree::buildChunkMap()
+    {
+        vector<const BtrfsItem*> foundChunks;
+        NodePins pins;
+        examiner->treeTraverse(chunkRoot, [&foundChunks](const LeafNode* leaf)
+                { filterItems(leaf, ItemType::CHUNK_ITEM, foundChunks); }, &pins);
+
+        chunkMap.reserve(foundChunks.size());
+        for(auto item : foundChunks) {
+            const ChunkItem* chunk = static_cast<const ChunkItem*>(item);
+            chunkMap.push_back(ChunkMapping(chunk->itemHead->key.offset,
+                        chunk->data.getChunkSize(), chunk->data));
+        }
+
+        std::sort(chunkMap.begin(), chunkMap.end(),
+                [](const ChunkMapping& a, const ChunkMapping& b)
+                { return a.logical < b.logical; });
+    }
+
+
+    //! Find the chunk containing a logical address.
+    //!
+    //! \param logicalAddr 64-bit logial address.
+    //! \return Pointer to the chunk mapping, nullptr if no chunk contains the address.
+    //!
+    const ChunkMapping* ChunkTree::findChunk(uint64_t logicalAddr) const
+    {
+        //First chunk starting after the address, the one before it may contain it.
+        auto it = std::upper_bound(chunkMap.begin(), chunkMap.end(), logicalAddr,
+                [](uint64_t addr, const ChunkMapping& chunk)
+                { return addr < chunk.logical; });
+
+        if(it == chunkMap.begin())
+            return nullptr;
+        --it;
+        if(logicalAddr - it->logical >= it->length)
+            return nullptr;
+        return &*it;
+    }
+
+
     //! Convert logical address to physical address.
     //!
     //! \param logicalAddr 64-bit logial address.
     //! \return 64-bit physical address.
     //!
-    vector<BTRFSPhyAddr> ChunkTree::getPhysicalAddr(uint64_t logicalAddr)
+    vector<BTRFSPhyAddr> ChunkTree::getPhysicalAddr(uint64_t logicalAddr) const
     {
-        vector<BTRFSPhyAddr> physAddr;
-
-        //std::cout << chunkRoot->info() << std::endl;
-        examiner->treeSearch(chunkRoot,
-                [logicalAddr, &physAddr](const LeafNode* leaf)
-                { return getPhyAddr(leaf, logicalAddr, physAddr); });
+        const ChunkMapping* chunk = findChunk(logicalAddr);
+        if(chunk == nullptr)
+            return vector<BTRFSPhyAddr>();
 
-        return physAddr;
+        return getChunkAddr(logicalAddr, chunk->logical, &chunk->data);
     }
 
-    uint64_t ChunkTree::getChunkLogical(uint64_t logicalAddr) {
+    uint64_t ChunkTree::getChunkLogical(uint64_t logicalAddr) const {
 
-        uint64_t chunkLogical(0);
+        const ChunkMapping* chunk = findChunk(logicalAddr);
+        if(chunk == nullptr)
+            return 0;
 
-        examiner->treeSearch(chunkRoot,
-                             [logicalAddr, &chunkLogical](const LeafNode* leaf)
-                             { return getChunkLog(leaf, logicalAddr, chunkLogical); });
-
-        return chunkLogical;
+        return chunk->logical;
     }
 }
-
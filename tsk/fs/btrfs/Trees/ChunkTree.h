@@ -12,23 +12,40 @@
 #include <tsk/libtsk.h>
 #include "../Basics/Basics.h"
 #include "SuperBlock.h"
+#include "BtrfsNode.h"
 
 namespace btrForensics {
     class TreeExaminer;
 
+    //! One entry of the flattened chunk tree.
+    //! Maps the logical range [logical, logical + length) to its stripes.
+    struct ChunkMapping {
+        uint64_t logical; //!< Logical address of the chunk.
+        uint64_t length; //!< Size of the chunk in bytes.
+        ChunkData data; //!< Stripe length, RAID profile and per-device offsets.
+
+        ChunkMapping(uint64_t logical, uint64_t length, const ChunkData& data)
+            :logical(logical), length(length), data(data) {}
+    };
+
     //! Process chunk tree of Btrfs.
     class ChunkTree {
     public:
         const BtrfsNode* chunkRoot; //!< Root of chunk tree.
     private:
         const TreeExaminer* examiner;
+        std::vector<ChunkMapping> chunkMap; //!< Chunks sorted by logical address.
+
+        void buildChunkMap();
 
     public:
         ChunkTree(const SuperBlock* superBlk, const TreeExaminer* treeExaminer);
         ~ChunkTree();
         
-        std::vector<BTRFSPhyAddr> getPhysicalAddr(uint64_t logicalAddr);
-        uint64_t getChunkLogical(uint64_t logicalAddr);
+        const ChunkMapping* findChunk(uint64_t logicalAddr) const;
+        const std::vector<ChunkMapping>& getChunks() const { return chunkMap; }
+        std::vector<BTRFSPhyAddr> getPhysicalAddr(uint64_t logicalAddr) const;
+        uint64_t getChunkLogical(uint64_t logicalAddr) const;
 
     };
 
@@ -11,6 +11,7 @@
 #include <vector>
 #include <tsk/libtsk.h>
 #include "../Basics/Basics.h"
+#include "BtrfsNode.h"
 
 namespace btrForensics{
     class FileTreeAnalyzer;
@@ -22,6 +23,7 @@ namespace btrForensics{
         const InodeRef *ref; //!< Inode points to this directory.
         std::string name; //!< Name of this directory.
         std::vector<DirItem*> children; //!< Entries of this directory.
+        NodePins pins; //!< Keeps the leaves holding the items above alive.
 
         DirContent(const InodeItem* inodeItem, const InodeRef* inodeRef,
                 std::vector<const BtrfsItem*> &dirItems);
@@ -0,0 +1,173 @@
+//! \file
+//! \author Shujian Yang
+//!
+//! Implementation of class FilesystemIndex.
+
+#include <algorithm>
+#include "FilesystemIndex.h"
+#include "LeafNode.h"
+#include "../Examiners/TreeExaminer.h"
+
+namespace btrForensics {
+    //! Copy the fields of an extent data item.
+    FilesystemIndex::Extent::Extent(const ExtentData* data)
+        :fileOffset(data->itemHead->key.offset), logicalAddress(data->logicalAddress),
+        extentOffset(data->extentOffset), numOfBytes(data->numOfBytes),
+        dataAddress(data->dataAddress), decodedSize(data->decodedSize),
+        diskSize(data->extentSize),
+        type(data->type), compression(data->compression),
+        encryption(data->encryption), otherEncoding(data->otherEncoding) {}
+
+
+    //! Constructor of filesystem index.
+    //!
+    //! Walks the leaves of the tree once, in key order. All items of an
+    //! inode are adjacent, starting with its INODE_ITEM.
+    //!
+    //! \param root Root node of the filesystem tree.
+    //! \param examiner Tree examiner used to read the tree.
+    //!
+    FilesystemIndex::FilesystemIndex(const BtrfsNode* root, const TreeExaminer* examiner)
+    {
+        examiner->treeTraverse(root, [this](const LeafNode* leaf) { addLeaf(leaf); });
+
+        dirStart.push_back(dirEntries.size());
+        extentStart.push_back(extents.size());
+    }
+
+
+    //! Add the items of one leaf to the index.
+    void FilesystemIndex::addLeaf(const LeafNode* leaf)
+    {
+        for(auto item : leaf->itemList) {
+            uint64_t id = item->getId();
+
+            if(item->getItemType() == ItemType::INODE_ITEM) {
+                const InodeItem* inode = static_cast<const InodeItem*>(item);
+                inodeIds.push_back(id);
+                inodes.push_back(inode->getData());
+                parentIds.push_back(0);
+                nameOffsets.push_back(0);
+                nameLengths.push_back(0);
+                dirStart.push_back(dirEntries.size());
+                extentStart.push_back(extents.size());
+                continue;
+            }
+
+            //Items not belonging to an inode, like orphan items, are skipped.
+            if(inodeIds.empty() || inodeIds.back() != id)
+                continue;
+
+            switch(item->getItemType()) {
+                case ItemType::INODE_REF:
+                    if(parentIds.back() == 0) {
+                        const InodeRef* ref = static_cast<const InodeRef*>(item);
+                        std::string name = ref->getDirName();
+                        parentIds.back() = item->itemHead->key.offset;
+                        nameOffsets.back() = namePool.size();
+                        nameLengths.back() = name.size();
+                        namePool += name;
+                    }
+                    break;
+                case ItemType::DIR_INDEX: {
+                    const DirItem* dir = static_cast<const DirItem*>(item);
+                    std::string name = dir->getDirName();
+                    DirEntry entry;
+                    entry.targetId = dir->targetKey.objId;
+                    entry.nameOffset = namePool.size();
+                    entry.nameLength = name.size();
+                    entry.targetType = dir->targetKey.itemType;
+                    entry.type = dir->type;
+                    dirEntries.push_back(entry);
+                    namePool += name;
+                    break;
+                }
+                case ItemType::EXTENT_DATA:
+                    extents.push_back(Extent(static_cast<const ExtentData*>(item)));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+
+    //! Find the row of an inode.
+    //!
+    //! \param id Inode number.
+    //! \return Row index, -1 if the inode is not in the index.
+    //!
+    int64_t FilesystemIndex::findRow(uint64_t id) const
+    {
+        auto it = std::lower_bound(inodeIds.begin(), inodeIds.end(), id);
+        if(it == inodeIds.end() || *it != id)
+            return -1;
+        return it - inodeIds.begin();
+    }
+
+
+    //! Return true if the inode is in the index.
+    bool FilesystemIndex::contains(uint64_t id) const
+    {
+        return findRow(id) >= 0;
+    }
+
+
+    //! Get inode data, nullptr if the inode is not in the index.
+    const InodeData* FilesystemIndex::getInode(uint64_t id) const
+    {
+        int64_t row = findRow(id);
+        if(row < 0)
+            return nullptr;
+        return &inodes[row];
+    }
+
+
+    //! Get name of the inode in its parent directory.
+    std::string FilesystemIndex::getName(uint64_t id) const
+    {
+        int64_t row = findRow(id);
+        if(row < 0)
+            return "";
+        return namePool.substr(nameOffsets[row], nameLengths[row]);
+    }
+
+
+    //! Get inode number of the parent directory, 0 if unknown.
+    uint64_t FilesystemIndex::getParent(uint64_t id) const
+    {
+        int64_t row = findRow(id);
+        if(row < 0)
+            return 0;
+        return parentIds[row];
+    }
+
+
+    //! Get entries of a directory, ordered by dir index.
+    FilesystemIndex::Span<FilesystemIndex::DirEntry> FilesystemIndex::getDirEntries(uint64_t id) const
+    {
+        int64_t row = findRow(id);
+        if(row < 0)
+            return Span<DirEntry>{nullptr, nullptr};
+        return Span<DirEntry>{dirEntries.data() + dirStart[row],
+            dirEntries.data() + dirStart[row + 1]};
+    }
+
+
+    //! Get extents of a file, ordered by file offset.
+    FilesystemIndex::Span<FilesystemIndex::Extent> FilesystemIndex::getExtents(uint64_t id) const
+    {
+        int64_t row = findRow(id);
+        if(row < 0)
+            return Span<Extent>{nullptr, nullptr};
+        return Span<Extent>{extents.data() + extentStart[row],
+            extents.data() + extentStart[row + 1]};
+    }
+
+
+    //! Get name of a directory entry.
+    std::string FilesystemIndex::getEntryName(const DirEntry& entry) const
+    {
+        return namePool.substr(entry.nameOffset, entry.nameLength);
+    }
+}
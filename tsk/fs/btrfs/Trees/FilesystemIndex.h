@@ -0,0 +1,95 @@
+//! \file
+//! \author Shujian Yang
+//!
+//! Header file of class FilesystemIndex.
+
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include <string>
+#include <vector>
+#include <tsk/libtsk.h>
+#include "../Basics/Basics.h"
+#include "BtrfsNode.h"
+
+namespace btrForensics {
+    class TreeExaminer;
+    class LeafNode;
+
+    //! Inode table of a filesystem tree, built with one pass over its leaves.
+    //!
+    //! Rows are sorted by inode number. Per-inode columns are stored in
+    //! parallel vectors, directory entries and extents are stored in flat
+    //! arrays indexed by per-row start positions.
+    class FilesystemIndex {
+    public:
+        //! One entry of a directory, taken from a DIR_INDEX item.
+        struct DirEntry {
+            uint64_t targetId; //!< Inode number or root item id of the target.
+            uint64_t nameOffset; //!< Offset of the name in the name pool.
+            uint16_t nameLength; //!< Length of the name.
+            ItemType targetType; //!< INODE_ITEM, or ROOT_ITEM for subvolumes.
+            DirItemType type; //!< Type of the target.
+        };
+
+        //! One extent of a file, taken from an EXTENT_DATA item.
+        struct Extent {
+            uint64_t fileOffset; //!< Offset of the extent in the file.
+            uint64_t logicalAddress; //!< Logical address of extent, 0 for holes.
+            uint64_t extentOffset; //!< Offset within extent.
+            uint64_t numOfBytes; //!< Logical number of bytes in extent.
+            uint64_t dataAddress; //!< Logical address of inline data.
+            uint64_t decodedSize; //!< Decoded size of extent.
+            uint64_t diskSize; //!< Size of extent or inline data on disk, compressed if compressed.
+            uint8_t type; //!< 0 if inline.
+            uint8_t compression; //!< Compression algorithm, 0 for none.
+            uint8_t encryption; //!< Encryption algorithm, 0 for none.
+            uint16_t otherEncoding; //!< 0 for none.
+
+            Extent(const ExtentData* data);
+        };
+
+        //! Read-only view of consecutive elements.
+        template<typename T>
+        struct Span {
+            const T* first;
+            const T* last;
+            const T* begin() const { return first; }
+            const T* end() const { return last; }
+            size_t size() const { return last - first; }
+        };
+
+    private:
+        std::vector<uint64_t> inodeIds; //!< Sorted inode numbers, one per row.
+        std::vector<InodeData> inodes;
+        std::vector<uint64_t> parentIds; //!< From the first INODE_REF, 0 if none.
+        std::vector<uint64_t> nameOffsets;
+        std::vector<uint16_t> nameLengths;
+        std::vector<uint64_t> dirStart; //!< First dir entry of each row, one extra at the end.
+        std::vector<uint64_t> extentStart; //!< First extent of each row, one extra at the end.
+
+        std::vector<DirEntry> dirEntries;
+        std::vector<Extent> extents;
+        std::string namePool;
+
+        void addLeaf(const LeafNode* leaf);
+        int64_t findRow(uint64_t id) const;
+
+    public:
+        FilesystemIndex(const BtrfsNode* root, const TreeExaminer* examiner);
+        ~FilesystemIndex() = default; //!< Destructor
+
+        //! Return number of inodes in the index.
+        size_t size() const { return inodeIds.size(); }
+
+        bool contains(uint64_t id) const;
+        const InodeData* getInode(uint64_t id) const;
+        std::string getName(uint64_t id) const;
+        uint64_t getParent(uint64_t id) const;
+        Span<DirEntry> getDirEntries(uint64_t id) const;
+        Span<Extent> getExtents(uint64_t id) const;
+        std::string getEntryName(const DirEntry& entry) const;
+    };
+}
+
+#endif
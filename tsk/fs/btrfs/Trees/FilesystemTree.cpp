@@ -9,14 +9,19 @@
 #include <iomanip>
 #include <functional>
 #include <vector>
-#include <iterator>
+#include <algorithm>
+#include <cstdio>
 #include "FilesystemTree.h"
 #include "../Examiners/Functions.h"
+#include "../../../utils/ThreadPool.h"
+#include "../../../pool/POOL_HASH.h"
 
 using namespace std;
 //using namespace std::placeholders;
 
 namespace btrForensics {
+    const uint64_t FilesystemTree::READ_BUFFER_SIZE;
+
     //! Constructor of tree analyzer.
     //!
     //! \param rootNode Root node of the root tree to be analyzed.
@@ -25,13 +30,12 @@ namespace btrForensics {
     //!
     FilesystemTree::FilesystemTree(const BtrfsNode* rootNode,
             uint64_t rootItemId, const TreeExaminer* treeExaminer)
-            :examiner(treeExaminer)
+            :examiner(treeExaminer), index(nullptr)
     {
-        const BtrfsItem* foundItem;
         const RootItem* rootItm;
-        if(examiner->treeSearchById(rootNode, rootItemId,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::ROOT_ITEM, foundItem); })) {
+        NodePins pins;
+        const BtrfsItem* foundItem = examiner->findItem(rootNode, rootItemId, ItemType::ROOT_ITEM, &pins);
+        if(foundItem != nullptr) {
             rootItm = static_cast<const RootItem*>(foundItem);
         }
         else {
@@ -42,22 +46,7 @@ namespace btrForensics {
 
         uint64_t offset = rootItm->getBlockNumber();
         rootDirId = rootItm->getRootObjId();
-        vector<char> headerArr;
-        examiner->pool->readData(offset, BtrfsHeader::SIZE_OF_HEADER, headerArr);
-
-        const BtrfsHeader *fileTreeHeader =
-            new BtrfsHeader(TSK_LIT_ENDIAN, (uint8_t*)headerArr.data());
-
-        //cerr << "DBG: Created Filesystem Tree Header" << endl;
-
-        uint64_t itemOffset = offset + BtrfsHeader::SIZE_OF_HEADER;
-
-        if(fileTreeHeader->isLeafNode()){
-            fileTreeRoot = new LeafNode(examiner->pool, fileTreeHeader, examiner->endian, itemOffset);
-        }
-        else {
-            fileTreeRoot = new InternalNode(examiner->pool, fileTreeHeader, examiner->endian, itemOffset);
-        }
+        fileTreeRoot = readNode(examiner->pool, examiner->endian, offset);
 
         //cerr << "DBG: Created Filesystem Tree Root Node" << endl;
     }
@@ -68,6 +57,8 @@ namespace btrForensics {
     {
         if(fileTreeRoot != nullptr)
             delete fileTreeRoot;
+        if(index != nullptr)
+            delete index;
     }
 
 
@@ -98,13 +89,31 @@ namespace btrForensics {
     const void FilesystemTree::listDirItemsById(uint64_t id, bool dirFlag, bool fileFlag,
         bool recursive, int level, std::ostream& os) const
     {
-
-        //cout << "DBG: ListingDirItemsByID... " << endl;
+        //a recursive listing visits every directory, one pass over all leaves
+        //is cheaper than three tree searches per directory
+        if(recursive || index != nullptr) {
+            const FilesystemIndex* dirIndex = getIndex();
+
+            for(auto &child : dirIndex->getDirEntries(id)) {
+                if(child.targetType != ItemType::INODE_ITEM)
+                    continue;
+                if((fileFlag && child.type == DirItemType::REGULAR_FILE) 
+                        || (dirFlag && child.type == DirItemType::DIRECTORY)) {
+                    if(level!=0) os << string(level, '+') << " ";
+                    os << child.type << '/' << child.type << " ";
+                    ostringstream oss;
+                    oss << dec << child.targetId << ':';
+                    os << setfill(' ') << setw(9) << left << oss.str();
+                    os << " " << dirIndex->getEntryName(child) << endl;
+                }
+                if(recursive && child.type == DirItemType::DIRECTORY) {
+                    listDirItemsById(child.targetId, dirFlag, fileFlag, recursive, level+1, os);
+                }
+            }
+            return;
+        }
 
         DirContent* dir = getDirContent(id);
-
-        //cout << "DBG: Got DirContent... " << endl;
-
         if(dir == nullptr) {
             return;
         }
@@ -121,11 +130,20 @@ namespace btrForensics {
                 os << setfill(' ') << setw(9) << left << oss.str();
                 os << " " << child->getDirName() << endl;
             }
-            if(recursive && child->type == DirItemType::DIRECTORY) {
-                uint64_t newId = child->targetKey.objId;
-                listDirItemsById(newId, dirFlag, fileFlag, recursive, level+1, os);
-            }
         }
+        delete dir;
+    }
+
+
+    //! Get the inode index of this tree, building it on first use.
+    //!
+    //! \return Index shared by later listings and lookups.
+    //!
+    const FilesystemIndex* FilesystemTree::getIndex() const
+    {
+        if(index == nullptr)
+            index = new FilesystemIndex(fileTreeRoot, examiner);
+        return index;
     }
 
 
@@ -135,23 +153,22 @@ namespace btrForensics {
     //!
     DirContent* FilesystemTree::getDirContent(uint64_t id) const
     {
-        const BtrfsItem* foundItem;
-        if(examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::INODE_ITEM, foundItem); })) {
+        NodePins pins;
+        const BtrfsItem* foundItem = examiner->findItem(fileTreeRoot, id, ItemType::INODE_ITEM, &pins);
+        if(foundItem != nullptr) {
             const InodeItem* rootInode = static_cast<const InodeItem*>(foundItem);
 
-            examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::INODE_REF, foundItem); });
+            foundItem = examiner->findItem(fileTreeRoot, id, ItemType::INODE_REF, &pins);
+            if(foundItem == nullptr)
+                return nullptr;
             const InodeRef* rootRef = static_cast<const InodeRef*>(foundItem);
 
             vector<const BtrfsItem*> foundItems;
-            examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItems](const LeafNode* leaf, uint64_t targetId)
-                { return filterItems(leaf, targetId, ItemType::DIR_INDEX, foundItems); });
+            examiner->findItems(fileTreeRoot, id, ItemType::DIR_INDEX, foundItems, &pins);
             
-            return new DirContent(rootInode, rootRef, foundItems);
+            DirContent* dir = new DirContent(rootInode, rootRef, foundItems);
+            dir->pins = std::move(pins);
+            return dir;
         }
         return nullptr;
     }
@@ -252,78 +269,368 @@ namespace btrForensics {
     }
 
     
-    //! Read file content with given inode and save to current directory.
+    //! Write zero bytes for a sparse region without reading anything.
+    //!
+    //! \param count Number of bytes to write.
+    //! \param out Output file.
+    //! \return True if all bytes are written.
+    //!
+    static bool writeZeros(uint64_t count, FILE* out)
+    {
+        static const char zeros[64 * 1024] = {};
+        while(count > 0) {
+            size_t chunk = count < sizeof(zeros) ? count : sizeof(zeros);
+            if(fwrite(zeros, 1, chunk, out) != chunk)
+                return false;
+            count -= chunk;
+        }
+        return true;
+    }
+
+
+    //! Check if an extent holds compressed data that needs decoding.
+    static bool isCompressed(const FilesystemIndex::Extent& extent)
+    {
+        if(extent.compression == 0)
+            return false;
+        return extent.type == 0 || (extent.logicalAddress != 0 && extent.type != 2);
+    }
+
+
+    //! Build the decoder request of a compressed extent.
+    static ExtentDecoder::Request decodeRequest(const FilesystemIndex::Extent& extent)
+    {
+        ExtentDecoder::Request request;
+        request.address = extent.type == 0 ? extent.dataAddress : extent.logicalAddress;
+        request.diskSize = extent.diskSize;
+        request.decodedSize = extent.decodedSize;
+        request.compression = extent.compression;
+        return request;
+    }
+
+
+    //! Read file content with given inode and write it to standard output.
+    //!
+    //! Extents are streamed through one reusable buffer, holes and
+    //! preallocated extents are written as zeros without reading.
+    //! Runs of compressed extents are decoded in parallel ahead of writing.
     //!
     //! \param id Inode number of the file to read.
-    //! \return True if file is all successfully written.
+    //! \return True if file is all successfully read and written.
     //!
     const bool FilesystemTree::readFile(uint64_t id) const
     {
-        const BtrfsItem* foundItem;
-        if(!examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::INODE_ITEM, foundItem); }))
-            return false;
-        const InodeItem* inode = static_cast<const InodeItem*>(foundItem);
-        uint64_t fileSize = inode->getSize();
-            
-        if(!examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::INODE_REF, foundItem); }))
-            return false;
-        const InodeRef* inodeRef = static_cast<const InodeRef*>(foundItem);
-        string fileName = inodeRef->getDirName();
-            
+        uint64_t fileSize;
+        vector<FilesystemIndex::Extent> foundExtents;
 
-        vector<const BtrfsItem*> foundExtents;
-        examiner->treeSearchById(fileTreeRoot, id,
-                [&foundExtents](const LeafNode* leaf, uint64_t targetId)
-                { return filterItems(leaf, targetId, ItemType::EXTENT_DATA, foundExtents); });
+        if(index != nullptr && index->contains(id)) {
+            fileSize = index->getInode(id)->getSize();
+            for(auto &extent : index->getExtents(id))
+                foundExtents.push_back(extent);
+        }
+        else {
+            NodePins pins;
+            const BtrfsItem* foundItem = examiner->findItem(fileTreeRoot, id, ItemType::INODE_ITEM, &pins);
+            if(foundItem == nullptr)
+                return false;
+            const InodeItem* inode = static_cast<const InodeItem*>(foundItem);
+            fileSize = inode->getSize();
+
+            if(examiner->findItem(fileTreeRoot, id, ItemType::INODE_REF, &pins) == nullptr)
+                return false;
+
+            vector<const BtrfsItem*> extentItems;
+            examiner->findItems(fileTreeRoot, id, ItemType::EXTENT_DATA, extentItems, &pins);
+            for(auto item : extentItems)
+                foundExtents.push_back(FilesystemIndex::Extent(static_cast<const ExtentData*>(item)));
+        }
         if(foundExtents.size() < 1)
             return false;
-            
-        uint64_t unreadSize = fileSize;
-        //cerr << "DBG: FILE SIZE: " << unreadSize << endl;
-        BTRFSPhyAddr phyAddr;
-        for(auto extent : foundExtents) {
-            const ExtentData* data = static_cast<const ExtentData*>(extent);
-            if(data->compression + data->encryption + data->otherEncoding != 0)
+
+        FILE* out = stdout;
+        vector<char> buffer;
+        buffer.reserve(READ_BUFFER_SIZE);
+        uint64_t written(0);
+
+        //Decoded compressed extents waiting to be written, by extent index.
+        map<size_t, ExtentDecoder::DecodedExtent> decoded;
+        const size_t decodeBatch = 2 * ThreadPool::shared().size();
+
+        cout.flush();
+        for(size_t i = 0; i < foundExtents.size(); ++i) {
+            const FilesystemIndex::Extent& extent = foundExtents[i];
+            if(written >= fileSize)
+                break;
+            if(extent.encryption + extent.otherEncoding != 0)
+                return false;
+            if(!ExtentDecoder::isSupported(extent.compression))
                 return false;
 
-            //ofstream ofs(fileName, ofstream::app | ofstream::binary);
-            //if(!ofs) return false;
-            if(data->type == 0) { //Is inline file.
-                vector<char> dataArr;
-                examiner->pool->readData(data->dataAddress, fileSize, dataArr);
-                std::copy(dataArr.begin(), dataArr.end(), ostream_iterator<char>(std::cout));
-                //ofs.write(dataArr.data(), fileSize);
-                //ofs.close();
-                return true;
+            ExtentDecoder::DecodedExtent data;
+            if(isCompressed(extent)) {
+                if(decoded.find(i) == decoded.end()) {
+                    //Decode this and the following compressed extents together.
+                    vector<size_t> batch;
+                    vector<ExtentDecoder::Request> requests;
+                    for(size_t j = i; j < foundExtents.size() && batch.size() < decodeBatch; ++j) {
+                        if(!isCompressed(foundExtents[j]))
+                            continue;
+                        batch.push_back(j);
+                        requests.push_back(decodeRequest(foundExtents[j]));
+                    }
+                    vector<ExtentDecoder::DecodedExtent> results = examiner->extentDecoder->decodeAll(requests);
+                    for(size_t k = 0; k < batch.size(); ++k)
+                        decoded[batch[k]] = results[k];
+                }
+                data = decoded[i];
+                decoded.erase(i);
+                if(data == nullptr)
+                    return false;
             }
-            else {
-                vector<char> dataArr;
-                if(unreadSize > data->numOfBytes) {
-                    examiner->pool->readData(data->logicalAddress + data->extentOffset, data->numOfBytes, dataArr);
-                    std::copy(dataArr.begin(), dataArr.end(), ostream_iterator<char>(std::cout));
-                    //ofs.write(dataArr.data(), data->numOfBytes);
-                    unreadSize -= data->numOfBytes;
+
+            if(extent.type == 0) { //Is inline file.
+                uint64_t size = min(extent.decodedSize, fileSize - written);
+                const char* content;
+                if(data != nullptr) {
+                    size = min(size, (uint64_t)data->size());
+                    content = data->data();
                 }
                 else {
-                    examiner->pool->readData(data->logicalAddress + data->extentOffset, unreadSize, dataArr);
-                    std::copy(dataArr.begin(), dataArr.end(), ostream_iterator<char>(std::cout));
-                    //ofs.write(dataArr.data(), unreadSize);
-                    unreadSize = 0;
+                    if(!examiner->pool->readData(extent.dataAddress, size, buffer))
+                        return false;
+                    content = buffer.data();
                 }
-                //ofs.close();
+                if(fwrite(content, 1, size, out) != size)
+                    return false;
+                written += size;
+                continue;
+            }
+
+            //Gap before this extent is a hole.
+            if(extent.fileOffset > written) {
+                uint64_t holeSize = min(extent.fileOffset, fileSize) - written;
+                if(!writeZeros(holeSize, out))
+                    return false;
+                written += holeSize;
+            }
+
+            uint64_t extentSize = min(extent.numOfBytes, fileSize - written);
+            //Logical address 0 marks a hole, type 2 is preallocated but unwritten.
+            if(extent.logicalAddress == 0 || extent.type == 2) {
+                if(!writeZeros(extentSize, out))
+                    return false;
+                written += extentSize;
+                continue;
+            }
+
+            if(data != nullptr) {
+                //Compressed extents are referenced in decoded bytes.
+                if(extent.extentOffset > data->size() || extentSize > data->size() - extent.extentOffset)
+                    return false;
+                if(fwrite(data->data() + extent.extentOffset, 1, extentSize, out) != extentSize)
+                    return false;
+                written += extentSize;
+                continue;
+            }
+
+            uint64_t readAddr = extent.logicalAddress + extent.extentOffset;
+            while(extentSize > 0) {
+                uint64_t chunk = min(extentSize, READ_BUFFER_SIZE);
+                if(!examiner->pool->readData(readAddr, chunk, buffer))
+                    return false;
+                if(fwrite(buffer.data(), 1, chunk, out) != chunk)
+                    return false;
+                readAddr += chunk;
+                extentSize -= chunk;
+                written += chunk;
             }
         }
-        if(unreadSize != 0) {
-            throw FsDamagedException("File extents missing. Written file is incomplete.");
+
+        //Files may end in a hole without an extent item.
+        if(written < fileSize && !writeZeros(fileSize - written, out))
+            return false;
+        fflush(out);
+
+        return true;
+    }
+
+
+    //! Hash the content of a file with POOL_HASH.
+    //!
+    //! The pieces of the file are the ranges of extents it references,
+    //! split into pieces of at most READ_BUFFER_SIZE bytes, and its holes.
+    //! Pieces are memoized by logical address, so extents shared with
+    //! other snapshots are read once. Files with the same size and extent
+    //! items as an already hashed one are not read at all.
+    //!
+    //! \param id Inode number of the file to hash.
+    //! \param hasher Memo of pieces and files hashed so far.
+    //! \param digest Digest of the file.
+    //! \return True if all extents of the file could be read, nothing
+    //! is memoized otherwise.
+    //!
+    const bool FilesystemTree::hashFile(uint64_t id, POOL_HASH& hasher, std::array<uint8_t, 32>& digest) const
+    {
+        const FilesystemIndex* fileIndex = getIndex();
+        if(!fileIndex->contains(id))
+            return false;
+        uint64_t fileSize = fileIndex->getInode(id)->getSize();
+        FilesystemIndex::Span<FilesystemIndex::Extent> foundExtents = fileIndex->getExtents(id);
+
+        vector<uint8_t> layout;
+        auto append = [&layout](uint64_t value) {
+            layout.insert(layout.end(), (uint8_t*)&value, (uint8_t*)&value + sizeof(value));
+        };
+        append(fileSize);
+        for(auto &extent : foundExtents) {
+            append(extent.fileOffset);
+            append(extent.logicalAddress);
+            append(extent.extentOffset);
+            append(extent.numOfBytes);
+            append(extent.dataAddress);
+            append(extent.decodedSize);
+            append(extent.diskSize);
+            append(((uint64_t)extent.type << 32) | ((uint64_t)extent.compression << 24)
+                   | ((uint64_t)extent.encryption << 16) | extent.otherEncoding);
         }
+        POOL_HASH::Digest layoutDigest = POOL_HASH::hashLayout(layout);
+        if(hasher.lookupFile(layoutDigest, digest))
+            return true;
+
+        vector<POOL_HASH::Digest> pieces;
+        auto addZeros = [&](uint64_t count) {
+            while(count > 0) {
+                uint64_t chunk = min(count, READ_BUFFER_SIZE);
+                pieces.push_back(hasher.hashZeros(chunk));
+                count -= chunk;
+            }
+        };
+
+        vector<char> buffer;
+        uint64_t written(0);
+        for(auto &extent : foundExtents) {
+            if(written >= fileSize)
+                break;
+            if(extent.encryption + extent.otherEncoding != 0)
+                return false;
+            if(!ExtentDecoder::isSupported(extent.compression))
+                return false;
+
+            if(extent.type == 0) { //Is inline file.
+                uint64_t size = min(extent.decodedSize, fileSize - written);
+                POOL_HASH::Location location = {{extent.dataAddress, 0, size, 1}};
+                POOL_HASH::Digest piece;
+                if(!hasher.lookupPiece(location, piece)) {
+                    const char* content;
+                    if(isCompressed(extent)) {
+                        ExtentDecoder::DecodedExtent data = examiner->extentDecoder->decode(decodeRequest(extent));
+                        if(data == nullptr || data->size() < size)
+                            return false;
+                        content = data->data();
+                        piece = hasher.hashPiece(content, size);
+                    }
+                    else {
+                        if(!examiner->pool->readData(extent.dataAddress, size, buffer))
+                            return false;
+                        piece = hasher.hashPiece(buffer.data(), size);
+                    }
+                    hasher.insertPiece(location, piece);
+                }
+                pieces.push_back(piece);
+                written += size;
+                continue;
+            }
+
+            //Gap before this extent is a hole.
+            if(extent.fileOffset > written) {
+                uint64_t holeSize = min(extent.fileOffset, fileSize) - written;
+                addZeros(holeSize);
+                written += holeSize;
+            }
+
+            uint64_t extentSize = min(extent.numOfBytes, fileSize - written);
+            //Logical address 0 marks a hole, type 2 is preallocated but unwritten.
+            if(extent.logicalAddress == 0 || extent.type == 2) {
+                addZeros(extentSize);
+                written += extentSize;
+                continue;
+            }
+
+            if(isCompressed(extent)) {
+                POOL_HASH::Location location = {{extent.logicalAddress, extent.extentOffset, extentSize, 2}};
+                POOL_HASH::Digest piece;
+                if(!hasher.lookupPiece(location, piece)) {
+                    ExtentDecoder::DecodedExtent data = examiner->extentDecoder->decode(decodeRequest(extent));
+                    //Compressed extents are referenced in decoded bytes.
+                    if(data == nullptr || extent.extentOffset > data->size()
+                            || extentSize > data->size() - extent.extentOffset)
+                        return false;
+                    piece = hasher.hashPiece(data->data() + extent.extentOffset, extentSize);
+                    hasher.insertPiece(location, piece);
+                }
+                pieces.push_back(piece);
+                written += extentSize;
+                continue;
+            }
+
+            uint64_t readAddr = extent.logicalAddress + extent.extentOffset;
+            while(extentSize > 0) {
+                uint64_t chunk = min(extentSize, READ_BUFFER_SIZE);
+                POOL_HASH::Location location = {{readAddr, 0, chunk, 0}};
+                POOL_HASH::Digest piece;
+                if(!hasher.lookupPiece(location, piece)) {
+                    if(!examiner->pool->readData(readAddr, chunk, buffer))
+                        return false;
+                    piece = hasher.hashPiece(buffer.data(), chunk);
+                    hasher.insertPiece(location, piece);
+                }
+                pieces.push_back(piece);
+                readAddr += chunk;
+                extentSize -= chunk;
+                written += chunk;
+            }
+        }
+
+        //Files may end in a hole without an extent item.
+        if(written < fileSize)
+            addZeros(fileSize - written);
+
+        digest = POOL_HASH::compose(pieces);
+        hasher.insertFile(layoutDigest, digest);
         return true;
     }
 
 
+    //! Hash all regular files below a directory and print their digests.
+    //!
+    //! \param id Id of the directory.
+    //! \param path Path printed in front of the file names.
+    //! \param hasher Memo of pieces and files hashed so far.
+    //! \param os Output stream where the digests are printed.
+    //!
+    const void FilesystemTree::hashFiles(uint64_t id, const std::string& path, POOL_HASH& hasher,
+        std::ostream& os) const
+    {
+        const FilesystemIndex* dirIndex = getIndex();
+
+        for(auto &child : dirIndex->getDirEntries(id)) {
+            if(child.targetType != ItemType::INODE_ITEM)
+                continue;
+            string childPath = path + "/" + dirIndex->getEntryName(child);
+            if(child.type == DirItemType::DIRECTORY) {
+                hashFiles(child.targetId, childPath, hasher, os);
+            }
+            else if(child.type == DirItemType::REGULAR_FILE) {
+                POOL_HASH::Digest digest;
+                if(hashFile(child.targetId, hasher, digest))
+                    os << POOL_HASH::toHex(digest) << "  " << childPath << endl;
+                else
+                    cerr << "Cannot read " << childPath << endl;
+            }
+        }
+    }
+
+
     //! Print infomation about target inode.
     //!
     //! \param id Id of the target inode.
@@ -332,20 +639,31 @@ namespace btrForensics {
     //! 
     const bool FilesystemTree::showInodeInfo(uint64_t id, std::ostream& os) const
     {
-        const BtrfsItem* foundItem;
-        if(!examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::INODE_ITEM, foundItem); }))
-            return false;
-        const InodeItem* inode = static_cast<const InodeItem*>(foundItem);
-        uint64_t size = inode->getSize();
-            
-        if(!examiner->treeSearchById(fileTreeRoot, id,
-                [&foundItem](const LeafNode* leaf, uint64_t targetId)
-                { return searchForItem(leaf, targetId, ItemType::INODE_REF, foundItem); }))
-            return false;
-        const InodeRef* inodeRef = static_cast<const InodeRef*>(foundItem);
-        string name = inodeRef->getDirName();
+        uint64_t size;
+        string name;
+        string times;
+
+        if(index != nullptr && index->contains(id)) {
+            const InodeData* inode = index->getInode(id);
+            size = inode->getSize();
+            name = index->getName(id);
+            times = inode->printTime();
+        }
+        else {
+            NodePins pins;
+            const BtrfsItem* foundItem = examiner->findItem(fileTreeRoot, id, ItemType::INODE_ITEM, &pins);
+            if(foundItem == nullptr)
+                return false;
+            const InodeItem* inode = static_cast<const InodeItem*>(foundItem);
+            size = inode->getSize();
+            times = inode->printTime();
+
+            foundItem = examiner->findItem(fileTreeRoot, id, ItemType::INODE_REF, &pins);
+            if(foundItem == nullptr)
+                return false;
+            const InodeRef* inodeRef = static_cast<const InodeRef*>(foundItem);
+            name = inodeRef->getDirName();
+        }
 
         os << dec;
         os << "Inode number: " << id << endl;
@@ -353,12 +671,7 @@ namespace btrForensics {
         os << "Name: " << name << endl;
 
         os << "\nDirectory Entry Times(local);" << endl;
-        os << inode->printTime() << endl;
-
-        vector<const BtrfsItem*> foundExtents;
-        examiner->treeSearchById(fileTreeRoot, id,
-                                 [&foundExtents](const LeafNode* leaf, uint64_t targetId)
-                                 { return filterItems(leaf, targetId, ItemType::EXTENT_DATA, foundExtents); });
+        os << times << endl;
 
         //TODO: get access to key for correct offset in file?
         uint64_t file_offset = 0;
@@ -372,4 +685,47 @@ namespace btrForensics {
         
         return true;
     }
+
+
+    //! List inodes that differ between this tree and a newer snapshot of it.
+    //!
+    //! Subtrees shared by both snapshots are skipped, so only the
+    //! changed paths of the trees are read.
+    //!
+    //! \param newer File system tree to compare with.
+    //! \param os Output stream where the infomation is printed.
+    //!
+    const void FilesystemTree::showDiff(const FilesystemTree* newer, std::ostream& os) const
+    {
+        //'+' for added, '-' for removed and 'M' for modified inodes.
+        map<uint64_t, char> changes;
+        examiner->treeDiff(fileTreeRoot, newer->fileTreeRoot,
+            [&changes](DiffType type, const BtrfsItem* oldItem, const BtrfsItem* newItem) {
+                const BtrfsKey& key = (newItem != nullptr ? newItem : oldItem)->itemHead->key;
+                if(key.itemType == ItemType::INODE_ITEM && type != DiffType::CHANGED)
+                    changes[key.objId] = (type == DiffType::ADDED ? '+' : '-');
+                else if(changes.find(key.objId) == changes.end())
+                    changes[key.objId] = 'M';
+            });
+
+        NodePins pins;
+        for(auto &change : changes) {
+            const FilesystemTree* tree = (change.second == '-' ? this : newer);
+            //Skip objects that are not inodes, like orphan items.
+            if(examiner->findItem(tree->fileTreeRoot, change.first, ItemType::INODE_ITEM, &pins) == nullptr)
+                continue;
+
+            string name;
+            const BtrfsItem* foundItem = examiner->findItem(tree->fileTreeRoot,
+                    change.first, ItemType::INODE_REF, &pins);
+            if(foundItem != nullptr)
+                name = static_cast<const InodeRef*>(foundItem)->getDirName();
+
+            ostringstream oss;
+            oss << dec << change.first << ':';
+            os << change.second << " " << setfill(' ') << setw(9) << left << oss.str();
+            os << " " << name << endl;
+            pins.clear();
+        }
+    }
 }
@@ -10,10 +10,15 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <array>
 #include <functional>
 #include <tsk/libtsk.h>
 #include "../Basics/Basics.h"
+#include "BtrfsNode.h"
 #include "DirContent.h"
+#include "FilesystemIndex.h"
+
+class POOL_HASH;
 
 namespace btrForensics {
     class TreeExaminer;
@@ -26,6 +31,7 @@ namespace btrForensics {
 
     private:
         const TreeExaminer* examiner;
+        mutable FilesystemIndex* index; //!< Inode index, built on first recursive listing.
 
     public:
         FilesystemTree(const BtrfsNode*, uint64_t rootItemId, const TreeExaminer*);
@@ -36,11 +42,19 @@ namespace btrForensics {
             bool recursive, int level, std::ostream& os) const;
 
         DirContent* getDirContent(uint64_t id) const;
+        const FilesystemIndex* getIndex() const;
+        //! Return true if the inode index has been built.
+        bool hasIndex() const { return index != nullptr; }
 
         const void explorFiles(std::ostream& os, std::istream& is) const;
         
         const bool readFile(uint64_t id) const;
+        const bool hashFile(uint64_t id, POOL_HASH& hasher, std::array<uint8_t, 32>& digest) const;
+        const void hashFiles(uint64_t id, const std::string& path, POOL_HASH& hasher, std::ostream& os) const;
         const bool showInodeInfo(uint64_t id, std::ostream& os) const;
+        const void showDiff(const FilesystemTree* newer, std::ostream& os) const;
+
+        static const uint64_t READ_BUFFER_SIZE = 1024 * 1024; //!< Bytes read at once when extracting files.
     };
 }
 
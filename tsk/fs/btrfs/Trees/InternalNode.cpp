@@ -9,31 +9,26 @@
 #include "../Basics/ChunkData.h"
 
 namespace btrForensics{
-    //! Constructor of btrfs leaf node.
+    //! Constructor of btrfs internal node.
     //!
-    //! \param img Image file.
     //! \param header Pointer to header of a node.
     //! \param endian The endianess of the array.
-    //! \param startOffset Offset of the node, right after header.
+    //! \param nodeData Byte array storing the whole node, header included.
+    //! \param nodeSize Size of the node in bytes.
     //!
-    InternalNode::InternalNode(BTRFS_POOL *pool, const BtrfsHeader *header,
-            TSK_ENDIAN_ENUM endian, uint64_t startOffset, bool cacheInternalNodes)
+    InternalNode::InternalNode(const BtrfsHeader *header, TSK_ENDIAN_ENUM endian,
+            const uint8_t *nodeData, uint32_t nodeSize)
         :BtrfsNode(header)
     {
-        vector<char> diskArr;
-        BTRFSPhyAddr physAddr;
+        const uint8_t *ptrArr = nodeData + BtrfsHeader::SIZE_OF_HEADER;
         uint64_t itemOffset(0);
         uint32_t itemNum = header->getNumOfItems();
 
-        //cerr << "DBG: Creating InternalNode" << endl;
+        if((uint64_t)itemNum * KeyPtr::SIZE_OF_KEY_PTR > nodeSize - BtrfsHeader::SIZE_OF_HEADER)
+            throw FsDamagedException("Internal node key pointer count exceeds node size.");
 
         for(uint32_t i=0; i<itemNum; ++i){
-            /*physAddr = getChunkAddr(startOffset + itemOffset, &chunkKey, &chunkData).at(0);
-            pool->readRawData(physAddr.device, physAddr.offset, KeyPtr::SIZE_OF_KEY_PTR, diskArr);*/
-
-            pool->readData(startOffset + itemOffset, KeyPtr::SIZE_OF_KEY_PTR, diskArr);
-
-            keyPointers.push_back(new KeyPtr(pool, endian, (uint8_t*)diskArr.data(), cacheInternalNodes));
+            keyPointers.push_back(new KeyPtr(endian, (uint8_t*)ptrArr + itemOffset));
 
             itemOffset += KeyPtr::SIZE_OF_KEY_PTR;
         }
@@ -9,7 +9,6 @@
 #include <vector>
 #include <tsk/libtsk.h>
 #include "BtrfsNode.h"
-#include "../../../pool/BTRFS_POOL.h"
 
 using std::vector;
 
@@ -21,7 +20,7 @@ namespace btrForensics{
         vector<KeyPtr*> keyPointers; //!< Key pointers to other nodes.
 
     public:
-        InternalNode(BTRFS_POOL*, const BtrfsHeader*, TSK_ENDIAN_ENUM, uint64_t, bool = false);
+        InternalNode(const BtrfsHeader*, TSK_ENDIAN_ENUM, const uint8_t*, uint32_t);
         ~InternalNode();
 
         const std::string info() const override;
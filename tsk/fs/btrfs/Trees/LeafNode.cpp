@@ -11,71 +11,70 @@
 namespace btrForensics{
     //! Constructor of btrfs leaf node.
     //!
-    //! \param img Image file.
     //! \param header Pointer to header of a node.
     //! \param endian The endianess of the array.
-    //! \param startOffset Offset of the node, right after header.
+    //! \param nodeData Byte array storing the whole node, header included.
+    //! \param nodeSize Size of the node in bytes.
+    //! \param nodeAddr Logical address of the node.
     //!
-    LeafNode::LeafNode(BTRFS_POOL *pool, const BtrfsHeader *header,
-            TSK_ENDIAN_ENUM endian, uint64_t startOffset)
-        :BtrfsNode(header)
+    LeafNode::LeafNode(const BtrfsHeader *header, TSK_ENDIAN_ENUM endian,
+            const uint8_t *nodeData, uint32_t nodeSize, uint64_t nodeAddr)
+        :BtrfsNode(header),
+         itemData(nodeData + BtrfsHeader::SIZE_OF_HEADER, nodeData + nodeSize)
     {
-        char *diskArr;
+        const uint8_t *itemArr = nodeData + BtrfsHeader::SIZE_OF_HEADER;
+        uint64_t itemListSize = nodeSize - BtrfsHeader::SIZE_OF_HEADER;
+        uint64_t startOffset = nodeAddr + BtrfsHeader::SIZE_OF_HEADER;
         uint64_t itemOffset(0);
         uint32_t itemNum = header -> getNumOfItems();
 
-        //cerr << "DBG: Creating LeafNode" << endl;
+        if((uint64_t)itemNum * ItemHead::SIZE_OF_ITEM_HEAD > itemListSize)
+            throw FsDamagedException("Leaf node item count exceeds node size.");
 
-
-        //TODO: can items (metadata in general) span across multiple stripes and thus multiple disks?!
         for(uint32_t i=0; i<itemNum; ++i){
-            vector<char> diskArr;
-            /*BTRFSPhyAddr temp = pool->getPhysicalAddress(startOffset + itemOffset);
-            pool->readRawData(temp.device, temp.offset, ItemHead::SIZE_OF_ITEM_HEAD, diskArr);*/
-
-            pool->readData(startOffset + itemOffset, ItemHead::SIZE_OF_ITEM_HEAD, diskArr);
-
-            ItemHead *itemHead = new ItemHead(endian, (uint8_t*)diskArr.data(),
+            ItemHead *itemHead = new ItemHead(endian, (uint8_t*)itemArr + itemOffset,
                                         startOffset, itemOffset);
 
+            if((uint64_t)itemHead->getDataOffset() + itemHead->getDataSize() > itemListSize) {
+                delete itemHead;
+                for(auto item : itemList)
+                    delete item;
+                throw FsDamagedException("Leaf node item data exceeds node size.");
+            }
+
             BtrfsItem *newItem = nullptr;
-            vector<char> itmArr;
+            uint8_t *itmArr = (uint8_t*)itemArr + itemHead->getDataOffset();
             uint64_t dataOffset = startOffset + itemHead->getDataOffset();
 
-            /*temp = pool->getPhysicalAddress(dataOffset);
-            pool->readRawData(temp.device, temp.offset, itemHead->getDataSize(), itmArr);*/
-
-            pool->readData(dataOffset, itemHead->getDataSize(), itmArr);
-
             switch(itemHead->key.itemType){
                 case ItemType::INODE_ITEM:
-                    newItem = new InodeItem(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new InodeItem(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::INODE_REF:
-                    newItem = new InodeRef(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new InodeRef(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::DIR_ITEM: //Both types use the same structure.
                 case ItemType::DIR_INDEX:
-                    newItem = new DirItem(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new DirItem(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::ROOT_ITEM:
-                    newItem = new RootItem(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new RootItem(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::ROOT_REF: //Both types use the same structure.
                 case ItemType::ROOT_BACKREF:
-                    newItem = new RootRef(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new RootRef(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::CHUNK_ITEM:
-                    newItem = new ChunkItem(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new ChunkItem(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::EXTENT_DATA:
-                    newItem = new ExtentData(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data(), dataOffset);
+                    newItem = new ExtentData(itemHead, TSK_LIT_ENDIAN, itmArr, dataOffset);
                     break;
                 case ItemType::BLOCK_GROUP_ITEM:
-                    newItem = new BlockGroupItem(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new BlockGroupItem(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 case ItemType::EXTENT_ITEM:
-                    newItem = new ExtentItem(itemHead, TSK_LIT_ENDIAN, (uint8_t*)itmArr.data());
+                    newItem = new ExtentItem(itemHead, TSK_LIT_ENDIAN, itmArr);
                     break;
                 default:
                     newItem = new UnknownItem(itemHead);
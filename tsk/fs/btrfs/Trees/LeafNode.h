@@ -19,12 +19,19 @@ namespace btrForensics{
     class LeafNode : public BtrfsNode {
     public:
         vector<const BtrfsItem*> itemList; //!< Stores items and their data.
+        vector<uint8_t> itemData; //!< Verified bytes of the node following the header.
 
     public:
-        LeafNode(BTRFS_POOL*, const BtrfsHeader*, TSK_ENDIAN_ENUM, uint64_t);
+        LeafNode(const BtrfsHeader*, TSK_ENDIAN_ENUM, const uint8_t*, uint32_t, uint64_t);
         ~LeafNode();
 
         const std::string info() const override;
+
+        //! Return raw data of an item of this leaf.
+        const uint8_t* getItemData(const BtrfsItem* item) const
+        {
+            return itemData.data() + item->itemHead->getDataOffset();
+        }
     };
 }
 
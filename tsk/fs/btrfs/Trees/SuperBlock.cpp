@@ -167,6 +167,40 @@ namespace btrForensics{
     }
 
 
+    //! Get root tree root address as of a generation.
+    //!
+    //! \param rootGeneration Generation of the superblock or of one of its backup roots.
+    //! \return Root tree root logical address, 0 if no root of this generation is kept.
+    //!
+    const uint64_t SuperBlock::getRootLogAddr(uint64_t rootGeneration) const
+    {
+        if(rootGeneration == generation)
+            return rootTrRootAddr;
+        for(int i=0; i < BTRFS_NUM_BACKUP_ROOTS; i++){
+            if(backupRoots[i].tree_root_gen == rootGeneration)
+                return backupRoots[i].tree_root;
+        }
+        return 0;
+    }
+
+
+    //! Get chunk tree root address as of a generation of the root tree.
+    //!
+    //! \param rootGeneration Generation of the superblock or of one of its backup roots.
+    //! \return Chunk tree root logical address, 0 if no root of this generation is kept.
+    //!
+    const uint64_t SuperBlock::getChunkLogAddr(uint64_t rootGeneration) const
+    {
+        if(rootGeneration == generation)
+            return chunkTrRootAddr;
+        for(int i=0; i < BTRFS_NUM_BACKUP_ROOTS; i++){
+            if(backupRoots[i].tree_root_gen == rootGeneration)
+                return backupRoots[i].chunk_root;
+        }
+        return 0;
+    }
+
+
     //! Get magic words of btrfs system.
     const std::string SuperBlock::printMagic() const
     {
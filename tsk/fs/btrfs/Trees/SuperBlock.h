@@ -72,9 +72,15 @@ namespace btrForensics{
 
         const std::vector<BTRFSPhyAddr> getChunkPhyAddr() const;
         const uint64_t getRootLogAddr() const;
+        const uint64_t getRootLogAddr(uint64_t rootGeneration) const;
+        const uint64_t getGeneration() const { return generation; } //!< Return generation of the last commit.
         const uint64_t getNumDevices(){ return this->numDevices;};
         const uint64_t getChunkLogAddr() const { return chunkTrRootAddr;};
+        const uint64_t getChunkLogAddr(uint64_t rootGeneration) const;
         const uint32_t getStripeSize() { return this->stripeSize;};
+        const uint32_t getNodeSize() const { return nodeSize; } //!< Return size of a tree node in bytes.
+        const uint32_t getSectorSize() const { return sectorSize; } //!< Return size of a data sector in bytes.
+        const uint16_t getCsumType() const { return csumType; } //!< Return checksum algorithm, 0 is crc32c.
         const uint32_t getSysChunkSize() { return this->chunkData.size();};
 
         const ChunkData getChunkData() { return this->chunkData.at(0);};
@@ -11,6 +11,7 @@
 #include "DirContent.h"
 
 #include "ChunkTree.h"
+#include "FilesystemIndex.h"
 #include "FilesystemTree.h"
 
 #endif
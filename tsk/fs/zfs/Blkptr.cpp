@@ -11,117 +11,198 @@
  * Describes the Blkptr object in ZFS
  */
 
+#include <cstring>
 #include "Blkptr.h"
 #include "pool/ZFS_POOL.h"
+#include "ZFS_Structures.h"
+#include "utils/Checksum.h"
+#include "Compression.h"
+#include <algorithm>
 
+/*
+ * Empty block pointer, as for a hole.
+ */
+Blkptr::Blkptr()
+        : pool(nullptr), endian(TSK_LIT_ENDIAN), dataAvailable(false) {
+    memset(raw, 0, sizeof(raw));
+}
+
+/*
+ * Parse a block pointer. No data is read here, the checksum is verified
+ * when the block is read. Throws for holes and for block pointers whose
+ * checksum type cannot be verified.
+ */
 Blkptr::Blkptr(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool)
-        : blk_lsize(0), blk_psize(0), blk_compression(0), blk_checksum_type(0), embedded(0), endian(endian),
-          pool(pool), ownData() {
-    //TODO: store number of dvs (compare to 0:0?)
-    dataAvailable = false;
-    blk_dva[0].vdev = read32Bit(endian, data + 0x04);
-    blk_dva[0].offset = read64Bit(endian, data + 0x08) << 9;
-    blk_dva[1].vdev = read32Bit(endian, data + 0x14);
-    blk_dva[1].offset = read64Bit(endian, data + 0x18) << 9;
-    blk_dva[2].vdev = read32Bit(endian, data + 0x24);
-    blk_dva[2].offset = read64Bit(endian, data + 0x28) << 9;
-    blk_lsize = (uint64_t) (read16Bit(endian, data + 0x30) + 1) * 512;
-    blk_psize = (uint64_t) (read16Bit(endian, data + 0x32) + 1) * 512;
-    blk_asize = (uint64_t) (read64Bit(endian, data + 0x00));
-    blk_asize = blk_asize & 0xffffff;
-    blk_asize = (blk_asize + 1) * 512;
-    blk_checksum[0] = read64Bit(endian, data + 0x60);
-    blk_checksum[1] = read64Bit(endian, data + 0x68);
-    blk_checksum[2] = read64Bit(endian, data + 0x70);
-    blk_checksum[3] = read64Bit(endian, data + 0x78);
-    blk_compression = data[52];
-    blk_compression &= ~(1 << 7);
-    blk_checksum_type = (uint8_t) data[53];
-
-    embedded = (uint8_t) ((data[52] >> 7) & (uint8_t) 1);
-
-    if (embedded) {
-        ownData.insert(ownData.end(), data, data + 128);
+        : pool(pool), endian((uint8_t) endian), dataAvailable(false) {
+    memcpy(raw, data, sizeof(raw));
+
+    if (isEmbedded()) {
         dataAvailable = true;
-    } else {
-       //check if block pointer points to available top-level vdev
-        for(int i = 0; i < 3; i++){
-            if(pool->getVdevByID(blk_dva[i].vdev) != nullptr){
-                dataAvailable = true;
-                break;
-            }
-        }     
+        return;
     }
 
-    if(dataAvailable || (blk_checksum[0] == 0 && blk_checksum[1] == 0 && blk_checksum[2] == 0 && blk_checksum[3] == 0)){ 
-        if (!checkChecksum()) {
-            throw (0);
+    //check if block pointer points to available top-level vdev
+    for(int i = 0; i < 3; i++){
+        dva copy = getDVA(i);
+        if(copy.asize != 0 && pool->getVdevByID(copy.vdev) != nullptr){
+            dataAvailable = true;
+            break;
         }
     }
+
+    bool emptyChecksum = (getChecksum(0) == 0 && getChecksum(1) == 0 && getChecksum(2) == 0 && getChecksum(3) == 0);
+    if (emptyChecksum || (dataAvailable && !checksumSupported())) {
+        throw (0);
+    }
+}
+
+uint64_t Blkptr::word(int offset) const {
+    return read64Bit((TSK_ENDIAN_ENUM) endian, raw + offset);
+}
+
+dva Blkptr::getDVA(int i) const {
+    dva copy;
+    uint64_t first = word(0x10 * i);
+    copy.vdev = read32Bit((TSK_ENDIAN_ENUM) endian, raw + 0x10 * i + 0x04);
+    copy.offset = word(0x10 * i + 0x08) << 9;
+    copy.asize = ((first & 0xffffff) + 1) * 512;
+    //a DVA word of zero is an unused copy
+    if (first == 0 && copy.offset == 0)
+        copy.asize = 0;
+    return copy;
+}
+
+/*
+ * Embedded block pointers store both sizes in bytes: 25 bits of logical
+ * and 7 bits of physical size, each minus one.
+ */
+uint64_t Blkptr::getLsize() const {
+    if (isEmbedded())
+        return (word(0x30) & 0x1ffffff) + 1;
+    return (uint64_t) (read16Bit((TSK_ENDIAN_ENUM) endian, raw + 0x30) + 1) * 512;
+}
+
+uint64_t Blkptr::getPsize() const {
+    if (isEmbedded())
+        return ((word(0x30) >> 25) & 0x7f) + 1;
+    return (uint64_t) (read16Bit((TSK_ENDIAN_ENUM) endian, raw + 0x32) + 1) * 512;
+}
+
+/*
+ * Indirect blocks and blocks of all objects other than file and volume
+ * contents describe the pool structure.
+ */
+bool Blkptr::isMetadata() const {
+    return getLevel() > 0 || (raw[54] != DMU_OT_PLAIN_FILE_CONTENTS && raw[54] != DMU_OT_ZVOL);
+}
+
+/*
+ * Checksum algorithms block data can be verified with. "on" stands for
+ * fletcher-4, the default of all pool versions this code reads.
+ */
+bool Blkptr::checksumSupported() const {
+    switch (getChecksumType()) {
+        case ZIO_CHECKSUM_ON:
+        case ZIO_CHECKSUM_FLETCHER_2:
+        case ZIO_CHECKSUM_FLETCHER_4:
+        case ZIO_CHECKSUM_SHA256:
+            return true;
+        default:
+            return false;
+    }
 }
 
-bool Blkptr::checkChecksum() {
-    if (embedded)
+/*
+ * Compare the checksum of the physical (not decompressed) block data
+ * with the one stored in the block pointer.
+ */
+bool Blkptr::checksumMatches(const std::vector<char> &physicalData) const {
+    if (isEmbedded())
         return true;
 
-    //TODO: Add other checksum types
-    if (blk_checksum_type == 7) {
-        std::vector<char> dataVector;
-        getData(dataVector, 1, false);
-        blk_calculated_checksum[0] = 0;
-        blk_calculated_checksum[1] = 0;
-        blk_calculated_checksum[2] = 0;
-        blk_calculated_checksum[3] = 0;
-        fletcher_4_native((uint8_t *) &dataVector[0], dataVector.size(), this->blk_calculated_checksum);
-    } else {
+    uint64_t psize = getPsize();
+    if (physicalData.size() < psize)
         return false;
+
+    const uint8_t *data = (const uint8_t *) physicalData.data();
+    uint64_t calculated[4] = {0, 0, 0, 0};
+    switch (getChecksumType()) {
+        case ZIO_CHECKSUM_ON:
+        case ZIO_CHECKSUM_FLETCHER_4:
+            fletcher_4(data, psize, calculated);
+            break;
+        case ZIO_CHECKSUM_FLETCHER_2:
+            fletcher_2(data, psize, calculated);
+            break;
+        case ZIO_CHECKSUM_SHA256: {
+            //the digest is stored as four big endian words
+            uint8_t digest[32];
+            sha256(data, psize, digest);
+            for (int i = 0; i < 4; ++i)
+                calculated[i] = read64Bit(TSK_BIG_ENDIAN, digest + 8 * i);
+            break;
+        }
+        default:
+            return false;
     }
 
     for (int i = 0; i < 4; ++i) {
-        if (blk_checksum[i] != blk_calculated_checksum[i])
+        if (getChecksum(i) != calculated[i])
             return false;
     }
 
     return true;
 }
 
+/*
+ * Read the block and check its checksum, unless a verified copy of it is
+ * already in the block cache of the pool.
+ */
+bool Blkptr::verify() const {
+    if (isEmbedded() || !dataAvailable || pool->isCached(this))
+        return true;
+
+    std::vector<char> dataVector;
+    return pool->readData(this, dataVector, false);
+}
+
 //if level == 1: don't go for indirect blocks
-void Blkptr::getData(std::vector<char> &dataVector, int level, bool decompress) {
-    //TODO: Support for not compressed embedded blockpointers!!!
-    if (embedded) {
+//throws if no copy of the block matches its checksum
+void Blkptr::getData(std::vector<char> &dataVector, int level, bool decompress) const {
+    if (isEmbedded()) {
+        //the payload fills the block pointer except for its properties and birth TXG
         std::vector<char> payload;
-        uint32_t payloadLength = read32Bit(TSK_BIG_ENDIAN, (uint8_t *) &this->ownData[0]) + 4;
-        payload.insert(payload.end(), &this->ownData[0], &this->ownData[0] + 48);
-        payload.insert(payload.end(), &this->ownData[0] + 56, &this->ownData[0] + 80);
-        payload.insert(payload.end(), &this->ownData[0] + 88, &this->ownData[0] + 128);
-        payload.resize(payloadLength);
-
-        //TODO: Embedded decompressed always decompress logical size of 512 bytes?
-        if ((payloadLength != 512)) {
-            vector<char> decompressedData(512);
-            LZ4_decompress_safe(&payload[0] + 4, decompressedData.data(), payloadLength - 4, 512);
-            dataVector.insert(dataVector.end(), decompressedData.data(), decompressedData.data() + 512);
-        } else {
-            dataVector.insert(dataVector.end(), payload.data(), payload.data() + 512);
+        payload.insert(payload.end(), raw, raw + 48);
+        payload.insert(payload.end(), raw + 56, raw + 80);
+        payload.insert(payload.end(), raw + 88, raw + 128);
+        payload.resize(std::min<uint64_t>(getPsize(), payload.size()));
+
+        uint64_t lsize = getLsize();
+        size_t start = dataVector.size();
+        dataVector.resize(start + lsize);
+        if (!zioDecompress(getCompression(), (uint8_t *) payload.data(), payload.size(),
+                           (uint8_t *) dataVector.data() + start, lsize)) {
+            dataVector.resize(start);
+            throw (0);
         }
 
     } else {
         vector<char> diskData;
-        pool->readData(this, diskData, decompress);
+        if (!pool->readData(this, diskData, decompress)) {
+            throw (0);
+        }
 
         if (level == 1) {   //direct block pointer
             if (decompress) {
-                dataVector.insert(dataVector.end(), diskData.data(), diskData.data() + this->blk_lsize);
+                dataVector.insert(dataVector.end(), diskData.data(), diskData.data() + getLsize());
             } else {
-                dataVector.insert(dataVector.end(), diskData.data(), diskData.data() + this->blk_psize);
+                dataVector.insert(dataVector.end(), diskData.data(), diskData.data() + getPsize());
             }
         } else {  //indirect block pointer
-            Blkptr *temp = nullptr;
-            for (int i = 0; i < (this->blk_lsize / 128); i++) {
+            for (uint64_t i = 0; i < (getLsize() / 128); i++) {
                 try {
-                    temp = new Blkptr(this->endian, (uint8_t *) diskData.data() + 128 * i, this->pool);
-                    temp->getData(dataVector, level - 1);
-                    delete temp;
+                    Blkptr temp((TSK_ENDIAN_ENUM) this->endian, (uint8_t *) diskData.data() + 128 * i, this->pool);
+                    temp.getData(dataVector, level - 1);
                 }
                 catch (...) {
                     continue;
@@ -131,7 +212,7 @@ void Blkptr::getData(std::vector<char> &dataVector, int level, bool decompress)
     }
 }
 
-stringstream Blkptr::level0Blocks(int level) {
+stringstream Blkptr::level0Blocks(int level) const {
     std::stringstream stream;
     vector<char> diskData;
     if (level == 1) {
@@ -142,16 +223,17 @@ stringstream Blkptr::level0Blocks(int level) {
         }
 
         for(int i = 0; i < 3; i++){
-            stream << setw(2) << right << this->blk_dva[i].vdev << " : " << hex << setw(10) << left << this->blk_dva[i].offset << "\t|\t";
+            dva copy = getDVA(i);
+            stream << setw(2) << right << copy.vdev << " : " << hex << setw(10) << left << copy.offset << "\t|\t";
         }
-        stream << this->blk_lsize
-               << " / " << this->blk_psize << dec << endl;
+        stream << getLsize()
+               << " / " << getPsize() << dec << endl;
 
     } else {
         pool->readData(this, diskData);
-        for (int i = 0; i < (this->blk_lsize / 128); i++) {
+        for (uint64_t i = 0; i < (getLsize() / 128); i++) {
             try {
-                Blkptr temp(this->endian, (uint8_t *) diskData.data() + 128 * i, this->pool);
+                Blkptr temp((TSK_ENDIAN_ENUM) this->endian, (uint8_t *) diskData.data() + 128 * i, this->pool);
                 stream << temp.level0Blocks(level - 1).str();
             }
             catch (...) {
@@ -163,7 +245,7 @@ stringstream Blkptr::level0Blocks(int level) {
 }
 
 ostream &operator<<(ostream &os, const Blkptr &blkptr) {
-    if (blkptr.embedded)
+    if (blkptr.isEmbedded())
         os << "Embedded Blockpointer" << endl;
     else {
         os << "DVA[0]:\t" << hex << blkptr.getDVA(0).vdev << " : " << blkptr.getDVA(0).offset << "\tDVA[1]:\t"
@@ -171,8 +253,8 @@ ostream &operator<<(ostream &os, const Blkptr &blkptr) {
            << "\tDVA[2]:\t" << blkptr.getDVA(2).vdev << " : " << blkptr.getDVA(2).offset << dec << endl;
         os << "Logical Size:\t" << blkptr.getLsize() << " bytes\t Physical Size:\t" << blkptr.getPsize() << " bytes"
            << endl;
-        os << hex << blkptr.blk_checksum[0] << ":" << blkptr.blk_checksum[1] << ":" << blkptr.blk_checksum[2] << ":"
-           << blkptr.blk_checksum[3] << endl;
+        os << hex << blkptr.getChecksum(0) << ":" << blkptr.getChecksum(1) << ":" << blkptr.getChecksum(2) << ":"
+           << blkptr.getChecksum(3) << dec << endl;
     }
 
     return os;
@@ -27,36 +27,46 @@
 #include "Structs.h"
 
 class ZFS_POOL;
+
+/**
+ * Block pointer kept as its 128 on-disk bytes. Fields are decoded when
+ * they are asked for, so a block pointer needs no memory of its own
+ * beyond that and can be stored inline in the object that holds it.
+ */
 class Blkptr{
 
 private:
-    dva blk_dva[3];
-    uint64_t blk_lsize;
-    uint64_t blk_psize;
-    uint64_t blk_asize;
-    uint8_t blk_compression;
-    uint64_t blk_checksum[4];
-    uint8_t blk_checksum_type;
-    uint64_t embedded;
-    TSK_ENDIAN_ENUM endian;
+    uint8_t raw[128];
     ZFS_POOL* pool;
-    uint64_t blk_calculated_checksum[4];
-    std::vector<char> ownData;
+    uint8_t endian;
     bool dataAvailable;
 
-    bool checkChecksum();
+    uint64_t word(int offset) const;
 
 public:
+    Blkptr();
     Blkptr(TSK_ENDIAN_ENUM endian, uint8_t data[], ZFS_POOL* pool);
     ~Blkptr() = default;
 
-    void getData(std::vector<char>& dataVector, int level=1, bool decompress=true);
-    std::stringstream level0Blocks(int level);
+    void getData(std::vector<char>& dataVector, int level=1, bool decompress=true) const;
+    bool verify() const;
+    bool checksumMatches(const std::vector<char>& physicalData) const;
+    bool checksumSupported() const;
+    std::stringstream level0Blocks(int level) const;
 
     friend std::ostream& operator<<(std::ostream& os, const Blkptr& blkptr);
-    dva getDVA(int i)const {return this->blk_dva[i];}
-    uint64_t getLsize()const {return this->blk_lsize;}
-    uint64_t getPsize()const {return this->blk_psize;}
+    dva getDVA(int i)const;
+    uint64_t getLsize()const;
+    uint64_t getPsize()const;
+    uint64_t getChecksum(int i)const {return word(0x60 + 8 * i);}
+    uint8_t getChecksumType()const {return raw[53];}
+    uint8_t getCompression()const {return raw[52] & 0x7f;}
+    uint64_t getBirthTXG()const {return word(0x50);}
+    uint8_t getLevel()const {return raw[55] & 0x1f;}
+    uint8_t getType()const {return raw[54];}
+    bool isEmbedded()const {return (raw[52] >> 7) & 1;}
+    bool isMetadata()const;
+    const uint8_t* getRaw()const {return raw;}
 
 };
 
@@ -0,0 +1,102 @@
+/*
+ * Catalog.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Catalog.cpp
+ * Describes the datasets of a ZFS pool as of one uberblock
+ */
+
+#include "Catalog.h"
+#include "ObjectSet.h"
+#include "Dnode.h"
+#include "Uberblock.h"
+#include "ZFS_Functions.h"
+#include "../../pool/ZFS_POOL.h"
+
+using namespace std;
+
+Catalog::Catalog(ZFS_POOL *pool, Uberblock *uberblock)
+        : pool(pool), txg(uberblock->getTXG()), MOS(nullptr), rootDatasetDirectoryID(0), datasets(), snapshots(),
+          objectSets() {
+    MOS = pool->getMOS(uberblock);
+    rootDatasetDirectoryID = getRootdatasetDirectoryID(MOS);
+    datasets = pool->getDatasets(MOS);
+}
+
+/*
+ * Snapshots of a dataset, read on first use.
+ */
+const std::map<string, uint64_t> &Catalog::getSnapshots(uint64_t datasetDirectoryID) {
+    auto found = snapshots.find(datasetDirectoryID);
+    if (found != snapshots.end())
+        return found->second;
+
+    std::map<string, uint64_t> &datasetSnapshots = snapshots[datasetDirectoryID];
+    ::getSnapshots(MOS, datasetDirectoryID, &datasetSnapshots);
+    return datasetSnapshots;
+}
+
+/*
+ * Object set of a dataset or snapshot, opened on first use.
+ * Returns nullptr if it cannot be opened.
+ */
+ObjectSet *Catalog::getObjectSet(uint64_t datasetID) {
+    auto found = objectSets.find(datasetID);
+    if (found != objectSets.end())
+        return found->second;
+
+    ObjectSet *objectSet = nullptr;
+    Dnode *dataset = MOS->getDnode(datasetID);
+    if (dataset != nullptr) {
+        try {
+            objectSet = pool->getObjectSetFromDnode(dataset);
+        }
+        catch (...) {
+            objectSet = nullptr;
+        }
+    }
+    objectSets[datasetID] = objectSet;
+    return objectSet;
+}
+
+/*
+ * Dataset object of a name given as "dataset" or "dataset@snapshot".
+ * Returns 0 and reports the reason if there is none.
+ */
+uint64_t Catalog::findDataset(string name) {
+    string snapshot = "";
+    bool isSnapshot = (name.find('@') != string::npos);
+    if (isSnapshot) {
+        snapshot = name.substr(name.find('@') + 1);
+        name = name.substr(0, name.find('@'));
+    }
+
+    auto dataset = datasets.find(name);
+    if (dataset == datasets.end()) {
+        cerr << "No dataset named " << name << " found!" << endl;
+        return 0;
+    }
+
+    if (!isSnapshot)
+        return getHeaddatasetID(MOS, dataset->second);
+
+    const std::map<string, uint64_t> &datasetSnapshots = getSnapshots(dataset->second);
+    auto found = datasetSnapshots.find(snapshot);
+    if (found == datasetSnapshots.end()) {
+        cerr << "Dataset " << name << " does not have a snapshot named " << snapshot << "!" << endl;
+        return 0;
+    }
+    return found->second;
+}
+
+Catalog::~Catalog() {
+    for (auto &it : objectSets) {
+        delete it.second;
+    }
+    delete MOS;
+}
@@ -0,0 +1,56 @@
+/*
+ * Catalog.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Catalog.h
+ * Describes the datasets of a ZFS pool as of one uberblock
+ */
+
+#ifndef ZFS_FTK_CATALOG_H
+#define ZFS_FTK_CATALOG_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tsk/libtsk.h>
+
+class ZFS_POOL;
+class Uberblock;
+class ObjectSet;
+
+/**
+ * The MOS, the names of the datasets and snapshots and the object sets
+ * opened from them, for one TXG. Built on first use by the pool and kept
+ * until the pool invalidates it, so repeated queries against the same
+ * TXG do not walk down from the uberblock again.
+ */
+class Catalog{
+
+private:
+    ZFS_POOL* pool;
+    uint64_t txg;
+    ObjectSet* MOS;
+    uint64_t rootDatasetDirectoryID;
+    std::map<std::string, uint64_t> datasets;                       // dataset name -> dataset directory
+    std::map<uint64_t, std::map<std::string, uint64_t>> snapshots;  // dataset directory -> snapshot name -> dataset
+    std::map<uint64_t, ObjectSet*> objectSets;                      // dataset -> its object set
+
+public:
+    Catalog(ZFS_POOL* pool, Uberblock* uberblock);
+    ~Catalog();
+
+    uint64_t getTXG() const { return txg; }
+    ObjectSet* getMOS() const { return MOS; }
+    uint64_t getRootDatasetDirectoryID() const { return rootDatasetDirectoryID; }
+    const std::map<std::string, uint64_t>& getDatasets() const { return datasets; }
+    const std::map<std::string, uint64_t>& getSnapshots(uint64_t datasetDirectoryID);
+    ObjectSet* getObjectSet(uint64_t datasetID);
+    uint64_t findDataset(std::string name);
+};
+
+#endif //ZFS_FTK_CATALOG_H
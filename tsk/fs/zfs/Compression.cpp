@@ -0,0 +1,108 @@
+/*
+ * Compression.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Compression.cpp
+ * Decompression of ZFS blocks by the algorithm named in their block pointer
+ */
+
+#include "Compression.h"
+#include "Structs.h"
+#include "utils/Decompress.h"
+#include "utils/ReadInt.h"
+#include "utils/lz4.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    typedef bool (*DecompressFunc)(const uint8_t*, size_t, uint8_t*, size_t, size_t*);
+
+    bool copyDecompress(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, size_t *outLen) {
+        *outLen = std::min(srcLen, dstLen);
+        memcpy(dst, src, *outLen);
+        return true;
+    }
+
+    bool emptyDecompress(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, size_t *outLen) {
+        memset(dst, 0, dstLen);
+        *outLen = dstLen;
+        return true;
+    }
+
+    //ZFS puts the length of the LZ4 block in front of it, big endian
+    bool lz4Decompress(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, size_t *outLen) {
+        *outLen = 0;
+        if (srcLen < 4)
+            return false;
+        uint32_t length = read32Bit(TSK_BIG_ENDIAN, src);
+        if (length > srcLen - 4)
+            return false;
+        int produced = LZ4_decompress_safe((const char *) src + 4, (char *) dst, length, dstLen);
+        if (produced < 0)
+            return false;
+        *outLen = produced;
+        return true;
+    }
+
+    //the zstd frame follows its length (big endian) and the version and level it was written with
+    bool zfsZstdDecompress(const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen, size_t *outLen) {
+        *outLen = 0;
+        if (srcLen < 8)
+            return false;
+        uint32_t length = read32Bit(TSK_BIG_ENDIAN, src);
+        if (length > srcLen - 8)
+            return false;
+        return zstdDecompress(src + 8, length, dst, dstLen, outLen);
+    }
+
+    struct Algorithm {
+        const char *name;
+        DecompressFunc decompress;
+    };
+
+    //indexed by enum zio_compress; "on" in a block pointer is the original default, lzjb
+    const Algorithm ALGORITHMS[ZIO_COMPRESS_FUNCTIONS] = {
+        {"inherit", nullptr},
+        {"on", lzjbDecompress},
+        {"off", copyDecompress},
+        {"lzjb", lzjbDecompress},
+        {"empty", emptyDecompress},
+        {"gzip-1", zlibDecompress},
+        {"gzip-2", zlibDecompress},
+        {"gzip-3", zlibDecompress},
+        {"gzip-4", zlibDecompress},
+        {"gzip-5", zlibDecompress},
+        {"gzip-6", zlibDecompress},
+        {"gzip-7", zlibDecompress},
+        {"gzip-8", zlibDecompress},
+        {"gzip-9", zlibDecompress},
+        {"zle", zleDecompress},
+        {"lz4", lz4Decompress},
+        {"zstd", zfsZstdDecompress},
+    };
+}
+
+bool zioDecompress(uint8_t compression, const uint8_t *src, size_t srcLen, uint8_t *dst, size_t dstLen) {
+    if (compression >= ZIO_COMPRESS_FUNCTIONS || ALGORITHMS[compression].decompress == nullptr)
+        return false;
+
+    size_t produced = 0;
+    if (!ALGORITHMS[compression].decompress(src, srcLen, dst, dstLen, &produced))
+        return false;
+
+    //a block may decompress to less than its logical size, the rest reads as zeros
+    if (produced < dstLen)
+        memset(dst + produced, 0, dstLen - produced);
+    return true;
+}
+
+const char *zioCompressionName(uint8_t compression) {
+    if (compression >= ZIO_COMPRESS_FUNCTIONS)
+        return "unknown";
+    return ALGORITHMS[compression].name;
+}
@@ -0,0 +1,29 @@
+/*
+ * Compression.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Compression.h
+ * Decompression of ZFS blocks by the algorithm named in their block pointer
+ */
+
+#ifndef ZFS_FTK_COMPRESSION_H
+#define ZFS_FTK_COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Decompress srcLen bytes of physical block data into the dstLen bytes of
+ * logical data, using the algorithm with the given enum zio_compress ID.
+ * Returns false for unknown algorithms, algorithms missing in this build
+ * and corrupt input.
+ */
+bool zioDecompress(uint8_t compression, const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen);
+const char* zioCompressionName(uint8_t compression);
+
+#endif //ZFS_FTK_COMPRESSION_H
@@ -11,18 +11,29 @@
  * Describes the Dnode object in ZFS
  */
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
 #include "Dnode.h"
+#include "../../utils/ThreadPool.h"
+
+//a block pointer is 128 bytes
+static const int BLKPTR_SHIFT = 7;
 
 Dnode::Dnode(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool)
-        : dn_bonus_blkptr(nullptr), dn_blkptr(), dn_bonuslen(0), dn_bonustype(0), dn_nblkptr(0), dn_nlevels(0),
-          dn_type(DMU_OT_NONE),
-          endian(endian), pool(pool),
-          dn_bonus() {
+        : dn_type(DMU_OT_NONE), dn_indblkshift(0), dn_nlevels(0), dn_nblkptr(0), dn_bonustype(0), dn_datablkszsec(0),
+          dn_bonuslen(0), dn_validblkptrs(0), dn_maxblkid(0), dn_blkptr(), dn_moreblkptrs(), dn_bonus_blkptr(),
+          endian(endian), pool(pool) {
+    memset(&dn_bonus, 0, sizeof(dn_bonus));
     dn_type = static_cast<dmu_object_type_t>((uint8_t) data[0]);
+    dn_indblkshift = (uint8_t) data[1];
     dn_nlevels = (uint8_t) data[2];
     dn_nblkptr = (uint8_t) data[3];
     dn_bonustype = (uint8_t) data[4];
+    dn_datablkszsec = read16Bit(endian, data + 8);
     dn_bonuslen = read16Bit(endian, data + 10);
+    dn_maxblkid = read64Bit(endian, data + 16);
 
     //not a valid dnode => throw exception
     if ((this->dn_nlevels > 8) || (dn_nlevels == 0) || (dn_nblkptr > 3)) {
@@ -30,14 +41,23 @@ Dnode::Dnode(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool)
     }
 
     //store all valid block pointers
+    if (dn_nblkptr > 1)
+        dn_moreblkptrs.reset(new Blkptr[dn_nblkptr - 1]);
     for (int i = 0; i < dn_nblkptr; ++i) {
         try {
-            dn_blkptr.push_back(new Blkptr(endian, data + 64 + (i * 128), pool));
+            Blkptr blkptr(endian, data + 64 + (i * 128), pool);
+            if (i == 0)
+                dn_blkptr = blkptr;
+            else
+                dn_moreblkptrs[i - 1] = blkptr;
+            dn_validblkptrs++;
         }
         catch (...) {
             break;
         }
     }
+    if (dn_validblkptrs < 2)
+        dn_moreblkptrs.reset();
 
     //check and create bonus member
     if (dn_bonuslen > 0) {
@@ -45,112 +65,220 @@ Dnode::Dnode(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool)
     }
 }
 
+const Blkptr *Dnode::getBlkptr(uint64_t i) const {
+    if (i >= dn_validblkptrs)
+        return nullptr;
+    return i == 0 ? &dn_blkptr : &dn_moreblkptrs[i - 1];
+}
+
 void Dnode::getData(std::vector<char> &data) {
-    if ((dn_type == DMU_OT_DSL_DATASET) && (dn_blkptr.size() == 0)) {
-        if (dn_bonus_blkptr != nullptr) {
+    if ((dn_type == DMU_OT_DSL_DATASET) && (dn_validblkptrs == 0)) {
+        if (dn_bonus_blkptr) {
             dn_bonus_blkptr->getData(data);
         }
     } else {
-        for (auto &it : dn_blkptr) {
-            it->getData(data, dn_nlevels);
+        for (int i = 0; i < dn_validblkptrs; ++i) {
+            try {
+                getBlkptr(i)->getData(data, dn_nlevels);
+            }
+            catch (...) {
+                //no copy of the block matches its checksum
+                continue;
+            }
+        }
+    }
+}
+
+/*
+ * Read the level 0 block with the given block ID, descending one indirect
+ * block per level. Only the blocks on the path to it are read.
+ * Returns false if the block is a hole or cannot be read.
+ */
+bool Dnode::readBlock(uint64_t blockID, std::vector<char> &block) const {
+    block.clear();
+
+    int levels = dn_nlevels;
+    int shift = dn_indblkshift - BLKPTR_SHIFT;
+    if (levels < 1 || (levels > 1 && (shift <= 0 || shift * (levels - 1) >= 64)))
+        return false;
+
+    const Blkptr *ptr = getBlkptr(levels > 1 ? blockID >> (shift * (levels - 1)) : blockID);
+    if (ptr == nullptr)
+        return false;
+
+    Blkptr child;
+    std::vector<char> indirect;
+    try {
+        for (int level = levels - 1; level > 0; --level) {
+            indirect.clear();
+            ptr->getData(indirect, 1);
+
+            uint64_t index = (blockID >> (shift * (level - 1))) & ((1ULL << shift) - 1);
+            if ((index + 1) * 128 > indirect.size())
+                return false;
+            child = Blkptr(endian, (uint8_t *) indirect.data() + index * 128, pool);
+            ptr = &child;
+        }
+
+        ptr->getData(block, 1);
+    }
+    catch (...) {
+        //hole or no copy of a block matches its checksum
+        block.clear();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Copy length bytes starting at offset of the object into buffer. Data
+ * blocks are read, verified and decompressed in batches on the shared
+ * worker pool, so reads spanning many blocks use all cores. Holes and
+ * damaged blocks read as zeros.
+ * Returns the number of bytes copied.
+ */
+uint64_t Dnode::read(uint64_t offset, uint64_t length, char *buffer) const {
+    uint64_t blockSize = getDataBlockSize();
+    if (blockSize == 0 || length == 0)
+        return 0;
+
+    uint64_t firstBlock = offset / blockSize;
+    uint64_t lastBlock = (offset + length - 1) / blockSize;
+    ThreadPool &workers = ThreadPool::shared();
+    uint64_t batchSize = 2 * workers.size();
+
+    std::vector<std::vector<char>> blocks;
+    std::vector<std::future<void>> pending;
+    for (uint64_t batchStart = firstBlock; batchStart <= lastBlock; batchStart += batchSize) {
+        uint64_t batchEnd = std::min(lastBlock + 1, batchStart + batchSize);
+        blocks.assign(batchEnd - batchStart, std::vector<char>());
+
+        auto load = [this, &blocks, batchStart](uint64_t blockID) {
+            std::vector<char> &block = blocks[blockID - batchStart];
+            if (blockID > dn_maxblkid || !readBlock(blockID, block))
+                block.clear();
+        };
+        if (blocks.size() == 1) {
+            load(batchStart);
+        } else {
+            pending.clear();
+            for (uint64_t blockID = batchStart; blockID < batchEnd; blockID++)
+                pending.push_back(workers.submit(std::bind(load, blockID)));
+            ThreadPool::waitAll(pending);
+        }
+
+        for (uint64_t blockID = batchStart; blockID < batchEnd; blockID++) {
+            std::vector<char> &block = blocks[blockID - batchStart];
+            uint64_t from = std::max(offset, blockID * blockSize);
+            uint64_t to = std::min(offset + length, (blockID + 1) * blockSize);
+            uint64_t blockOffset = from - blockID * blockSize;
+            if (block.size() < blockOffset + (to - from))
+                block.resize(blockOffset + (to - from), 0);
+            memcpy(buffer + (from - offset), block.data() + blockOffset, to - from);
         }
     }
+    return length;
+}
+
+/*
+ * Size of the object in bytes: the file size for file system objects,
+ * otherwise all blocks up to the highest allocated one.
+ */
+uint64_t Dnode::getSize() const {
+    const znode_phys *znode = getZnode();
+    if (znode != nullptr)
+        return znode->zp_size;
+    return (dn_maxblkid + 1) * getDataBlockSize();
 }
 
 void Dnode::generateBonus(TSK_ENDIAN_ENUM endian, uint8_t *data) {
     switch (unsigned(dn_bonustype)) {
-        case 16:
-            this->dn_bonus["ds_dir_obj"] = read64Bit(endian, data);
-            this->dn_bonus["ds_prev_snap_obj"] = read64Bit(endian, data + 8);
-            this->dn_bonus["ds_prev_snap_txg"] = read64Bit(endian, data + 16);
-            this->dn_bonus["ds_next_snap_obj"] = read64Bit(endian, data + 24);
-            this->dn_bonus["ds_snapnames_zapobj"] = read64Bit(endian, data + 32);
-            this->dn_bonus["ds_num_children"] = read64Bit(endian, data + 40);
-            this->dn_bonus["ds_creation_time"] = read64Bit(endian, data + 48);
-            this->dn_bonus["ds_creation_txg"] = read64Bit(endian, data + 56);
-            this->dn_bonus["ds_deadlist_obj"] = read64Bit(endian, data + 64);
-            this->dn_bonus["ds_used_bytes"] = read64Bit(endian, data + 72);
-            this->dn_bonus["ds_compressed_bytes"] = read64Bit(endian, data + 80);
-            this->dn_bonus["ds_uncompressed_bytes"] = read64Bit(endian, data + 88);
-            this->dn_bonus["ds_unique_bytes"] = read64Bit(endian, data + 96);
-            this->dn_bonus["ds_fsidguid"] = read64Bit(endian, data + 104);
-            this->dn_bonus["ds_guid"] = read64Bit(endian, data + 112);
+        case 16: {
+            //the fields of dsl_dataset_phys follow each other on disk
+            uint64_t *fields = (uint64_t *) &dn_bonus.dataset;
+            for (size_t i = 0; i < sizeof(dsl_dataset_phys) / 8; i++)
+                fields[i] = read64Bit(endian, data + 8 * i);
             try {
-                dn_bonus_blkptr = new Blkptr(endian, data + 128, this->pool);
+                dn_bonus_blkptr.reset(new Blkptr(endian, data + 128, this->pool));
             }
             catch (...) {
                 //in case of empty, it points to no object set
-                dn_bonus_blkptr = NULL;
+                dn_bonus_blkptr.reset();
             }
             break;
+        }
         case 44:
-            this->dn_bonus["zp_atime"] = read64Bit(endian, data + 64);
-            this->dn_bonus["zp_mtime"] = read64Bit(endian, data + 80);
-            this->dn_bonus["zp_ctime"] = read64Bit(endian, data + 96);
-            this->dn_bonus["zp_crtime"] = read64Bit(endian, data + 112);
-            this->dn_bonus["zp_size"] = read64Bit(endian, data + 16);
-            this->dn_bonus["zp_parent"] = read64Bit(endian, data + 48);
+            dn_bonus.znode.zp_atime = read64Bit(endian, data + 64);
+            dn_bonus.znode.zp_mtime = read64Bit(endian, data + 80);
+            dn_bonus.znode.zp_ctime = read64Bit(endian, data + 96);
+            dn_bonus.znode.zp_crtime = read64Bit(endian, data + 112);
+            dn_bonus.znode.zp_size = read64Bit(endian, data + 16);
+            dn_bonus.znode.zp_parent = read64Bit(endian, data + 48);
             break;
         case 12:
-            this->dn_bonus["dd_creation_time"] = read64Bit(endian, data);
-            this->dn_bonus["dd_head_dataset"] = read64Bit(endian, data + 8);
-            this->dn_bonus["dd_parent_obj"] = read64Bit(endian, data + 16);
-            this->dn_bonus["dd_child_dir_zapobj"] = read64Bit(endian, data + 32);
+            dn_bonus.directory.dd_creation_time = read64Bit(endian, data);
+            dn_bonus.directory.dd_head_dataset = read64Bit(endian, data + 8);
+            dn_bonus.directory.dd_parent_obj = read64Bit(endian, data + 16);
+            dn_bonus.directory.dd_child_dir_zapobj = read64Bit(endian, data + 32);
             break;
         default:
             break;
     }
 }
 
-uint64_t Dnode::getBonusValue(string name) {
-    if (dn_bonus.find(name) == dn_bonus.end())
-        return FALSE;   // TODO: don't return false here
-    else
-        return dn_bonus[string(name)];
-}
-
-Blkptr *Dnode::getBonusBlkptr() {
-    return dn_bonus_blkptr;
-}
-
 ostream &operator<<(ostream &os, const Dnode &dnode) {
     os << "type: " << dnode.dn_type << "\t|\t lvl: " << unsigned(dnode.dn_nlevels) << "\t|\t nblkptrs: "
        << unsigned(dnode.dn_nblkptr) << "\t|\t bonus type/len: " << unsigned(dnode.dn_bonustype) << "/"
        << dnode.dn_bonuslen << endl;
     cout << endl;
 
-    if (dnode.dn_bonuslen > 0) {
-        for (auto &it : dnode.dn_bonus) {
-            if (it.first.find("time") != string::npos)
-                cout << it.first << " = " << timestampToDateString(it.second) << endl;
-            else
-                cout << it.first << " = " << it.second << endl;
-        }
+    if (const dsl_dataset_phys *dataset = dnode.getDataset()) {
+        cout << "ds_dir_obj = " << dataset->ds_dir_obj << endl;
+        cout << "ds_prev_snap_obj = " << dataset->ds_prev_snap_obj << endl;
+        cout << "ds_prev_snap_txg = " << dataset->ds_prev_snap_txg << endl;
+        cout << "ds_next_snap_obj = " << dataset->ds_next_snap_obj << endl;
+        cout << "ds_snapnames_zapobj = " << dataset->ds_snapnames_zapobj << endl;
+        cout << "ds_num_children = " << dataset->ds_num_children << endl;
+        cout << "ds_creation_time = " << timestampToDateString(dataset->ds_creation_time) << endl;
+        cout << "ds_creation_txg = " << dataset->ds_creation_txg << endl;
+        cout << "ds_deadlist_obj = " << dataset->ds_deadlist_obj << endl;
+        cout << "ds_used_bytes = " << dataset->ds_used_bytes << endl;
+        cout << "ds_compressed_bytes = " << dataset->ds_compressed_bytes << endl;
+        cout << "ds_uncompressed_bytes = " << dataset->ds_uncompressed_bytes << endl;
+        cout << "ds_unique_bytes = " << dataset->ds_unique_bytes << endl;
+        cout << "ds_fsid_guid = " << dataset->ds_fsid_guid << endl;
+        cout << "ds_guid = " << dataset->ds_guid << endl;
+        cout << endl;
+    } else if (const dsl_dir_phys *directory = dnode.getDatasetDirectory()) {
+        cout << "dd_creation_time = " << timestampToDateString(directory->dd_creation_time) << endl;
+        cout << "dd_head_dataset = " << directory->dd_head_dataset << endl;
+        cout << "dd_parent_obj = " << directory->dd_parent_obj << endl;
+        cout << "dd_child_dir_zapobj = " << directory->dd_child_dir_zapobj << endl;
+        cout << endl;
+    } else if (const znode_phys *znode = dnode.getZnode()) {
+        cout << "zp_atime = " << timestampToDateString(znode->zp_atime) << endl;
+        cout << "zp_mtime = " << timestampToDateString(znode->zp_mtime) << endl;
+        cout << "zp_ctime = " << timestampToDateString(znode->zp_ctime) << endl;
+        cout << "zp_crtime = " << timestampToDateString(znode->zp_crtime) << endl;
+        cout << "zp_size = " << znode->zp_size << endl;
+        cout << "zp_parent = " << znode->zp_parent << endl;
         cout << endl;
     }
 
-    if (dnode.dn_bonus_blkptr != NULL) {
+    if (dnode.dn_bonus_blkptr) {
         os << *dnode.dn_bonus_blkptr << endl;
     }
 
     //show only highest level block pointer
-    for (int i = 0; i < dnode.dn_blkptr.size(); ++i) {
-        os << *dnode.dn_blkptr[i];
+    for (int i = 0; i < dnode.dn_validblkptrs; ++i) {
+        os << *dnode.getBlkptr(i);
     }
 
     //show level 0 block pointer
     os << endl << "Level 0 blocks:" << endl;
-    for (int i = 0; i < dnode.dn_blkptr.size(); ++i) {
-        os << dnode.dn_blkptr[i]->level0Blocks(dnode.dn_nlevels).str() << endl;
+    for (int i = 0; i < dnode.dn_validblkptrs; ++i) {
+        os << dnode.getBlkptr(i)->level0Blocks(dnode.dn_nlevels).str() << endl;
     }
 
     return os;
 }
-
-Dnode::~Dnode() {
-    for (int i = 0; i < this->dn_blkptr.size(); ++i) {
-        delete this->dn_blkptr[i];
-    }
-
-    delete this->dn_bonus_blkptr;
-}
@@ -15,7 +15,7 @@
 #define ZFS_FTK_DNODE_H
 
 #include <iostream>
-#include <map>
+#include <memory>
 #include <tsk/libtsk.h>
 #include <fstream>
 #include "Blkptr.h"
@@ -23,30 +23,56 @@
 #include "ZFS_Structures.h"
 #include "../../pool/ZFS_POOL.h"
 
+/**
+ * Decoded dnode. The first block pointer is stored inline, as most objects
+ * have only one; the bonus buffer is kept as the fixed layout of its type.
+ */
 class Dnode{
 
 private:
     dmu_object_type_t dn_type;
+    uint8_t dn_indblkshift;
     uint8_t dn_nlevels;
     uint8_t dn_nblkptr;
     uint8_t dn_bonustype;
+    uint16_t dn_datablkszsec;
     uint16_t dn_bonuslen;
-    std::vector<Blkptr*> dn_blkptr;
-    Blkptr* dn_bonus_blkptr;
+    uint8_t dn_validblkptrs;                        // block pointers up to the first hole
+    uint64_t dn_maxblkid;
+    Blkptr dn_blkptr;
+    std::unique_ptr<Blkptr[]> dn_moreblkptrs;       // second and third block pointer, if any
+    std::unique_ptr<Blkptr> dn_bonus_blkptr;        // object set of a DSL dataset
+    union {
+        dsl_dataset_phys dataset;
+        dsl_dir_phys directory;
+        znode_phys znode;
+    } dn_bonus;
     TSK_ENDIAN_ENUM endian;
     ZFS_POOL* pool;
 
     void generateBonus(TSK_ENDIAN_ENUM endian, uint8_t * data);
+    bool hasBonus(uint8_t type) const {return dn_bonuslen > 0 && dn_bonustype == type;};
 
 public:
     Dnode(TSK_ENDIAN_ENUM endian, uint8_t data[], ZFS_POOL* pool);
-    ~Dnode();
+    ~Dnode() = default;
 
     void getData(std::vector<char>& data);
+    bool readBlock(uint64_t blockID, std::vector<char>& block) const;
+    uint64_t read(uint64_t offset, uint64_t length, char* buffer) const;
+    uint64_t getSize() const;
     dmu_object_type_t getType() {return dn_type;};
-    uint64_t getBonusValue(string name);
-    Blkptr* getBonusBlkptr();
-    std::map<string, uint64_t> dn_bonus;
+    uint8_t getLevels() const {return dn_nlevels;};
+    uint8_t getIndirectBlockShift() const {return dn_indblkshift;};
+    uint64_t getDataBlockSize() const {return (uint64_t) dn_datablkszsec * 512;};
+    uint64_t getMaxBlockID() const {return dn_maxblkid;};
+    const Blkptr* getBlkptr(uint64_t i) const;
+    const Blkptr* getBonusBlkptr() const {return dn_bonus_blkptr.get();};
+
+    //bonus buffer of the given type, nullptr if the dnode has another one
+    const dsl_dataset_phys* getDataset() const {return hasBonus(16) ? &dn_bonus.dataset : nullptr;};
+    const dsl_dir_phys* getDatasetDirectory() const {return hasBonus(12) ? &dn_bonus.directory : nullptr;};
+    const znode_phys* getZnode() const {return hasBonus(44) ? &dn_bonus.znode : nullptr;};
 
     friend std::ostream& operator<<(std::ostream& os, const Dnode& dnode);
 };
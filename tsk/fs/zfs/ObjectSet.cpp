@@ -16,32 +16,58 @@
 
 using namespace std;
 
-ObjectSet::ObjectSet(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool) {
+//size of a dnode slot in bytes
+static const uint64_t DNODE_SIZE = 512;
+
+ObjectSet::ObjectSet(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool)
+        : endian(endian), pool(pool), cachedBlockID(UINT64_MAX) {
 
     metadnode = new Dnode(endian, data, pool);
-    std::vector<char> dataDnode;
-    metadnode->getData(dataDnode);
+}
 
-    for (int i = 0; i < int(dataDnode.size() / 512); ++i) {
-        try {
-            dnodes.push_back(new Dnode(endian, (uint8_t *) dataDnode.data() + (i * 512), pool));
-        }
-        catch (...) {
-            dnodes.push_back(nullptr);
-        }
-    }
+/*
+ * Read the level 0 block of the meta-dnode with the given block ID into
+ * cachedBlock.
+ * Returns false if the block is a hole or cannot be read.
+ */
+bool ObjectSet::readDnodeBlock(uint64_t blockID) const {
+    cachedBlockID = UINT64_MAX;
+    if (!metadnode->readBlock(blockID, cachedBlock))
+        return false;
+
+    cachedBlockID = blockID;
+    return true;
 }
 
 Dnode* ObjectSet::getDnode(uint64_t i) const {
-    if(i < dnodes.size()) {
-        return dnodes.at(i);
-    } else
-        return nullptr;
+    auto found = dnodes.find(i);
+    if (found != dnodes.end())
+        return found->second;
+
+    Dnode *dnode = nullptr;
+    uint64_t dnodesPerBlock = metadnode->getDataBlockSize() / DNODE_SIZE;
+    if (dnodesPerBlock > 0) {
+        uint64_t blockID = i / dnodesPerBlock;
+        if (blockID == cachedBlockID || readDnodeBlock(blockID)) {
+            uint64_t offset = (i % dnodesPerBlock) * DNODE_SIZE;
+            if (offset + DNODE_SIZE <= cachedBlock.size()) {
+                try {
+                    dnode = new Dnode(endian, (uint8_t *) cachedBlock.data() + offset, pool);
+                }
+                catch (...) {
+                    dnode = nullptr;
+                }
+            }
+        }
+    }
+
+    dnodes[i] = dnode;
+    return dnode;
 }
 
 ObjectSet::~ObjectSet() {
-    for (int j = 0; j < dnodes.size(); ++j) {
-        delete dnodes.at(j);
+    for (auto &it : dnodes) {
+        delete it.second;
     }
 
     delete this->metadnode;
@@ -16,16 +16,29 @@
 
 #include <cstdint>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 #include <tsk/libtsk.h>
 #include "../../pool/ZFS_POOL.h"
 
 class Dnode;
 
+/**
+ * Object set of a dataset or of the MOS. Dnodes are decoded on first
+ * access: only the path of indirect blocks leading to the level 0 block
+ * of the meta-dnode holding the requested object is read.
+ */
 class ObjectSet{
 
 private:
+    TSK_ENDIAN_ENUM endian;
+    ZFS_POOL* pool;
     Dnode* metadnode;
-    std::vector<Dnode*> dnodes;
+    mutable std::unordered_map<uint64_t, Dnode*> dnodes;   // decoded dnodes, nullptr for free slots
+    mutable uint64_t cachedBlockID;                         // level 0 block held in cachedBlock
+    mutable std::vector<char> cachedBlock;
+
+    bool readDnodeBlock(uint64_t blockID) const;
 
 public:
     ObjectSet(TSK_ENDIAN_ENUM endian, uint8_t data[], ZFS_POOL* pool);
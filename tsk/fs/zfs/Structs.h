@@ -17,7 +17,75 @@
 
 typedef struct dva{
     uint64_t offset;
+    uint64_t asize;     // allocated size in bytes, 0 for an unused DVA
     uint32_t vdev;
 } dva;
 
+/* Checksum algorithms of block pointers (enum zio_checksum) */
+enum zio_checksum{
+    ZIO_CHECKSUM_INHERIT = 0,
+    ZIO_CHECKSUM_ON,
+    ZIO_CHECKSUM_OFF,
+    ZIO_CHECKSUM_LABEL,
+    ZIO_CHECKSUM_GANG_HEADER,
+    ZIO_CHECKSUM_ZILOG,
+    ZIO_CHECKSUM_FLETCHER_2,
+    ZIO_CHECKSUM_FLETCHER_4,
+    ZIO_CHECKSUM_SHA256,
+    ZIO_CHECKSUM_ZILOG2,
+    ZIO_CHECKSUM_NOPARITY
+};
+
+/* Compression algorithms of block pointers (enum zio_compress) */
+enum zio_compress{
+    ZIO_COMPRESS_INHERIT = 0,
+    ZIO_COMPRESS_ON,
+    ZIO_COMPRESS_OFF,
+    ZIO_COMPRESS_LZJB,
+    ZIO_COMPRESS_EMPTY,
+    ZIO_COMPRESS_GZIP_1,
+    ZIO_COMPRESS_GZIP_9 = ZIO_COMPRESS_GZIP_1 + 8,
+    ZIO_COMPRESS_ZLE,
+    ZIO_COMPRESS_LZ4,
+    ZIO_COMPRESS_ZSTD,
+    ZIO_COMPRESS_FUNCTIONS
+};
+
+/* Bonus buffer of a DSL dataset (dsl_dataset_phys_t, bonus type 16) */
+typedef struct dsl_dataset_phys{
+    uint64_t ds_dir_obj;
+    uint64_t ds_prev_snap_obj;
+    uint64_t ds_prev_snap_txg;
+    uint64_t ds_next_snap_obj;
+    uint64_t ds_snapnames_zapobj;
+    uint64_t ds_num_children;
+    uint64_t ds_creation_time;
+    uint64_t ds_creation_txg;
+    uint64_t ds_deadlist_obj;
+    uint64_t ds_used_bytes;
+    uint64_t ds_compressed_bytes;
+    uint64_t ds_uncompressed_bytes;
+    uint64_t ds_unique_bytes;
+    uint64_t ds_fsid_guid;
+    uint64_t ds_guid;
+} dsl_dataset_phys;
+
+/* Bonus buffer of a DSL directory (dsl_dir_phys_t, bonus type 12) */
+typedef struct dsl_dir_phys{
+    uint64_t dd_creation_time;
+    uint64_t dd_head_dataset;
+    uint64_t dd_parent_obj;
+    uint64_t dd_child_dir_zapobj;
+} dsl_dir_phys;
+
+/* File attributes from the system attribute bonus buffer of a file system object (bonus type 44) */
+typedef struct znode_phys{
+    uint64_t zp_atime;
+    uint64_t zp_mtime;
+    uint64_t zp_ctime;
+    uint64_t zp_crtime;
+    uint64_t zp_size;
+    uint64_t zp_parent;
+} znode_phys;
+
 #endif //ZFS_FTK_STRUCTS_H
@@ -8,55 +8,113 @@
 
 /**
  * \file UberblockArray.cpp
- * Describes an array of Uberblocks in ZFS
+ * Describes the uberblock arrays of a ZFS pool
  */
 
 #include "UberblockArray.h"
+#include "Blkptr.h"
+#include <algorithm>
+#include <cstring>
 
 using namespace std;
 
-UberblockArray::UberblockArray(TSK_ENDIAN_ENUM endian, uint8_t *data, ZFS_POOL *pool) {
-    int highestTXG = 0;
+UberblockArray::UberblockArray(TSK_ENDIAN_ENUM endian, ZFS_POOL *pool)
+        : uberblocks(), mostRecent(nullptr), endian(endian), pool(pool) {
+}
+
+/*
+ * Offset of the given label on a device: two labels at the start and two at
+ * the end of the device, which is used in whole labels.
+ */
+uint64_t UberblockArray::getLabelOffset(uint64_t deviceSize, int label) {
+    if (label < NO_LABELS / 2)
+        return label * SIZE_LABEL;
+    uint64_t usedSize = deviceSize / SIZE_LABEL * SIZE_LABEL;
+    return usedSize - (NO_LABELS - label) * SIZE_LABEL;
+}
 
-    //check all 128 possible uberblocks
-    for (int i = 0; i < 128; i++) {
+/*
+ * Add the valid uberblocks of the uberblock array of the label at the given
+ * offset. Slots are at least 1K large, so every 1K is checked.
+ */
+void UberblockArray::addArray(uint8_t *data, uint64_t labelOffset) {
+    for (int i = 0; i < SIZE_UBERBLOCKARRAY / Uberblock::SIZE_UBERBLOCK; i++) {
         try {
-            uberblocks[i] = new Uberblock(endian, data + i * 0x400, pool);
-            uberblocks[i]->setOffset(START_UBERBLOCKARRAY + i * 0x400);
-            if (uberblocks[i]->getTXG() > highestTXG) {
-                highestTXG = uberblocks[i]->getTXG();
-                mostRecent = uberblocks[i];
-            };
+            Uberblock *uberblock = new Uberblock(endian, data + i * Uberblock::SIZE_UBERBLOCK, pool);
+            uberblock->setOffset(labelOffset + START_UBERBLOCKARRAY + i * Uberblock::SIZE_UBERBLOCK);
+            uberblocks.push_back(uberblock);
         }
         catch (...) {
-            //TODO: keep uberblocks with corrupted block pointers for information
-            uberblocks[i] = nullptr;
+            continue;
         }
     }
 }
 
-Uberblock *UberblockArray::getByTXG(int txg) const {
-    for (int i = 0; i < 128; i++) {
-        if ((uberblocks[i] != nullptr) && (uberblocks[i]->getTXG() == txg))
-            return uberblocks[i];
+/*
+ * Sort the uberblocks by TXG and keep one copy of each TXG, then pick the
+ * most recent one. Copies of a TXG usually carry the same root block
+ * pointer and verify alike; if they differ, the first copy whose root
+ * block pointer verifies is kept.
+ */
+void UberblockArray::finish() {
+    std::stable_sort(uberblocks.begin(), uberblocks.end(), [](const Uberblock *a, const Uberblock *b) {
+        return a->getTXG() < b->getTXG();
+    });
+
+    size_t kept = 0;
+    for (size_t first = 0; first < uberblocks.size();) {
+        size_t last = first + 1;
+        bool differ = false;
+        for (; last < uberblocks.size() && uberblocks[last]->getTXG() == uberblocks[first]->getTXG(); last++) {
+            if (memcmp(uberblocks[last]->getRootbp()->getRaw(), uberblocks[first]->getRootbp()->getRaw(), 128) != 0)
+                differ = true;
+        }
+
+        size_t chosen = first;
+        for (size_t i = first; differ && i < last; i++) {
+            if (uberblocks[i]->getRootbp()->verify()) {
+                chosen = i;
+                break;
+            }
+        }
+        for (size_t i = first; i < last; i++) {
+            if (i != chosen)
+                delete uberblocks[i];
+        }
+        uberblocks[kept++] = uberblocks[chosen];
+        first = last;
     }
+    uberblocks.resize(kept);
 
-    return NULL;
+    //the most recent uberblock is the one with the highest TXG whose root block pointer
+    //verifies, uberblocks with corrupted block pointers are kept for information
+    mostRecent = nullptr;
+    for (auto it = uberblocks.rbegin(); it != uberblocks.rend() && mostRecent == nullptr; ++it) {
+        if ((*it)->getRootbp()->verify())
+            mostRecent = *it;
+    }
+}
+
+Uberblock *UberblockArray::getByTXG(uint64_t txg) const {
+    auto found = std::lower_bound(uberblocks.begin(), uberblocks.end(), txg, [](const Uberblock *a, uint64_t txg) {
+        return a->getTXG() < txg;
+    });
+    if (found == uberblocks.end() || (*found)->getTXG() != txg)
+        return NULL;
+    return *found;
 }
 
 ostream &operator<<(ostream &os, const UberblockArray &UberblockArray) {
-    for (int i = 0; i < 128; i++) {
-        if(UberblockArray.uberblocks[i] != NULL){
-            os << setw(3) << i << ". Uberblock: " << hex << setw(10) << UberblockArray.uberblocks[i]->getOffset() <<  dec << "\t/\t"
-                 << timestampToDateString(UberblockArray.uberblocks[i]->getTimestamp())
-                 << "\t/\t TXG:" << UberblockArray.uberblocks[i]->getTXG() << endl;
-        }
+    for (size_t i = 0; i < UberblockArray.uberblocks.size(); i++) {
+        os << setw(3) << i << ". Uberblock: " << hex << setw(10) << UberblockArray.uberblocks[i]->getOffset() << dec
+           << "\t/\t" << timestampToDateString(UberblockArray.uberblocks[i]->getTimestamp())
+           << "\t/\t TXG:" << UberblockArray.uberblocks[i]->getTXG() << endl;
     }
     return os;
 }
 
 UberblockArray::~UberblockArray() {
-    for (int i = 0; i < 128; i++) {
-        delete uberblocks[i];
+    for (auto uberblock : uberblocks) {
+        delete uberblock;
     }
 }
@@ -8,7 +8,7 @@
 
 /**
  * \file UberblockArray.h
- * Describes an array of Uberblocks in ZFS
+ * Describes the uberblock arrays of a ZFS pool
  */
 
 #ifndef ZFS_FTK_UBERBLOCKARRAY_H
@@ -16,26 +16,42 @@
 
 #include <iostream>
 #include <iomanip>
+#include <vector>
 #include <tsk/libtsk.h>
 #include "Uberblock.h"
 
 class ZFS_POOL;
 
+/*
+ * Index of the uberblocks of all labels of all devices in a pool, one per
+ * TXG and sorted by TXG, so an uberblock and its MOS root pointer are found
+ * by binary search. Arrays are added label by label, the index is sorted
+ * by finish().
+ */
 class UberblockArray{
 
 private:
-    Uberblock* uberblocks[128];
+    std::vector<Uberblock*> uberblocks;
     Uberblock* mostRecent;
+    TSK_ENDIAN_ENUM endian;
+    ZFS_POOL* pool;
 
 public:
-    UberblockArray(TSK_ENDIAN_ENUM endian, uint8_t data[], ZFS_POOL* pool);
+    UberblockArray(TSK_ENDIAN_ENUM endian, ZFS_POOL* pool);
     ~UberblockArray();
+    void addArray(uint8_t data[], uint64_t labelOffset);
+    void finish();
     Uberblock* getMostrecent()const { return mostRecent; }
-    Uberblock* getByTXG(int txg)const;
+    Uberblock* getByTXG(uint64_t txg)const;
+    const std::vector<Uberblock*>& getUberblocks() const { return uberblocks; }
+
+    static uint64_t getLabelOffset(uint64_t deviceSize, int label);
 
     friend std::ostream& operator<<(std::ostream& os, const UberblockArray& uberblockarray);
     static const int START_UBERBLOCKARRAY= 0x20000;
     static const int SIZE_UBERBLOCKARRAY= 0x400 * 128;
+    static const int SIZE_LABEL = 0x40000;
+    static const int NO_LABELS = 4;
 
 };
 
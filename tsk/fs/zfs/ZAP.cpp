@@ -11,113 +11,330 @@
  * Describes a ZFS ZAP object
  */
 
+#include <cstring>
+#include <set>
 #include "ZAP.h"
+#include "Dnode.h"
 
 const uint64_t MICRO_ZAP_MAGIC = 0x8000000000000003;
 const uint64_t FAT_ZAP_MAGIC = 0x8000000000000001;
 const uint64_t FAT_LEAF_MAGIC = 0x8000000000000000;
 
+//micro ZAP entries
+const int MZAP_ENT_LEN = 64;
+const int MZAP_NAME_LEN = 50;
+
+//fat ZAP header fields
+const int ZAP_PTRTBL_BLK = 16;
+const int ZAP_PTRTBL_NUMBLKS = 24;
+const int ZAP_PTRTBL_SHIFT = 32;
+const int ZAP_SALT = 80;
+const int ZAP_NORMFLAGS = 88;
+const int ZAP_FLAGS = 96;
+const uint64_t ZAP_FLAG_HASH64 = 1;
+
+//fat ZAP leaves
+const int LEAF_HEADER_LEN = 48;
+const int LEAF_PREFIX_LEN = 32;
+const int CHUNK_LEN = 24;
+const int CHUNK_ARRAY_BYTES = 21;
+const uint8_t CHUNK_ENTRY = 252;
+const uint8_t CHUNK_ARRAY = 251;
+const uint16_t CHAIN_END = 0xffff;
+
 using namespace std;
 
-ZAP::ZAP(TSK_ENDIAN_ENUM endian, uint8_t *data, size_t length, bool isDir)
-    : isDirectory(isDir), endian(endian), entries() {
-    uint64_t magic = read64Bit(endian, data);
-
-    uint64_t mze_value = 0;
-    string mze_name = "";
-    uint8_t mze_type = 0;
-    if (magic == MICRO_ZAP_MAGIC) {
-        for (int i = 0; i < (length / 64) - 1; ++i) {
-            mze_value = read64Bit(endian, data + 64 + i * 64);
-            mze_name = string((char *) data + 64 + 14 + i * 64);
-            if ((mze_value != 0) and (mze_name[0] != '\0')) {
-                this->entries[mze_name] = mze_value;
+/*
+ * Table for the reflected CRC-64 ZFS hashes ZAP names with.
+ */
+static const uint64_t *crc64Table() {
+    static struct Table {
+        uint64_t entries[256];
+
+        Table() {
+            for (int i = 0; i < 256; i++) {
+                uint64_t crc = i;
+                for (int j = 0; j < 8; j++)
+                    crc = (crc >> 1) ^ (-(crc & 1) & 0xC96C5795D7870F42ULL);
+                entries[i] = crc;
             }
         }
-    } else if (magic == FAT_ZAP_MAGIC){
-        uint64_t zap_num_leafs = read64Bit(endian, data + 64);
-        int START_LEAFS = 0x4000;
-        for (int i = 0; i < zap_num_leafs; ++i) {
-            this->parseFatLeaf(data + START_LEAFS + 0x4000*i);
-        }
-    } else {
+    } table;
+    return table.entries;
+}
+
+ZAP::ZAP(TSK_ENDIAN_ENUM endian, Dnode *dnode, bool isDir)
+    : isDirectory(isDir), endian(endian), dnode(dnode), blockSize(0), blockShift(0), header(),
+      cachedBlockID(UINT64_MAX), cachedBlock() {
+    if (dnode == nullptr) {
         cout << "Invalid ZAP magic!" << endl;
+        return;
     }
-}
 
-void ZAP::parseFatLeaf(uint8_t* data){
-    std::vector<uint16_t> chunk_entries;
-    int START_CHUNKS = 48+2*512;
+    blockSize = dnode->getDataBlockSize();
+    while (blockShift < 63 && (1ULL << blockShift) < blockSize)
+        blockShift++;
 
-    uint64_t lhr_block_type = read64Bit(this->endian, data);
-    if (lhr_block_type != FAT_LEAF_MAGIC) {
-        cerr << "Error: Not a valid FAT Leaf as expected!" << endl;
+    if (!dnode->readBlock(0, header) || header.size() < 128) {
+        header.clear();
+        cout << "Invalid ZAP magic!" << endl;
         return;
     }
 
-    for (int i = 0; i < 512; ++i) {
-        uint16_t l_hash = read16Bit(this->endian, data + 48 + 2 * i);
-        if (l_hash != 0xffff)
-            chunk_entries.push_back(l_hash);
+    uint64_t magic = read64Bit(endian, (uint8_t *) header.data());
+    if (magic != MICRO_ZAP_MAGIC && magic != FAT_ZAP_MAGIC) {
+        header.clear();
+        cout << "Invalid ZAP magic!" << endl;
     }
+}
+
+bool ZAP::isMicro() const {
+    return !header.empty() && read64Bit(endian, (uint8_t *) header.data()) == MICRO_ZAP_MAGIC;
+}
+
+bool ZAP::isFat() const {
+    return !header.empty() && read64Bit(endian, (uint8_t *) header.data()) == FAT_ZAP_MAGIC
+           && blockShift > 5 && header.size() >= blockSize;
+}
 
-    for (std::vector<uint16_t>::iterator it = chunk_entries.begin(); it!= chunk_entries.end(); it++) {
-        parseFatLeafChunkEntry(data + START_CHUNKS,(*it));
+/*
+ * Block of the ZAP object, only the most recently used one is kept.
+ * Returns nullptr if the block cannot be read.
+ */
+const uint8_t *ZAP::getBlock(uint64_t blockID) const {
+    if (blockID == 0)
+        return (const uint8_t *) header.data();
+    if (blockID != cachedBlockID) {
+        cachedBlockID = UINT64_MAX;
+        if (!dnode->readBlock(blockID, cachedBlock) || cachedBlock.size() < blockSize)
+            return nullptr;
+        cachedBlockID = blockID;
     }
+    return (const uint8_t *) cachedBlock.data();
 }
 
-void ZAP::parseFatLeafChunkEntry(uint8_t* data, int chunkEntry){
-    uint8_t chunk_type = (data + chunkEntry * 24)[0];
+/*
+ * CRC-64 of the name seeded with the salt, only the upper 28 (or 48)
+ * bits are used.
+ */
+uint64_t ZAP::hash(const string &name) const {
+    const uint64_t *table = crc64Table();
+    uint64_t crc = read64Bit(endian, (uint8_t *) header.data() + ZAP_SALT);
+    for (unsigned char c : name)
+        crc = (crc >> 8) ^ table[(crc ^ c) & 0xff];
 
-    if (unsigned(chunk_type) != 252)
-        cerr << "Error: Not a chunk entry!" << endl;
-    uint16_t chunk_next = read16Bit(endian, data + chunkEntry * 24 + 2);
-    uint16_t chunk_nameChunk = read16Bit(endian, data + chunkEntry * 24 + 4);
-    uint16_t chunk_nameSize = read16Bit(endian, data + chunkEntry * 24 + 6);
-    uint16_t chunk_valueChunk = read16Bit(endian, data + chunkEntry * 24 + 8);
-    uint16_t chunk_valueSize = read16Bit(endian, data + chunkEntry * 24 + 10);
+    int hashBits = (read64Bit(endian, (uint8_t *) header.data() + ZAP_FLAGS) & ZAP_FLAG_HASH64) ? 48 : 28;
+    return crc & ~((1ULL << (64 - hashBits)) - 1);
+}
 
-    std::vector<char> chunkData;
+/*
+ * Block ID of the leaf the pointer table assigns to a hash. Small tables
+ * are embedded in the second half of the header block.
+ */
+uint64_t ZAP::getLeafID(uint64_t hash) const {
+    uint64_t shift = read64Bit(endian, (uint8_t *) header.data() + ZAP_PTRTBL_SHIFT);
+    uint64_t numBlocks = read64Bit(endian, (uint8_t *) header.data() + ZAP_PTRTBL_NUMBLKS);
+    if (shift > 63)
+        return 0;
+    uint64_t index = (shift == 0) ? 0 : hash >> (64 - shift);
 
-    this->getChunkData(data, chunk_nameChunk * 24, &chunkData);
-    string chunk_name = string(chunkData.begin(), chunkData.begin() + chunk_nameSize - 1);
-    chunkData.clear();
-    this->getChunkData(data, chunk_valueChunk * 24, &chunkData);
-    uint64_t  chunk_value = read64Bit(TSK_BIG_ENDIAN,  (uint8_t*) &chunkData[0]);
-    this->entries[chunk_name] = chunk_value;
+    if (numBlocks == 0) {
+        uint64_t embedded = 1ULL << (blockShift - 4);
+        if (index >= embedded)
+            return 0;
+        return read64Bit(endian, (uint8_t *) header.data() + (embedded + index) * 8);
+    }
 
+    uint64_t perBlock = blockSize / 8;
+    if (index / perBlock >= numBlocks)
+        return 0;
+    uint64_t tableBlock = read64Bit(endian, (uint8_t *) header.data() + ZAP_PTRTBL_BLK) + index / perBlock;
+    const uint8_t *block = getBlock(tableBlock);
+    if (block == nullptr)
+        return 0;
+    return read64Bit(endian, block + (index % perBlock) * 8);
 }
 
-void ZAP::getChunkData(uint8_t* data, int offset, std::vector<char>* chunkData){
-    uint8_t chunk_type = (data + offset)[0];
-    if (chunk_type != 251) {
-        cerr << "Error: Not a chunk array!" << endl;
+/*
+ * Concatenate length bytes of a chain of array chunks.
+ */
+bool ZAP::readChunkArray(const uint8_t *chunks, uint64_t noChunks, uint16_t chunk, uint64_t length,
+                         vector<char> &data) const {
+    data.clear();
+    while (data.size() < length) {
+        if (chunk >= noChunks || chunks[chunk * CHUNK_LEN] != CHUNK_ARRAY) {
+            cerr << "Error: Not a chunk array!" << endl;
+            return false;
+        }
+        const uint8_t *array = chunks + chunk * CHUNK_LEN;
+        uint64_t count = std::min<uint64_t>(CHUNK_ARRAY_BYTES, length - data.size());
+        data.insert(data.end(), array + 1, array + 1 + count);
+        chunk = read16Bit(endian, (uint8_t *) array + 22);
     }
+    return true;
+}
+
+/*
+ * Name and value of an entry chunk.
+ */
+bool ZAP::readEntry(const uint8_t *chunks, uint64_t noChunks, uint16_t chunk, string &name, uint64_t &value) const {
+    const uint8_t *entry = chunks + chunk * CHUNK_LEN;
+    uint16_t nameChunk = read16Bit(endian, (uint8_t *) entry + 4);
+    uint16_t nameLength = read16Bit(endian, (uint8_t *) entry + 6);
+    uint16_t valueChunk = read16Bit(endian, (uint8_t *) entry + 8);
 
-    chunkData->insert(chunkData->end(), (data + offset) + 1, (data + offset) + 22);
-    uint16_t chunk_next = read16Bit(this->endian, data + offset + 22);
+    vector<char> data;
+    if (nameLength == 0 || !readChunkArray(chunks, noChunks, nameChunk, nameLength, data))
+        return false;
+    name = string(data.begin(), data.end() - 1);
+
+    //array contents are stored big endian
+    if (!readChunkArray(chunks, noChunks, valueChunk, 8, data))
+        return false;
+    value = read64Bit(TSK_BIG_ENDIAN, (uint8_t *) data.data());
+    return true;
+}
 
-    if (chunk_next != 0xffff){
-        getChunkData(data, chunk_next * 24, chunkData);
+/*
+ * Look up a single name. A fat ZAP is searched by hashing the name: only
+ * the leaf it selects is read and only its hash chain is followed.
+ * Returns false if the name is not found.
+ */
+bool ZAP::lookup(const string &name, uint64_t &value) const {
+    if (isMicro()) {
+        for (uint64_t offset = MZAP_ENT_LEN; offset + MZAP_ENT_LEN <= header.size(); offset += MZAP_ENT_LEN) {
+            const char *entryName = header.data() + offset + 14;
+            if (strnlen(entryName, MZAP_NAME_LEN) == name.size() && name.compare(0, name.size(), entryName, name.size()) == 0) {
+                value = read64Bit(endian, (uint8_t *) header.data() + offset);
+                return value != 0;
+            }
+        }
+        return false;
     }
+
+    if (!isFat())
+        return false;
+
+    //the hash is taken over the normalized name, which is not reproduced here
+    if (read64Bit(endian, (uint8_t *) header.data() + ZAP_NORMFLAGS) != 0) {
+        bool found = false;
+        forEach([&](const string &entryName, uint64_t entryValue) {
+            if (!found && entryName == name) {
+                value = entryValue;
+                found = true;
+            }
+        });
+        return found;
+    }
+
+    uint64_t h = hash(name);
+    uint64_t leafID = getLeafID(h);
+    const uint8_t *leaf = (leafID == 0) ? nullptr : getBlock(leafID);
+    if (leaf == nullptr || read64Bit(endian, (uint8_t *) leaf) != FAT_LEAF_MAGIC)
+        return false;
+
+    int hashShift = blockShift - 5;
+    uint64_t noHashEntries = 1ULL << hashShift;
+    uint64_t prefixLength = read16Bit(endian, (uint8_t *) leaf + LEAF_PREFIX_LEN);
+    if (hashShift + prefixLength > 64)
+        return false;
+    const uint8_t *chunks = leaf + LEAF_HEADER_LEN + 2 * noHashEntries;
+    uint64_t noChunks = (blockSize - LEAF_HEADER_LEN - 2 * noHashEntries) / CHUNK_LEN;
+
+    uint64_t index = (h >> (64 - hashShift - prefixLength)) & (noHashEntries - 1);
+    uint16_t chunk = read16Bit(endian, (uint8_t *) leaf + LEAF_HEADER_LEN + 2 * index);
+    for (uint64_t steps = 0; chunk != CHAIN_END && chunk < noChunks && steps < noChunks; steps++) {
+        const uint8_t *entry = chunks + chunk * CHUNK_LEN;
+        if (entry[0] != CHUNK_ENTRY) {
+            cerr << "Error: Not a chunk entry!" << endl;
+            return false;
+        }
+        string entryName;
+        if (read64Bit(endian, (uint8_t *) entry + 16) == h && readEntry(chunks, noChunks, chunk, entryName, value)
+            && entryName == name)
+            return true;
+        chunk = read16Bit(endian, (uint8_t *) entry + 2);
+    }
+    return false;
 }
 
-uint64_t ZAP::getValue(string name) {
-    if (this->entries.find(name) == this->entries.end()){
+uint64_t ZAP::getValue(string name) const {
+    uint64_t value = 0;
+    if (!lookup(name, value))
         return FALSE;
+    return value;
+}
+
+/*
+ * Call back for every entry, one leaf at a time. Entries are reported in
+ * on-disk order.
+ */
+void ZAP::forEach(std::function<void(const string &name, uint64_t value)> callback) const {
+    if (isMicro()) {
+        for (uint64_t offset = MZAP_ENT_LEN; offset + MZAP_ENT_LEN <= header.size(); offset += MZAP_ENT_LEN) {
+            uint64_t value = read64Bit(endian, (uint8_t *) header.data() + offset);
+            const char *entryName = header.data() + offset + 14;
+            size_t length = strnlen(entryName, MZAP_NAME_LEN);
+            if (value != 0 && length > 0)
+                callback(string(entryName, length), value);
+        }
+        return;
     }
-    else {
-        return this->entries[string(name)];
+
+    if (!isFat())
+        return;
+
+    //several pointer table slots may share a leaf, visit each leaf once
+    std::set<uint64_t> leaves;
+    uint64_t shift = read64Bit(endian, (uint8_t *) header.data() + ZAP_PTRTBL_SHIFT);
+    if (shift > 32)
+        return;
+    for (uint64_t index = 0; index < (1ULL << shift); index++) {
+        uint64_t leafID = getLeafID(shift == 0 ? 0 : index << (64 - shift));
+        if (leafID != 0)
+            leaves.insert(leafID);
+    }
+
+    int hashShift = blockShift - 5;
+    uint64_t noHashEntries = 1ULL << hashShift;
+    uint64_t noChunks = (blockSize - LEAF_HEADER_LEN - 2 * noHashEntries) / CHUNK_LEN;
+    vector<char> leaf;
+    for (uint64_t leafID : leaves) {
+        const uint8_t *block = getBlock(leafID);
+        if (block == nullptr)
+            continue;
+        if (read64Bit(endian, (uint8_t *) block) != FAT_LEAF_MAGIC) {
+            cerr << "Error: Not a valid FAT Leaf as expected!" << endl;
+            continue;
+        }
+        //the callback may use other ZAP objects, keep this leaf
+        leaf.assign(block, block + blockSize);
+
+        const uint8_t *chunks = (uint8_t *) leaf.data() + LEAF_HEADER_LEN + 2 * noHashEntries;
+        for (uint64_t chunk = 0; chunk < noChunks; chunk++) {
+            if (chunks[chunk * CHUNK_LEN] != CHUNK_ENTRY)
+                continue;
+            string name;
+            uint64_t value;
+            if (readEntry(chunks, noChunks, chunk, name, value))
+                callback(name, value);
+        }
     }
 }
 
-ostream& operator<<(ostream& os, const ZAP& microzap) {
-    std::map<string, uint64_t >::const_iterator it;
+/*
+ * All entries sorted by name, for callers that need them in a map.
+ */
+std::map<string, uint64_t> ZAP::getEntries() const {
+    std::map<string, uint64_t> entries;
+    forEach([&entries](const string &name, uint64_t value) { entries[name] = value; });
+    return entries;
+}
 
-    for ( it = microzap.entries.begin(); it != microzap.entries.end(); it++ ) {
-        os << it->first << " : " << it->second << std::endl ;
+ostream& operator<<(ostream& os, const ZAP& microzap) {
+    for (auto &it : microzap.getEntries()) {
+        os << it.first << " : " << it.second << std::endl ;
     }
 
     return os;
 }
-
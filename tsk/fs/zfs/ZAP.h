@@ -16,27 +16,51 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <functional>
+#include <vector>
 #include <tsk/libtsk.h>
 #include <fstream>
 #include <cstdint>
 #include "utils/ReadInt.h"
 
+class Dnode;
+
+/**
+ * ZAP object (name/value pairs) read block by block from its dnode.
+ * Lookups of a single name only read the blocks that can hold it: the
+ * micro ZAP block, or the fat ZAP header, the pointer table slot selected
+ * by the name's hash and the leaf it points to. Listing all entries
+ * streams them leaf by leaf without building a map.
+ */
 class ZAP{
 
 private:
     bool isDirectory;
     TSK_ENDIAN_ENUM endian;
+    Dnode* dnode;
+    uint64_t blockSize;
+    int blockShift;
+    std::vector<char> header;                   // block 0, the micro ZAP or the fat ZAP header
+    mutable uint64_t cachedBlockID;
+    mutable std::vector<char> cachedBlock;
 
-    void parseFatLeaf(uint8_t* data);
-    void parseFatLeafChunkEntry(uint8_t* data, int chunkOffset);
-    void getChunkData(uint8_t* data, int offset, std::vector<char>* chunkData);
+    bool isMicro() const;
+    bool isFat() const;
+    const uint8_t* getBlock(uint64_t blockID) const;
+    uint64_t hash(const std::string& name) const;
+    uint64_t getLeafID(uint64_t hash) const;
+    bool readChunkArray(const uint8_t* chunks, uint64_t noChunks, uint16_t chunk, uint64_t length,
+                        std::vector<char>& data) const;
+    bool readEntry(const uint8_t* chunks, uint64_t noChunks, uint16_t chunk, std::string& name, uint64_t& value) const;
 
 public:
-    ZAP(TSK_ENDIAN_ENUM endian, uint8_t data[], size_t length, bool isDirectory=FALSE);
+    ZAP(TSK_ENDIAN_ENUM endian, Dnode* dnode, bool isDirectory=FALSE);
     ~ZAP() = default;
 
-    std::map<std::string, uint64_t> entries;
-    uint64_t getValue(std::string name);
+    bool lookup(const std::string& name, uint64_t& value) const;
+    uint64_t getValue(std::string name) const;
+    void forEach(std::function<void(const std::string& name, uint64_t value)> callback) const;
+    std::map<std::string, uint64_t> getEntries() const;
     friend std::ostream& operator<<(std::ostream& os, const ZAP& microzap);
 };
 
@@ -20,14 +20,13 @@ using namespace std;
 
 uint64_t getHeaddatasetID(ObjectSet *MOS, uint64_t directoryID) {
     Dnode *rootDatasetDirectory = MOS->getDnode(directoryID);
-    return rootDatasetDirectory->getBonusValue("dd_head_dataset");
+    const dsl_dir_phys *directory = rootDatasetDirectory->getDatasetDirectory();
+    return directory != nullptr ? directory->dd_head_dataset : 0;
 }
 
 uint64_t getRootdatasetDirectoryID(ObjectSet *MOS) {
-    std::vector<char> objectDirectoryData;
     Dnode *objectDirectory = MOS->getDnode(1);
-    objectDirectory->getData(objectDirectoryData);
-    ZAP zap(TSK_LIT_ENDIAN, (uint8_t *) &objectDirectoryData[0], objectDirectoryData.size());
+    ZAP zap(TSK_LIT_ENDIAN, objectDirectory);
     return zap.getValue("root_dataset");
 
 }
@@ -35,28 +34,26 @@ uint64_t getRootdatasetDirectoryID(ObjectSet *MOS) {
 uint64_t getRootdatasetID(ObjectSet *MOS) {
     //object directory
     Dnode *objectDirectory = MOS->getDnode(1);
-    ZAP *zap = getZAPFromDnode(objectDirectory);
-    uint64_t root_dataset_directory_id = zap->getValue("root_dataset");
+    ZAP zap(TSK_LIT_ENDIAN, objectDirectory);
+    uint64_t root_dataset_directory_id = zap.getValue("root_dataset");
     return getHeaddatasetID(MOS, root_dataset_directory_id);
 }
 
 ZAP *getZAPFromDnode(Dnode *dnode) {
-    std::vector<char> data;
-    dnode->getData(data);
-    return new ZAP(TSK_LIT_ENDIAN, (uint8_t *) data.data(), data.size());
+    return new ZAP(TSK_LIT_ENDIAN, dnode);
 }
 
 
 void getChildDatasets(ObjectSet *MOS, uint64_t datasetDirectoryID, std::map<string, uint64_t> *datasets, string path) {
     Dnode *datasetDirectory = MOS->getDnode(datasetDirectoryID);
-    uint64_t childDirID = datasetDirectory->getBonusValue("dd_child_dir_zapobj");
+    const dsl_dir_phys *directory = datasetDirectory->getDatasetDirectory();
+    if (directory == nullptr)
+        return;
+    uint64_t childDirID = directory->dd_child_dir_zapobj;
     auto childZAPObject = MOS->getDnode(childDirID);
 
-    std::vector<char> childZAPObjectData;
-    childZAPObject->getData(childZAPObjectData);
-    char *start = &childZAPObjectData[0];
-    ZAP zap = ZAP(TSK_LIT_ENDIAN, (uint8_t *) start, childZAPObjectData.size());
-    auto entries = zap.entries;
+    ZAP zap(TSK_LIT_ENDIAN, childZAPObject);
+    auto entries = zap.getEntries();
 
     for (auto& it : entries) {
         if (it.first[0] != '$') {
@@ -67,27 +64,23 @@ void getChildDatasets(ObjectSet *MOS, uint64_t datasetDirectoryID, std::map<stri
 }
 
 auto getZapEntriesFromChildZapObject(Dnode *childZAPObject) -> std::map<string, uint64_t> {
-    std::vector<char> childZAPObjectData;
-    childZAPObject->getData(childZAPObjectData);
-    auto start = childZAPObjectData.data();
-    ZAP zap = ZAP(TSK_LIT_ENDIAN, (uint8_t *) start, childZAPObjectData.size());
-    return zap.entries;
+    ZAP zap(TSK_LIT_ENDIAN, childZAPObject);
+    return zap.getEntries();
 }
 
 void getSnapshots(ObjectSet *MOS, uint64_t datasetDirectoryID, std::map<string, uint64_t> *snapshots) {
     uint64_t datasetID = getHeaddatasetID(MOS, datasetDirectoryID);
     auto dataset = MOS->getDnode(datasetID);
-    auto snapnames = dataset->getBonusValue("ds_snapnames_zapobj");
+    const dsl_dataset_phys *datasetBonus = dataset->getDataset();
+    if (datasetBonus == nullptr)
+        return;
+    auto snapnames = datasetBonus->ds_snapnames_zapobj;
     auto snapnamesZAPObject = MOS->getDnode(snapnames);
 
-    std::vector<char> snapnamesZAPObjectData;
-    snapnamesZAPObject->getData(snapnamesZAPObjectData);
-    auto start = snapnamesZAPObjectData.data();
-    ZAP zap = ZAP(TSK_LIT_ENDIAN, (uint8_t *) start, snapnamesZAPObjectData.size());
-
-    for (auto& it : zap.entries) {
-        snapshots->insert(std::pair<string, uint64_t>(it.first, it.second));
+    ZAP zap(TSK_LIT_ENDIAN, snapnamesZAPObject);
+    zap.forEach([snapshots](const string &name, uint64_t value) {
+        snapshots->insert(std::pair<string, uint64_t>(name, value));
         //TODO: Recursive snapshots?!
         //getChildDatasets(MOS, it->second, datasets, (path + "/" + it->first));
-    }
+    });
 }
@@ -15,7 +15,7 @@
 
 
 BTRFS_DEVICE::BTRFS_DEVICE(uint64_t id, string guid, TSK_IMG_INFO *img, uint64_t offset, bool available)
-        : id(id), guid(guid), image(img), offset(offset), available(available) {
+        : id(id), guid(guid), image(img), offset(offset), available(available), reader(1) {
 }
 
 
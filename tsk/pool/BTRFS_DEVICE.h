@@ -17,6 +17,7 @@
 #include <string.h>
 #include <tsk/libtsk.h>
 #include "../utils/Uuid.h"
+#include "../utils/ThreadPool.h"
 #include "../../tsk/fs/btrfs/Basics/Basics.h"
 
 using namespace std;
@@ -29,6 +30,7 @@ class BTRFS_DEVICE{
     TSK_IMG_INFO *image;
     uint64_t offset;
     bool available;
+    ThreadPool reader; // single worker, keeps reads to one device in order
 
 public:
     BTRFS_DEVICE(uint64_t, string, TSK_IMG_INFO*, uint64_t, bool);
@@ -38,6 +40,7 @@ class BTRFS_DEVICE{
     uint64_t getOffset() const { return offset;};
     string getGUID() const { return guid;};
     TSK_IMG_INFO* getImg() const { return image;};
+    ThreadPool& getReader() { return reader;};
     bool getAvailable() const { return available;};
     void setAvailable(bool);
     void setImage(TSK_IMG_INFO*);
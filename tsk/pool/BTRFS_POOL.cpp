@@ -14,7 +14,9 @@
 #include <string.h>
 #include <cmath>
 #include <iomanip>
+#include <atomic>
 #include "BTRFS_POOL.h"
+#include "POOL_HASH.h"
 #include "../../tsk/utils/ReadInt.h"
 #include "../../tsk/utils/Uuid.h"
 #include "../../tsk/fs/btrfs/Trees/SuperBlock.h"
@@ -25,8 +27,12 @@ using namespace btrForensics;
 
 using namespace std;
 
+//device IDs are assigned in order and not reused, so they stay small
+static const uint64_t MAX_DEVICE_ID = 0xFFFF;
+
 BTRFS_POOL::BTRFS_POOL(TSK_POOL_INFO *pool)
-        : initialized(false), no_all_devices(0), no_available_devices(0), pool(pool) {
+        : initialized(false), no_all_devices(0), no_available_devices(0), pool(pool),
+          verifyChecksums(true) {
 
     std::vector<char> diskData(SuperBlock::SIZE_OF_SPR_BLK);
     SuperBlock *supblk = nullptr;
@@ -48,10 +54,18 @@ BTRFS_POOL::BTRFS_POOL(TSK_POOL_INFO *pool)
         }
 
         //TODO: check if device is part of pool
+        if (supblk->getDevData().getID() > MAX_DEVICE_ID) {
+            cerr << it.first << " has an invalid device ID!" << endl;
+            delete supblk;
+            continue;
+        }
         dev = new BTRFS_DEVICE(supblk->getDevData().getID(), supblk->getDevData().getUUID().encode(),
                                it.second, 0, true);
         //cerr << "DBG: Added device with id " << dev->getID() << endl;
         devices.push_back(dev);
+        if (dev->getID() >= devicesByID.size())
+            devicesByID.resize(dev->getID() + 1, nullptr);
+        devicesByID[dev->getID()] = dev;
         no_available_devices++;
         delete supblk;
     }
@@ -79,59 +93,164 @@ BTRFS_POOL::~BTRFS_POOL() {
     delete superblock;
 }
 
-void BTRFS_POOL::readData(uint64_t logical_addr, uint64_t size, vector<char> &buffer, bool fillWithZeros) {
-    vector <BTRFSPhyAddr> physicalAddr;
+bool BTRFS_POOL::readData(uint64_t logical_addr, uint64_t size, vector<char> &buffer, bool fillWithZeros) {
+    buffer.resize(size);
+    return readData(logical_addr, size, buffer.data(), fillWithZeros);
+}
+
+/*
+ * Read a logical range into buffer. The range is split at stripe and chunk
+ * boundaries, pieces are grouped per device and merged when they are
+ * contiguous on the device and in the buffer. Each device group is read by
+ * that device's worker, so stripes on different images are read in parallel.
+ * Returns false if a part of the range is on no available device or cannot
+ * be read.
+ */
+bool BTRFS_POOL::readData(uint64_t logical_addr, uint64_t size, char *buffer, bool fillWithZeros) {
+    struct ReadPiece {
+        uint64_t offset;
+        uint64_t size;
+        char *dest;
+    };
+    vector<pair<uint64_t, vector<ReadPiece>>> deviceReads;
+
     uint64_t offset = logical_addr;
-    vector<char> stripeData;
-    buffer.resize(0);
-    //TODO: variable stripe_length !!!
-    uint64_t stripe_length = 65536;
-    uint64_t num_stripes = (uint64_t) ceil(size / stripe_length);
     uint64_t size_left = size;
-    uint64_t size_for_stripe = 0;
-    uint64_t chunk_logical = this->getChunkLogicalAddr(logical_addr);
-    //printf("input_log %llu | chunk_log %llu | size %llu | str_len %u | num_stripes %d\n", offset, chunk_logical, size,
-    //       stripe_length, num_stripes);
-
-    bool read;
+    char *dest = buffer;
+    std::atomic<bool> complete(true);
     while (size_left > 0) {
-        read = false;
-        size_for_stripe = stripe_length - ((offset - chunk_logical) % stripe_length);
-        if (size_for_stripe > size_left) {
+        uint64_t chunk_logical, chunk_length, stripe_length;
+        bool chunk_found = getChunkBounds(offset, chunk_logical, chunk_length, stripe_length);
+
+        uint64_t size_for_stripe = stripe_length - ((offset - chunk_logical) % stripe_length);
+        if (chunk_found && chunk_logical + chunk_length - offset < size_for_stripe)
+            size_for_stripe = chunk_logical + chunk_length - offset;
+        if (size_for_stripe > size_left)
             size_for_stripe = size_left;
-        }
-        //cerr << "DBG: SIZE FOR STRIPE: " << size_for_stripe << "\t SIZE LEFT: " << size_left << endl;
-
-        physicalAddr = this->getPhysicalAddress(offset);
-        //check if any of these addresses is available
-        stripeData.resize(size_for_stripe);
-        for (auto &it : physicalAddr) {
-            if (getDeviceByID(it.device) != nullptr) {
-                //cerr << "DBG: Found data on device " << it.device << " @ " << it.offset << endl;
-                readRawData(it.device, it.offset, size_for_stripe, stripeData);
-                read = true;
-                break;
+
+        //use the first copy on an available device
+        bool read = false;
+        for (auto &it : this->getPhysicalAddress(offset)) {
+            if (getDeviceByID(it.device) == nullptr)
+                continue;
+
+            vector<ReadPiece> *pieces = nullptr;
+            for (auto &group : deviceReads) {
+                if (group.first == it.device) {
+                    pieces = &group.second;
+                    break;
+                }
+            }
+            if (pieces == nullptr) {
+                deviceReads.push_back(make_pair(it.device, vector<ReadPiece>()));
+                pieces = &deviceReads.back().second;
             }
+
+            if (!pieces->empty() && pieces->back().offset + pieces->back().size == it.offset
+                && pieces->back().dest + pieces->back().size == dest) {
+                pieces->back().size += size_for_stripe;
+            } else {
+                pieces->push_back(ReadPiece{it.offset, size_for_stripe, dest});
+            }
+            read = true;
+            break;
         }
 
-        if (!read && fillWithZeros) {
-            std::fill(stripeData.begin(), stripeData.end(), 0);
+        if (!read) {
+            complete = false;
+            if (fillWithZeros)
+                memset(dest, 0, size_for_stripe);
         }
 
-        buffer.insert(buffer.end(), stripeData.data(), stripeData.data() + size_for_stripe);
         size_left -= size_for_stripe;
         offset += size_for_stripe;
+        dest += size_for_stripe;
+    }
+
+    auto readGroup = [this, &complete](uint64_t device, const vector<ReadPiece> &pieces) {
+        for (auto &piece : pieces) {
+            if (!readRawData(device, piece.offset, piece.size, piece.dest))
+                complete = false;
+        }
+    };
+
+    //the calling thread reads the first group itself
+    vector<future<void>> pending;
+    for (size_t i = 1; i < deviceReads.size(); i++) {
+        const auto &group = deviceReads[i];
+        pending.push_back(getDeviceByID(group.first)->getReader().submit(
+                [&readGroup, &group] { readGroup(group.first, group.second); }));
+    }
+    try {
+        if (!deviceReads.empty())
+            readGroup(deviceReads[0].first, deviceReads[0].second);
+    } catch (...) {
+        //workers still write into buffer, let them finish first
+        try {
+            ThreadPool::waitAll(pending);
+        } catch (...) {
+        }
+        throw;
     }
+    ThreadPool::waitAll(pending);
+    return complete;
+}
+
+bool BTRFS_POOL::readRawData(int dev_id, uint64_t offset, uint64_t size, vector<char> &buffer) {
+    buffer.resize(size);
+    return readRawData(dev_id, offset, size, buffer.data());
 }
 
-void BTRFS_POOL::readRawData(int dev_id, uint64_t offset, uint64_t size, vector<char> &buffer) {
+/*
+ * Read from a device of the pool.
+ * Returns false if fewer than size bytes could be read.
+ */
+bool BTRFS_POOL::readRawData(int dev_id, uint64_t offset, uint64_t size, char *buffer) {
     BTRFS_DEVICE *dev = getDeviceByID(dev_id);
     if (dev == nullptr) {
         cerr << "Cannot find device with ID << " << dev_id << endl;
         throw "Device with ID does not exist in this pool!";
     }
-    buffer.resize(size);
-    tsk_img_read(dev->getImg(), offset, buffer.data(), size);
+    return tsk_img_read(dev->getImg(), offset, buffer, size) == (ssize_t) size;
+}
+
+/*
+ * Find the chunk holding a logical address.
+ * Returns false if no chunk holds it. chunkLogical is then the best guess
+ * of getChunkLogicalAddr and the stripe length the default of 64 KiB.
+ */
+bool BTRFS_POOL::getChunkBounds(uint64_t logical, uint64_t &chunkLogical, uint64_t &chunkLength,
+                                uint64_t &stripeLength) {
+    if (examiner != nullptr) {
+        const ChunkMapping *chunk = examiner->chunkTree->findChunk(logical);
+        if (chunk != nullptr) {
+            chunkLogical = chunk->logical;
+            chunkLength = chunk->length;
+            stripeLength = chunk->data.getStripeLength();
+            if (stripeLength == 0)
+                stripeLength = 65536;
+            return true;
+        }
+    } else {
+        //chunk tree is not yet ready, use the system chunks from the superblock
+        for (int i = 0; i < superblock->getSysChunkSize(); i++) {
+            uint64_t start = superblock->getChunkKey(i).offset;
+            const ChunkData data = superblock->getChunkData(i);
+            if (start <= logical && logical - start < data.getChunkSize()) {
+                chunkLogical = start;
+                chunkLength = data.getChunkSize();
+                stripeLength = data.getStripeLength();
+                if (stripeLength == 0)
+                    stripeLength = 65536;
+                return true;
+            }
+        }
+    }
+
+    chunkLogical = getChunkLogicalAddr(logical);
+    chunkLength = 0;
+    stripeLength = 65536;
+    return false;
 }
 
 uint64_t BTRFS_POOL::getChunkLogicalAddr(uint64_t logical_address) {
@@ -177,20 +296,18 @@ vector <BTRFSPhyAddr> BTRFS_POOL::getPhysicalAddress(uint64_t logical_address) {
 }
 
 BTRFS_DEVICE *BTRFS_POOL::getDeviceByID(uint64_t id) const {
-    for (int i = 0; i < devices.size(); i++) {
-        if (devices.at(i)->getID() == id)
-            return devices.at(i);
-    }
-    return nullptr;
+    if (id >= devicesByID.size())
+        return nullptr;
+    return devicesByID[id];
 }
 
 void BTRFS_POOL::printChunkInformation(std::ostream &os) const {
     if (examiner != nullptr) {
-        examiner->chunkTree->chunkRoot;
         vector<const BtrfsItem *> foundChunks;
+        NodePins pins;
         examiner->treeTraverse(examiner->chunkTree->chunkRoot, [&foundChunks](const LeafNode *leaf) {
             filterItems(leaf, ItemType::CHUNK_ITEM, foundChunks);
-        });
+        }, &pins);
 
         uint64_t system_chunks = 0;
         uint64_t system_chunks_available = 0;
@@ -314,9 +431,10 @@ void BTRFS_POOL::fsstat(string str_dataset, int uberblock) {
     cout << endl;
 
     vector<const BtrfsItem *> foundRootRefs;
+    NodePins pins;
     examiner->treeTraverse(examiner->rootTree, [&foundRootRefs](const LeafNode *leaf) {
         filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs);
-    });
+    }, &pins);
 
     if (foundRootRefs.size() == 0) {
         cout << "\nNo subvolumes or snapshots are found.\n" << endl;
@@ -335,9 +453,10 @@ void BTRFS_POOL::fls(string sub_file_system, int generation) {
     uint64_t fsTreeID = 0;
     if (sub_file_system != "") {
         vector<const BtrfsItem *> foundRootRefs;
+        NodePins pins;
         examiner->treeTraverse(examiner->rootTree, [&foundRootRefs](const LeafNode *leaf) {
             filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs);
-        });
+        }, &pins);
 
         for (auto item : foundRootRefs) {
             const RootRef *ref = static_cast<const RootRef *>(item);
@@ -362,9 +481,10 @@ void BTRFS_POOL::istat(int object_number, string sub_file_system, int generation
     uint64_t fsTreeID = 0;
     if (sub_file_system != "") {
         vector<const BtrfsItem *> foundRootRefs;
+        NodePins pins;
         examiner->treeTraverse(examiner->rootTree, [&foundRootRefs](const LeafNode *leaf) {
             filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs);
-        });
+        }, &pins);
 
         for (auto item : foundRootRefs) {
             const RootRef *ref = static_cast<const RootRef *>(item);
@@ -389,9 +509,10 @@ void BTRFS_POOL::icat(int object_number, string sub_file_system, int generation)
     uint64_t fsTreeID = 0;
     if (sub_file_system != "") {
         vector<const BtrfsItem *> foundRootRefs;
+        NodePins pins;
         examiner->treeTraverse(examiner->rootTree, [&foundRootRefs](const LeafNode *leaf) {
             filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs);
-        });
+        }, &pins);
 
         for (auto item : foundRootRefs) {
             const RootRef *ref = static_cast<const RootRef *>(item);
@@ -410,4 +531,200 @@ void BTRFS_POOL::icat(int object_number, string sub_file_system, int generation)
     uint64_t targetId = examiner->fsTree->rootDirId;
 
     examiner->fsTree->readFile(object_number);
-}
\ No newline at end of file
+}
+/**
+ * Find the root item id of a subvolume or snapshot by name.
+ * @param name Name of the subvolume, empty for the default file system tree
+ * @param rootTree Root tree to search, nullptr for the current one
+ * @return Root item id, 0 if no subvolume has this name
+ */
+uint64_t BTRFS_POOL::findSubvolumeId(string name, const BtrfsNode *rootTree) {
+    if (name == "") {
+        return examiner->getDefaultFsId();
+    }
+    if (rootTree == nullptr)
+        rootTree = examiner->rootTree;
+
+    vector<const BtrfsItem *> foundRootRefs;
+    NodePins pins;
+    examiner->treeTraverse(rootTree, [&foundRootRefs](const LeafNode *leaf) {
+        filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs);
+    }, &pins);
+
+    uint64_t fsTreeID = 0;
+    for (auto item : foundRootRefs) {
+        const RootRef *ref = static_cast<const RootRef *>(item);
+        if (ref->getDirName() == name) {
+            fsTreeID = ref->getId();
+        }
+    }
+    return fsTreeID;
+}
+
+/**
+ * Root of the root tree as of a generation. The superblock keeps the root
+ * of the last commit and backup roots of the commits before it.
+ * @param generation Generation to use, -1 for the last commit
+ * @return nullptr if the superblock keeps no root of this generation
+ */
+std::shared_ptr<const BtrfsNode> BTRFS_POOL::getRootTree(int generation) {
+    if (generation == -1 || (uint64_t) generation == superblock->getGeneration()) {
+        //owned by the examiner
+        return NodeHandle(examiner->rootTree, [](const BtrfsNode *) {});
+    }
+
+    uint64_t rootAddr = superblock->getRootLogAddr(generation);
+    if (rootAddr == 0) {
+        cerr << "No root tree of generation " << generation << " found, the superblock keeps generation "
+             << superblock->getGeneration() << " and its backup roots" << endl;
+        return nullptr;
+    }
+    try {
+        return examiner->nodeCache->getNode(rootAddr);
+    }
+    catch (...) {
+        cerr << "Root tree of generation " << generation << " cannot be read" << endl;
+        return nullptr;
+    }
+}
+
+/**
+ * List inodes added, removed or changed between two snapshots.
+ * Both file system trees are walked together and subtrees they share are skipped.
+ * @param sub_file_system Older subvolume or snapshot, empty for the default one
+ * @param other_sub_file_system Newer subvolume or snapshot, empty for the default one
+ * @param generation Generation of the root tree to find both in, -1 for the last commit
+ */
+void BTRFS_POOL::diff(string sub_file_system, string other_sub_file_system, int generation) {
+    NodeHandle rootTree = getRootTree(generation);
+    if (!rootTree)
+        return;
+
+    uint64_t oldID = findSubvolumeId(sub_file_system, rootTree.get());
+    uint64_t newID = findSubvolumeId(other_sub_file_system, rootTree.get());
+    if (oldID == 0 || newID == 0) {
+        cerr << "Could not find subvolume/snapshot named "
+             << (oldID == 0 ? sub_file_system : other_sub_file_system) << endl;
+        return;
+    }
+
+    FilesystemTree oldTree(rootTree.get(), oldID, examiner);
+    FilesystemTree newTree(rootTree.get(), newID, examiner);
+    oldTree.showDiff(&newTree, cout);
+}
+
+/**
+ * Print a digest for every regular file of a subvolume or snapshot, or of
+ * the default file system tree and all subvolumes and snapshots. Extents
+ * shared between them are read and hashed once.
+ * @param sub_file_system Subvolume or snapshot, empty for all of them
+ * @param generation Generation of the root tree to find them in, -1 for the last commit
+ */
+void BTRFS_POOL::hash(string sub_file_system, int generation) {
+    NodeHandle rootTree = getRootTree(generation);
+    if (!rootTree)
+        return;
+
+    vector<pair<string, uint64_t>> trees;
+    if (sub_file_system != "") {
+        uint64_t fsTreeID = findSubvolumeId(sub_file_system, rootTree.get());
+        if (fsTreeID == 0) {
+            cerr << "Could not find subvolume/snapshot named " << sub_file_system << endl;
+            return;
+        }
+        trees.push_back(make_pair(sub_file_system, fsTreeID));
+    } else {
+        trees.push_back(make_pair(string(""), examiner->getDefaultFsId()));
+
+        vector<const BtrfsItem *> foundRootRefs;
+        NodePins pins;
+        examiner->treeTraverse(rootTree.get(), [&foundRootRefs](const LeafNode *leaf) {
+            filterItems(leaf, ItemType::ROOT_BACKREF, foundRootRefs);
+        }, &pins);
+        for (auto item : foundRootRefs) {
+            const RootRef *ref = static_cast<const RootRef *>(item);
+            trees.push_back(make_pair(ref->getDirName(), ref->getId()));
+        }
+    }
+
+    POOL_HASH hasher;
+    for (auto &tree : trees) {
+        try {
+            FilesystemTree fsTree(rootTree.get(), tree.second, examiner);
+            fsTree.hashFiles(fsTree.rootDirId, tree.first, hasher, cout);
+        }
+        catch (...) {
+            cerr << "Cannot open subvolume/snapshot " << tree.first << endl;
+        }
+    }
+    hasher.printStatistics(cout);
+}
+
+/*
+ * The logical address space of a BTRFS pool. Reads go through readData, so
+ * a range covering a full stripe row is read from all devices in parallel.
+ */
+class BTRFS_VOLUME : public TSK_POOL_VOLUME {
+
+private:
+    BTRFS_POOL *pool;
+    uint64_t size;
+    uint64_t blockSize;
+
+public:
+    BTRFS_VOLUME(BTRFS_POOL *pool, uint64_t size, uint64_t blockSize)
+            : pool(pool), size(size), blockSize(blockSize) {}
+
+    uint64_t getSize() const { return size; }
+    uint64_t getBlockSize() const { return blockSize; }
+
+    bool read(uint64_t offset, uint64_t length, char *buffer) {
+        try {
+            return pool->readData(offset, length, buffer);
+        }
+        catch (...) {
+            return false;
+        }
+    }
+};
+
+/**
+ * Open the logical address space of the pool, which ends with its last
+ * chunk. Its block size is the largest stripe row of all chunks.
+ * @param sub_file_system Must be empty, subvolumes have no address space of their own
+ * @param generation Generation to use, -1 for the last commit. Older generations
+ * can only be opened while their chunk tree is the current one.
+ */
+TSK_POOL_VOLUME *BTRFS_POOL::openVolume(string sub_file_system, int generation) {
+    if (sub_file_system != "") {
+        cerr << "Subvolumes are file systems, only the logical address space of the pool can be opened" << endl;
+        return nullptr;
+    }
+    if (examiner == nullptr)
+        return nullptr;
+
+    if (generation != -1 && (uint64_t) generation != superblock->getGeneration()) {
+        uint64_t chunkRoot = superblock->getChunkLogAddr(generation);
+        if (chunkRoot == 0) {
+            cerr << "No root of generation " << generation << " found, the superblock keeps generation "
+                 << superblock->getGeneration() << " and its backup roots" << endl;
+            return nullptr;
+        }
+        if (chunkRoot != superblock->getChunkLogAddr()) {
+            cerr << "The chunk tree changed since generation " << generation
+                 << ", only its current address space can be opened" << endl;
+            return nullptr;
+        }
+    }
+
+    uint64_t size = 0;
+    uint64_t blockSize = 65536;
+    for (auto &chunk : examiner->chunkTree->getChunks()) {
+        size = max(size, chunk.logical + chunk.length);
+        uint64_t stripeRow = chunk.data.getStripeLength() * max<uint64_t>(chunk.data.getNumStripe(), 1);
+        blockSize = max(blockSize, stripeRow);
+    }
+    if (size == 0)
+        return nullptr;
+    return new BTRFS_VOLUME(this, size, blockSize);
+}
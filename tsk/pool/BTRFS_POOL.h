@@ -15,6 +15,7 @@
 #define ZFS_FTK_BTRFS_POOL_H
 
 #include <string.h>
+#include <memory>
 #include "TSK_POOL_INFO.h"
 #include "TSK_POOL.h"
 #include "BTRFS_DEVICE.h"
@@ -24,6 +25,7 @@ namespace btrForensics {
     class SuperBlock;
     class TreeExaminer;
     class ChunkItem;
+    class BtrfsNode;
 };
 
 class BTRFS_POOL : public TSK_POOL {
@@ -32,17 +34,26 @@ class BTRFS_POOL : public TSK_POOL {
     TSK_POOL_INFO *pool;
     bool initialized;
     vector<BTRFS_DEVICE*> devices;
+    vector<BTRFS_DEVICE*> devicesByID;  // devices indexed by their ID, nullptr if missing
     uint16_t no_all_devices;
     uint16_t no_available_devices;
     //TODO: maybe change type back to UUID
     string pool_guid;
     btrForensics::SuperBlock* superblock;
+    bool verifyChecksums;
+
+    uint64_t findSubvolumeId(string name, const btrForensics::BtrfsNode *rootTree = nullptr);
+    std::shared_ptr<const btrForensics::BtrfsNode> getRootTree(int generation);
+    bool getChunkBounds(uint64_t logical, uint64_t &chunkLogical, uint64_t &chunkLength,
+                        uint64_t &stripeLength);
 
 public:
     BTRFS_POOL(TSK_POOL_INFO *pool);
     ~BTRFS_POOL();
-    void readData(uint64_t, uint64_t, vector<char>&, bool = true);
-    void readRawData(int dev, uint64_t offset, uint64_t size, vector<char>& buffer);
+    bool readData(uint64_t, uint64_t, vector<char>&, bool = true);
+    bool readData(uint64_t, uint64_t, char*, bool = true);
+    bool readRawData(int dev, uint64_t offset, uint64_t size, vector<char>& buffer);
+    bool readRawData(int dev, uint64_t offset, uint64_t size, char* buffer);
     virtual void print(std::ostream& os) const;
     BTRFS_DEVICE* getDeviceByID(uint64_t) const;
 
@@ -50,6 +61,9 @@ class BTRFS_POOL : public TSK_POOL {
     void fls(string dataset = "", int uberblock = -1);
     void istat(int object_number, string dataset = "", int uberblock = -1);
     void icat(int object_number, string dataset = "", int uberblock = -1);
+    void diff(string dataset, string other_dataset, int uberblock = -1);
+    void hash(string dataset = "", int uberblock = -1);
+    TSK_POOL_VOLUME* openVolume(string volume = "", int uberblock = -1);
     void printChunkInformation(std::ostream &os) const;
     bool isChunkDataAvailable (const btrForensics::ChunkItem*) const;
     //TODO: wrap function around that
@@ -63,6 +77,10 @@ class BTRFS_POOL : public TSK_POOL {
 
     btrForensics::SuperBlock* getSuperblock() { return superblock;};
 
+    /** Enable or disable crc32c verification of tree nodes, enabled by default */
+    void setVerifyChecksums(bool verify) { verifyChecksums = verify; };
+    bool getVerifyChecksums() const { return verifyChecksums; };
+
 
 };
 
@@ -0,0 +1,105 @@
+/*
+ * POOL_HASH.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file POOL_HASH.cpp
+ * Hashes files of many datasets or snapshots, reading shared blocks once
+ */
+
+#include "POOL_HASH.h"
+#include "../utils/Checksum.h"
+
+POOL_HASH::POOL_HASH()
+        : lock(), pieces(), files(), zeros(), piecesHashed(0), piecesReused(0), bytesHashed(0), filesHashed(0),
+          filesReused(0) {
+}
+
+bool POOL_HASH::lookupPiece(const Location &location, Digest &digest) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = pieces.find(location);
+    if (found == pieces.end())
+        return false;
+    digest = found->second;
+    piecesReused++;
+    return true;
+}
+
+void POOL_HASH::insertPiece(const Location &location, const Digest &digest) {
+    std::lock_guard<std::mutex> guard(lock);
+    pieces[location] = digest;
+}
+
+POOL_HASH::Digest POOL_HASH::hashPiece(const char *data, uint64_t length) {
+    Digest digest;
+    sha256((const uint8_t *) data, length, digest.data());
+    piecesHashed++;
+    bytesHashed += length;
+    return digest;
+}
+
+POOL_HASH::Digest POOL_HASH::hashZeros(uint64_t length) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = zeros.find(length);
+        if (found != zeros.end())
+            return found->second;
+    }
+
+    std::vector<char> data(length, 0);
+    Digest digest;
+    sha256((const uint8_t *) data.data(), length, digest.data());
+
+    std::lock_guard<std::mutex> guard(lock);
+    zeros[length] = digest;
+    return digest;
+}
+
+bool POOL_HASH::lookupFile(const Digest &layout, Digest &digest) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = files.find(layout);
+    if (found == files.end())
+        return false;
+    digest = found->second;
+    filesReused++;
+    return true;
+}
+
+void POOL_HASH::insertFile(const Digest &layout, const Digest &digest) {
+    std::lock_guard<std::mutex> guard(lock);
+    files[layout] = digest;
+    filesHashed++;
+}
+
+POOL_HASH::Digest POOL_HASH::compose(const std::vector<Digest> &pieces) {
+    static const uint8_t empty = 0;
+    Digest digest;
+    sha256(pieces.empty() ? &empty : pieces[0].data(), pieces.size() * sizeof(Digest), digest.data());
+    return digest;
+}
+
+POOL_HASH::Digest POOL_HASH::hashLayout(const std::vector<uint8_t> &layout) {
+    Digest digest;
+    sha256(layout.data(), layout.size(), digest.data());
+    return digest;
+}
+
+std::string POOL_HASH::toHex(const Digest &digest) {
+    static const char hex[] = "0123456789abcdef";
+    std::string str;
+    for (uint8_t byte : digest) {
+        str += hex[byte >> 4];
+        str += hex[byte & 0xf];
+    }
+    return str;
+}
+
+void POOL_HASH::printStatistics(std::ostream &os) const {
+    os << "Files hashed: \t" << filesHashed << " (" << filesReused << " unchanged copies reused)" << std::endl;
+    os << "Pieces hashed: \t" << piecesHashed << " (" << piecesReused << " shared pieces reused)" << std::endl;
+    os << "Bytes hashed: \t" << bytesHashed << std::endl;
+}
@@ -0,0 +1,76 @@
+/*
+ * POOL_HASH.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file POOL_HASH.h
+ * Hashes files of many datasets or snapshots, reading shared blocks once
+ */
+
+#ifndef ZFS_FTK_POOL_HASH_H
+#define ZFS_FTK_POOL_HASH_H
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <tsk/libtsk.h>
+
+/*
+ * A file is hashed as a list of pieces: its logical blocks on ZFS, the
+ * ranges of extents it references on BTRFS, and holes. Each piece gets the
+ * SHA-256 of its content and the file digest is the SHA-256 of the piece
+ * digests in file order. Equal file digests mean equal content; the same
+ * content stored with a different layout may hash differently.
+ *
+ * Piece digests are memoized by the piece's physical location, so a block
+ * shared by many snapshots is read and hashed once. File digests are
+ * memoized by a digest of the file's layout (its size and block pointers
+ * or extent list), so an unchanged file in another snapshot costs no
+ * reads at all. Lookups and inserts are locked, pieces can be hashed on
+ * several threads.
+ */
+class POOL_HASH {
+
+public:
+    typedef std::array<uint8_t, 32> Digest;
+    typedef std::array<uint64_t, 4> Location;
+
+    POOL_HASH();
+    ~POOL_HASH() = default;
+
+    bool lookupPiece(const Location &location, Digest &digest);
+    void insertPiece(const Location &location, const Digest &digest);
+    Digest hashPiece(const char *data, uint64_t length);
+    Digest hashZeros(uint64_t length);
+
+    bool lookupFile(const Digest &layout, Digest &digest);
+    void insertFile(const Digest &layout, const Digest &digest);
+
+    static Digest compose(const std::vector<Digest> &pieces);
+    static Digest hashLayout(const std::vector<uint8_t> &layout);
+    static std::string toHex(const Digest &digest);
+
+    void printStatistics(std::ostream &os) const;
+
+private:
+    std::mutex lock;
+    std::map<Location, Digest> pieces;
+    std::map<Digest, Digest> files;
+    std::map<uint64_t, Digest> zeros;      // digests of holes by length
+
+    std::atomic<uint64_t> piecesHashed;
+    std::atomic<uint64_t> piecesReused;
+    std::atomic<uint64_t> bytesHashed;
+    std::atomic<uint64_t> filesHashed;
+    std::atomic<uint64_t> filesReused;
+};
+
+#endif //ZFS_FTK_POOL_HASH_H
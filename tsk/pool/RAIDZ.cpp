@@ -0,0 +1,128 @@
+/*
+ * RAIDZ.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file RAIDZ.cpp
+ * Parity generation and reconstruction for one RAIDZ row
+ */
+
+#include "RAIDZ.h"
+#include "../utils/GF256.h"
+#include <algorithm>
+
+using namespace std;
+
+//coefficient of data column j of n in parity column p
+static uint8_t parityCoefficient(uint64_t p, uint64_t j, uint64_t n) {
+    return gf256Pow2(p * (n - 1 - j));
+}
+
+/*
+ * Fill the parity columns from the data columns. The parity columns must
+ * already have their size.
+ */
+void raidzGenerateParity(vector<vector<char>> &columns, uint64_t nparity) {
+    uint64_t ndata = columns.size() - nparity;
+    for (uint64_t p = 0; p < nparity; p++) {
+        vector<char> &parity = columns[p];
+        std::fill(parity.begin(), parity.end(), 0);
+        for (uint64_t j = 0; j < ndata; j++) {
+            const vector<char> &data = columns[nparity + j];
+            gf256MulAddRegion((uint8_t *) parity.data(), (const uint8_t *) data.data(),
+                              std::min(data.size(), parity.size()), parityCoefficient(p, j, ndata));
+        }
+    }
+}
+
+/*
+ * Rebuild the data columns that are not present, using as many of the
+ * present parity columns as there are missing data columns. All columns
+ * must already have their size.
+ * Returns false if too few parity columns are present.
+ */
+bool raidzReconstruct(vector<vector<char>> &columns, uint64_t nparity, const vector<bool> &present) {
+    uint64_t ndata = columns.size() - nparity;
+
+    vector<uint64_t> missing;
+    for (uint64_t j = 0; j < ndata; j++) {
+        if (!present[nparity + j])
+            missing.push_back(j);
+    }
+    if (missing.empty())
+        return true;
+
+    vector<uint64_t> parities;
+    for (uint64_t p = 0; p < nparity && parities.size() < missing.size(); p++) {
+        if (present[p])
+            parities.push_back(p);
+    }
+    if (parities.size() < missing.size())
+        return false;
+
+    size_t k = missing.size();
+    size_t rowSize = columns[parities[0]].size();
+
+    //syndromes: each parity column with the contribution of the present data removed
+    vector<vector<char>> syndromes(k);
+    for (size_t r = 0; r < k; r++) {
+        syndromes[r] = columns[parities[r]];
+        syndromes[r].resize(rowSize, 0);
+        for (uint64_t j = 0; j < ndata; j++) {
+            if (!present[nparity + j])
+                continue;
+            const vector<char> &data = columns[nparity + j];
+            gf256MulAddRegion((uint8_t *) syndromes[r].data(), (const uint8_t *) data.data(),
+                              std::min(data.size(), rowSize), parityCoefficient(parities[r], j, ndata));
+        }
+    }
+
+    //the syndromes are the missing columns times a k x k matrix, invert it (Gauss-Jordan)
+    vector<vector<uint8_t>> matrix(k, vector<uint8_t>(k));
+    vector<vector<uint8_t>> inverse(k, vector<uint8_t>(k, 0));
+    for (size_t r = 0; r < k; r++) {
+        for (size_t m = 0; m < k; m++)
+            matrix[r][m] = parityCoefficient(parities[r], missing[m], ndata);
+        inverse[r][r] = 1;
+    }
+    for (size_t col = 0; col < k; col++) {
+        size_t pivot = col;
+        while (pivot < k && matrix[pivot][col] == 0)
+            pivot++;
+        if (pivot == k)
+            return false;
+        std::swap(matrix[col], matrix[pivot]);
+        std::swap(inverse[col], inverse[pivot]);
+
+        uint8_t scale = gf256Inverse(matrix[col][col]);
+        for (size_t m = 0; m < k; m++) {
+            matrix[col][m] = gf256Mul(matrix[col][m], scale);
+            inverse[col][m] = gf256Mul(inverse[col][m], scale);
+        }
+        for (size_t r = 0; r < k; r++) {
+            uint8_t factor = matrix[r][col];
+            if (r == col || factor == 0)
+                continue;
+            for (size_t m = 0; m < k; m++) {
+                matrix[r][m] ^= gf256Mul(factor, matrix[col][m]);
+                inverse[r][m] ^= gf256Mul(factor, inverse[col][m]);
+            }
+        }
+    }
+
+    vector<char> rebuilt(rowSize);
+    for (size_t m = 0; m < k; m++) {
+        std::fill(rebuilt.begin(), rebuilt.end(), 0);
+        for (size_t r = 0; r < k; r++) {
+            gf256MulAddRegion((uint8_t *) rebuilt.data(), (const uint8_t *) syndromes[r].data(), rowSize,
+                              inverse[m][r]);
+        }
+        vector<char> &data = columns[nparity + missing[m]];
+        std::copy(rebuilt.begin(), rebuilt.begin() + std::min(data.size(), rowSize), data.begin());
+    }
+    return true;
+}
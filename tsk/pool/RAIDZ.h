@@ -0,0 +1,29 @@
+/*
+ * RAIDZ.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file RAIDZ.h
+ * Parity generation and reconstruction for one RAIDZ row
+ */
+
+#ifndef ZFS_FTK_RAIDZ_H
+#define ZFS_FTK_RAIDZ_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * A row holds nparity parity columns (P, Q, R) followed by the data
+ * columns. Data columns may be shorter than the parity columns, their
+ * missing tail counts as zeros. P is the XOR of the data columns, Q and R
+ * weight data column j of n with 2^(n-1-j) and 4^(n-1-j) in GF(2^8).
+ */
+void raidzGenerateParity(std::vector<std::vector<char>>& columns, uint64_t nparity);
+bool raidzReconstruct(std::vector<std::vector<char>>& columns, uint64_t nparity, const std::vector<bool>& present);
+
+#endif //ZFS_FTK_RAIDZ_H
@@ -8,6 +8,39 @@
 
 #include "TSK_POOL.h"
 
+/**
+ * List differences between two datasets of the pool.
+ * Pool types without snapshot comparison only print an error.
+ */
+void TSK_POOL::diff(string str_dataset, string str_other_dataset, int transaction) {
+    cerr << "Comparing datasets is not supported for this pool type." << endl;
+}
+
+/**
+ * Verify the checksums of all blocks of the pool.
+ * Pool types without block checksums only print an error.
+ */
+void TSK_POOL::scrub(int transaction) {
+    cerr << "Scrubbing is not supported for this pool type." << endl;
+}
+
+/**
+ * Hash all files of a dataset and its snapshots.
+ * Pool types without snapshots only print an error.
+ */
+void TSK_POOL::hash(string str_dataset, int transaction) {
+    cerr << "Hashing is not supported for this pool type." << endl;
+}
+
+/**
+ * Open the linear address space of the pool or of one of its volumes.
+ * Pool types without such an address space only print an error.
+ */
+TSK_POOL_VOLUME *TSK_POOL::openVolume(string str_volume, int transaction) {
+    cerr << "Opening volumes is not supported for this pool type." << endl;
+    return nullptr;
+}
+
 std::ostream& operator<<(std::ostream& os, const TSK_POOL& pool) {
     pool.print(os);
     return os;
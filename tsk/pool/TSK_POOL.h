@@ -14,15 +14,38 @@
 #ifndef THESLEUTHKIT_ZTK_TSK_POOL_H
 #define THESLEUTHKIT_ZTK_TSK_POOL_H
 
+#include <iostream>
 #include <string>
+#include <stdint.h>
 
 using namespace std;
 
+/**
+ * Linear address space of a pool, or of a volume stored in it. Opened by
+ * TSK_POOL::openVolume() and read through tsk_img_open_pool().
+ */
+class TSK_POOL_VOLUME {
+
+public:
+    virtual ~TSK_POOL_VOLUME() {}
+
+    /** Size of the address space in bytes */
+    virtual uint64_t getSize() const = 0;
+
+    /** Unit the pool reads most efficiently, e.g. a full stripe or a volume block */
+    virtual uint64_t getBlockSize() const = 0;
+
+    /** Read length bytes at offset. Returns false if a part of the range cannot be read. */
+    virtual bool read(uint64_t offset, uint64_t length, char *buffer) = 0;
+};
+
 class TSK_POOL {
 
 private:
 
 public:
+    virtual ~TSK_POOL() {}
+
     virtual void fsstat(string str_dataset, int transaction) = 0;
 
     virtual void fls(string str_dataset, int transaction) = 0;
@@ -31,6 +54,14 @@ class TSK_POOL {
 
     virtual void icat(int object_number, string str_dataset, int transaction) = 0;
 
+    virtual void diff(string str_dataset, string str_other_dataset, int transaction);
+
+    virtual void scrub(int transaction);
+
+    virtual void hash(string str_dataset, int transaction);
+
+    virtual TSK_POOL_VOLUME *openVolume(string str_volume, int transaction);
+
     virtual void print(std::ostream &os) const = 0;
 
     friend std::ostream &operator<<(std::ostream &os, const TSK_POOL &pool);
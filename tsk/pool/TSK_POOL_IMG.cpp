@@ -0,0 +1,187 @@
+/*
+ * TSK_POOL_IMG.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file TSK_POOL_IMG.cpp
+ * Disk image backed by the address space of a pool or of a volume in it
+ */
+
+#include "TSK_POOL_IMG.h"
+#include "../img/tsk_img_i.h"
+
+#include <algorithm>
+#include <cstring>
+
+POOL_IMG_CACHE::POOL_IMG_CACHE(TSK_POOL_VOLUME *volume, uint64_t capacity)
+        : volume(volume), blockSize(0), noBlocks(0), maxBlocks(0), lru(), blocks(), nextSequential(0), window(1),
+          hits(0), misses(0) {
+    uint64_t volumeBlockSize = std::max<uint64_t>(volume->getBlockSize(), 512);
+    blockSize = std::max<uint64_t>(MIN_BLOCK_SIZE / volumeBlockSize, 1) * volumeBlockSize;
+    noBlocks = (volume->getSize() + blockSize - 1) / blockSize;
+    //a fill of the largest window must not evict the block it was made for
+    maxBlocks = std::max(capacity / blockSize, 2 * MAX_READAHEAD);
+}
+
+/*
+ * Read the block and, on sequential access, the window of blocks after it
+ * with a single read of the volume. If that read fails, only the block is
+ * read again.
+ * Returns nullptr if the block cannot be read.
+ */
+const POOL_IMG_CACHE::Entry *POOL_IMG_CACHE::fill(uint64_t blockID) {
+    window = (blockID == nextSequential) ? std::min(window * 2, MAX_READAHEAD) : 1;
+
+    //stop at the end of the volume and at blocks that are still cached
+    uint64_t count = 1;
+    while (count < window && blockID + count < noBlocks && blocks.find(blockID + count) == blocks.end())
+        count++;
+
+    uint64_t offset = blockID * blockSize;
+    uint64_t length = std::min(count * blockSize, volume->getSize() - offset);
+    std::vector<char> data(length);
+    if (!volume->read(offset, length, data.data())) {
+        //an unreadable block in the readahead must not fail the requested one
+        if (count == 1)
+            return nullptr;
+        count = 1;
+        length = std::min(blockSize, volume->getSize() - offset);
+        data.resize(length);
+        if (!volume->read(offset, length, data.data()))
+            return nullptr;
+        window = 1;
+    }
+
+    //insert backwards, so the requested block is the most recently used one
+    for (uint64_t i = count; i-- > 0;) {
+        uint64_t start = i * blockSize;
+        uint64_t end = std::min(start + blockSize, length);
+
+        Entry &entry = blocks[blockID + i];
+        entry.data.assign(data.begin() + start, data.begin() + end);
+        lru.push_front(blockID + i);
+        entry.position = lru.begin();
+
+        while (blocks.size() > maxBlocks) {
+            blocks.erase(lru.back());
+            lru.pop_back();
+        }
+    }
+
+    nextSequential = blockID + count;
+    return &blocks[blockID];
+}
+
+ssize_t POOL_IMG_CACHE::read(uint64_t offset, char *buffer, size_t length) {
+    if (offset >= volume->getSize())
+        return 0;
+    length = (size_t) std::min<uint64_t>(length, volume->getSize() - offset);
+
+    size_t done = 0;
+    while (done < length) {
+        uint64_t blockID = (offset + done) / blockSize;
+        uint64_t blockOffset = (offset + done) % blockSize;
+
+        const Entry *entry;
+        auto found = blocks.find(blockID);
+        if (found != blocks.end()) {
+            hits++;
+            lru.splice(lru.begin(), lru, found->second.position);
+            entry = &found->second;
+        } else {
+            misses++;
+            entry = fill(blockID);
+            if (entry == nullptr) {
+                tsk_error_reset();
+                tsk_error_set_errno(TSK_ERR_IMG_READ);
+                tsk_error_set_errstr("pool_img_read: offset %" PRIu64 " len %" PRIu64,
+                                     blockID * blockSize, blockSize);
+                return -1;
+            }
+        }
+
+        if (blockOffset >= entry->data.size())
+            break;
+        size_t copy = (size_t) std::min<uint64_t>(length - done, entry->data.size() - blockOffset);
+        memcpy(buffer + done, entry->data.data() + blockOffset, copy);
+        done += copy;
+    }
+    return done;
+}
+
+static ssize_t pool_img_read(TSK_IMG_INFO *img_info, TSK_OFF_T offset, char *buf, size_t len) {
+    IMG_POOL_INFO *pool_info = (IMG_POOL_INFO *) img_info;
+
+    if (tsk_verbose)
+        tsk_fprintf(stderr, "pool_img_read: byte offset: %" PRIuOFF " len: %" PRIuSIZE "\n", offset, len);
+
+    if (offset < 0) {
+        tsk_error_reset();
+        tsk_error_set_errno(TSK_ERR_IMG_READ_OFF);
+        tsk_error_set_errstr("pool_img_read - %" PRIdOFF, offset);
+        return -1;
+    }
+    return pool_info->cache->read((uint64_t) offset, buf, len);
+}
+
+static void pool_img_imgstat(TSK_IMG_INFO *img_info, FILE *hFile) {
+    IMG_POOL_INFO *pool_info = (IMG_POOL_INFO *) img_info;
+
+    tsk_fprintf(hFile, "IMAGE FILE INFORMATION\n");
+    tsk_fprintf(hFile, "--------------------------------------------\n");
+    tsk_fprintf(hFile, "Image Type: pool\n");
+    tsk_fprintf(hFile, "\nSize in bytes: %" PRIuOFF "\n", img_info->size);
+    tsk_fprintf(hFile, "Cache block size: %" PRIu64 "\n", pool_info->cache->getBlockSize());
+    tsk_fprintf(hFile, "Cache size: %" PRIu64 "\n", pool_info->cache->getCapacity());
+    tsk_fprintf(hFile, "Cache hits/misses: %" PRIu64 "/%" PRIu64 "\n", pool_info->cache->getHits(),
+                pool_info->cache->getMisses());
+}
+
+static void pool_img_close(TSK_IMG_INFO *img_info) {
+    IMG_POOL_INFO *pool_info = (IMG_POOL_INFO *) img_info;
+
+    delete pool_info->cache;
+    delete pool_info->volume;
+    tsk_img_free(pool_info);
+}
+
+/**
+ * Open the linear address space of a pool, or a volume stored in it, as a
+ * disk image. Reads are served from a cache of whole stripes or volume
+ * blocks with readahead, so tools, TskAuto and hashing can run over pool
+ * data like over any other image. The pool must stay open until the image
+ * is closed.
+ *
+ * @param pool Pool to read from
+ * @param volume Volume to open, e.g. a zvol, or empty for the pool itself
+ * @param transaction Transaction or generation number to use, -1 for the most recent one
+ * @param cacheSize Bytes of the volume to keep in the cache
+ * @return NULL on error
+ */
+TSK_IMG_INFO *tsk_img_open_pool(TSK_POOL *pool, std::string volume, int transaction, uint64_t cacheSize) {
+    TSK_POOL_VOLUME *pool_volume = pool->openVolume(volume, transaction);
+    if (pool_volume == nullptr) {
+        tsk_error_reset();
+        tsk_error_set_errno(TSK_ERR_IMG_OPEN);
+        tsk_error_set_errstr("tsk_img_open_pool: cannot open volume \"%s\"", volume.c_str());
+        return NULL;
+    }
+
+    IMG_POOL_INFO *pool_info = (IMG_POOL_INFO *) tsk_img_malloc(sizeof(IMG_POOL_INFO));
+    if (pool_info == NULL) {
+        delete pool_volume;
+        return NULL;
+    }
+    pool_info->volume = pool_volume;
+    pool_info->cache = new POOL_IMG_CACHE(pool_volume, cacheSize);
+
+    TSK_IMG_INFO *img_info = tsk_img_open_external(pool_info, pool_volume->getSize(), 512, pool_img_read,
+                                                   pool_img_close, pool_img_imgstat);
+    if (img_info == NULL)
+        pool_img_close((TSK_IMG_INFO *) pool_info);
+    return img_info;
+}
@@ -0,0 +1,77 @@
+/*
+ * TSK_POOL_IMG.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file TSK_POOL_IMG.h
+ * Disk image backed by the address space of a pool or of a volume in it
+ */
+
+#ifndef ZFS_FTK_TSK_POOL_IMG_H
+#define ZFS_FTK_TSK_POOL_IMG_H
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <tsk/libtsk.h>
+#include "TSK_POOL.h"
+
+/*
+ * LRU cache of the volume in blocks of a multiple of its block size, so a
+ * miss reads whole stripes. Misses directly after the previous fill are
+ * treated as sequential access and read ahead: the window doubles with
+ * every sequential miss up to MAX_READAHEAD blocks and drops back to one
+ * block on a random access. Not locked, tsk_img_read holds cache_lock.
+ */
+class POOL_IMG_CACHE {
+
+public:
+    POOL_IMG_CACHE(TSK_POOL_VOLUME *volume, uint64_t capacity = DEFAULT_CAPACITY);
+    ~POOL_IMG_CACHE() = default;
+
+    ssize_t read(uint64_t offset, char *buffer, size_t length);
+
+    uint64_t getBlockSize() const { return blockSize; }
+    uint64_t getCapacity() const { return maxBlocks * blockSize; }
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+
+    static const uint64_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+    static const uint64_t MIN_BLOCK_SIZE = 1024 * 1024;
+    static const uint64_t MAX_READAHEAD = 8;
+
+private:
+    struct Entry {
+        std::vector<char> data;
+        std::list<uint64_t>::iterator position;
+    };
+
+    TSK_POOL_VOLUME *volume;
+    uint64_t blockSize;
+    uint64_t noBlocks;
+    uint64_t maxBlocks;
+    std::list<uint64_t> lru;                        // block IDs, most recently used first
+    std::unordered_map<uint64_t, Entry> blocks;
+    uint64_t nextSequential;                        // block following the last fill
+    uint64_t window;                                // blocks read by the next sequential fill
+    uint64_t hits;
+    uint64_t misses;
+
+    const Entry *fill(uint64_t blockID);
+};
+
+typedef struct {
+    TSK_IMG_INFO img_info;
+    TSK_POOL_VOLUME *volume;
+    POOL_IMG_CACHE *cache;
+} IMG_POOL_INFO;
+
+TSK_IMG_INFO *tsk_img_open_pool(TSK_POOL *pool, std::string volume = "", int transaction = -1,
+                                uint64_t cacheSize = POOL_IMG_CACHE::DEFAULT_CAPACITY);
+
+#endif //ZFS_FTK_TSK_POOL_IMG_H
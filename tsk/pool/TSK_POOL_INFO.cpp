@@ -14,37 +14,142 @@
 #include "TSK_POOL_INFO.h"
 #include "ZFS_POOL.h"
 #include "BTRFS_POOL.h"
+#include "../fs/zfs/Uberblock.h"
+#include "../fs/btrfs/Trees/SuperBlock.h"
+#include "../utils/ThreadPool.h"
 
-TSK_POOL_INFO::TSK_POOL_INFO(TSK_ENDIAN_ENUM endian, std::string pathToFolder)
-        : numberMembers(0), poolName(""), poolGUID(0), type(), unavailableMembers() {
-    //TODO: recursive directory search
-    //read all given volumes
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <set>
+#include <sys/stat.h>
+
+//the BTRFS magic is stored at offset 0x40 of the superblock
+static const TSK_OFF_T BTRFS_MAGIC_OFFSET = 0x40;
+static const char BTRFS_MAGIC[] = "_BHRfS_M";
+
+/*
+ * Check the uberblock array of the first two labels for the uberblock magic
+ * in either byte order. Slots are at least 1K large, so every 1K is tested.
+ */
+static bool probeZFS(TSK_IMG_INFO *img) {
+    std::vector<char> array(UberblockArray::SIZE_UBERBLOCKARRAY);
+    for (TSK_OFF_T label = 0; label < 2; label++) {
+        TSK_OFF_T offset = label * UberblockArray::SIZE_LABEL + UberblockArray::START_UBERBLOCKARRAY;
+        if (offset + (TSK_OFF_T) array.size() > img->size)
+            break;
+        if (tsk_img_read(img, offset, array.data(), array.size()) != (ssize_t) array.size())
+            continue;
+        for (size_t slot = 0; slot < array.size(); slot += Uberblock::SIZE_UBERBLOCK) {
+            uint8_t *data = (uint8_t *) array.data() + slot;
+            if (read64Bit(TSK_LIT_ENDIAN, data) == Uberblock::UB_MAGIC_BIG ||
+                read64Bit(TSK_BIG_ENDIAN, data) == Uberblock::UB_MAGIC_BIG)
+                return true;
+        }
+    }
+    return false;
+}
+
+static bool probeBTRFS(TSK_IMG_INFO *img) {
+    char magic[sizeof(BTRFS_MAGIC) - 1];
+    TSK_OFF_T offset = btrForensics::SuperBlock::ADDR_OF_SPR_BLK + BTRFS_MAGIC_OFFSET;
+    if (offset + (TSK_OFF_T) sizeof(magic) > img->size)
+        return false;
+    if (tsk_img_read(img, offset, magic, sizeof(magic)) != (ssize_t) sizeof(magic))
+        return false;
+    return memcmp(magic, BTRFS_MAGIC, sizeof(magic)) == 0;
+}
+
+/*
+ * Collect the paths of all files below the folder. Hidden entries are
+ * skipped and symbolic links to folders are not followed.
+ */
+void TSK_POOL_INFO::findMembers(const std::string &pathToFolder, std::vector<std::string> &paths) {
     auto dir = opendir(pathToFolder.c_str());
+    if (dir == nullptr)
+        return;
+
     struct dirent *ent = nullptr;
-    if (dir != nullptr) {
-        while ((ent = readdir(dir)) != nullptr) {
-            if (ent->d_type != DT_DIR) {
-                std::string pathToFile = "";
-                if(pathToFile[0] == '.'){
-                    continue;
-                }
-                if (pathToFolder.back() == '/') {
-                    pathToFile = (pathToFolder + ent->d_name);
-                } else {
-                    pathToFile = (pathToFolder + "/" + ent->d_name);
-                }
-
-                members[pathToFile] = (tsk_img_open(1, (const TSK_TCHAR *const *) &pathToFile, TSK_IMG_TYPE_DETECT, 0));
-                if (members[pathToFile] == nullptr) {
-                    tsk_error_print(stderr);
-                    std::cerr << "Cannot open image " << pathToFile << "." << std::endl;
-                    exit(1);
-                }
-                numberMembers += 1;
-            }
+    while ((ent = readdir(dir)) != nullptr) {
+        if (ent->d_name[0] == '.')
+            continue;
+
+        std::string path;
+        if (pathToFolder.back() == '/') {
+            path = (pathToFolder + ent->d_name);
+        } else {
+            path = (pathToFolder + "/" + ent->d_name);
+        }
+
+        bool isDirectory = (ent->d_type == DT_DIR);
+        if (ent->d_type == DT_UNKNOWN) {
+            struct stat sb;
+            isDirectory = (lstat(path.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode));
+        } else if (ent->d_type == DT_LNK) {
+            struct stat sb;
+            if (stat(path.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode))
+                continue;
         }
-        closedir(dir);
+
+        if (isDirectory)
+            findMembers(path, paths);
+        else
+            paths.push_back(path);
     }
+    closedir(dir);
+}
+
+/*
+ * Open all files below the folder as pool members. The images are opened and
+ * probed for pool signatures concurrently. Files that turn out to be further
+ * segments of a split image opened by another member are dropped.
+ */
+TSK_POOL_INFO::TSK_POOL_INFO(TSK_ENDIAN_ENUM endian, std::string pathToFolder)
+        : numberMembers(0), poolName(""), poolGUID(0), type(), unavailableMembers(), signatures(), members() {
+    std::vector<std::string> paths;
+    findMembers(pathToFolder, paths);
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<TSK_IMG_INFO *> images(paths.size(), nullptr);
+    std::vector<uint8_t> found(paths.size(), 0);
+    std::vector<std::string> errors(paths.size());
+    auto open = [&paths, &images, &found, &errors](size_t i) {
+        const TSK_TCHAR *image = (const TSK_TCHAR *) paths[i].c_str();
+        images[i] = tsk_img_open(1, &image, TSK_IMG_TYPE_DETECT, 0);
+        if (images[i] == nullptr) {
+            const char *error = tsk_error_get();
+            errors[i] = (error != nullptr) ? error : "";
+            return;
+        }
+        found[i] = (probeZFS(images[i]) ? SIGNATURE_ZFS : 0) | (probeBTRFS(images[i]) ? SIGNATURE_BTRFS : 0);
+    };
+
+    std::vector<std::future<void>> pending;
+    for (size_t i = 0; i < paths.size(); i++)
+        pending.push_back(ThreadPool::shared().submit(std::bind(open, i)));
+    ThreadPool::waitAll(pending);
+
+    std::set<std::string> segments;
+    for (TSK_IMG_INFO *img : images) {
+        for (int j = 1; img != nullptr && j < img->num_img; j++)
+            segments.insert((const char *) img->images[j]);
+    }
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (segments.count(paths[i])) {
+            if (images[i] != nullptr)
+                tsk_img_close(images[i]);
+            continue;
+        }
+        if (images[i] == nullptr) {
+            std::cerr << errors[i] << std::endl;
+            std::cerr << "Cannot open image " << paths[i] << "." << std::endl;
+            exit(1);
+        }
+        members.push_back(std::make_pair(paths[i], images[i]));
+        signatures.push_back(found[i]);
+    }
+    numberMembers = members.size();
 }
 
 void TSK_POOL_INFO::displayAllMembers() {
@@ -52,24 +157,54 @@ void TSK_POOL_INFO::displayAllMembers() {
 
 }
 
+/*
+ * Count the members carrying a ZFS label or a BTRFS superblock, as probed
+ * when they were opened.
+ */
+void TSK_POOL_INFO::probeMembers(int &zfsMembers, int &btrfsMembers) {
+    zfsMembers = 0;
+    btrfsMembers = 0;
+    for (uint8_t found : signatures) {
+        zfsMembers += (found & SIGNATURE_ZFS) ? 1 : 0;
+        btrfsMembers += (found & SIGNATURE_BTRFS) ? 1 : 0;
+    }
+}
+
+/*
+ * Construct the pool object of the type found by probing the members. If
+ * both signatures are present, the type found on more members is tried
+ * first. Returns nullptr if no pool could be constructed.
+ */
 TSK_POOL *TSK_POOL_INFO::createPoolObject() {
-    TSK_POOL *pool = nullptr;
+    int zfsMembers = 0;
+    int btrfsMembers = 0;
+    probeMembers(zfsMembers, btrfsMembers);
+    if (tsk_verbose)
+        tsk_fprintf(stderr, "createPoolObject: %d ZFS and %d BTRFS members of %d\n",
+                    zfsMembers, btrfsMembers, numberMembers);
 
-    try {
-        pool = new ZFS_POOL(this);
-        type = TSK_ZFS_POOL;
-    } catch (...) {
-        //cerr << "Not a ZFS pool!" << endl;
-    }
+    std::vector<TSK_POOL_TYPE> candidates;
+    if (zfsMembers > 0)
+        candidates.push_back(TSK_ZFS_POOL);
+    if (btrfsMembers > 0)
+        candidates.insert(btrfsMembers > zfsMembers ? candidates.begin() : candidates.end(), TSK_BTRFS_POOL);
 
-    try {
-        pool = new BTRFS_POOL(this);
-        type = TSK_BTRFS_POOL;
-    } catch (...) {
-        //cerr << "Not a BTRFS pool!" << endl;
+    for (TSK_POOL_TYPE candidate : candidates) {
+        try {
+            TSK_POOL *pool = nullptr;
+            if (candidate == TSK_ZFS_POOL)
+                pool = new ZFS_POOL(this);
+            else
+                pool = new BTRFS_POOL(this);
+            type = candidate;
+            return pool;
+        } catch (...) {
+            //signature found, but the pool cannot be read
+        }
     }
 
-    return pool;
+    std::cerr << "No ZFS or BTRFS pool found." << std::endl;
+    return nullptr;
 }
 
 void TSK_POOL_INFO::displayAllDevices() {
@@ -79,12 +214,12 @@ void TSK_POOL_INFO::displayAllDevices() {
 }
 
 void TSK_POOL_INFO::readData(int device, TSK_OFF_T offset, std::vector<char> &buffer, size_t length) {
-    auto it = this->members.begin();
-    for (int i = 0; i < device; i++) {
-        it++;
-    }
     buffer.resize(length);
-    tsk_img_read(it->second, offset, buffer.data(), length);
+    if (device < 0 || (size_t) device >= members.size()) {
+        std::fill(buffer.begin(), buffer.end(), 0);
+        return;
+    }
+    tsk_img_read(members[device].second, offset, buffer.data(), length);
 }
 
 TSK_POOL_INFO::~TSK_POOL_INFO() {
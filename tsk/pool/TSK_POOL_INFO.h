@@ -18,6 +18,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <utility>
 #include <dirent.h>
 #include "TSK_POOL.h"
 
@@ -32,14 +33,23 @@ class TSK_POOL_INFO {
     int poolGUID;
     TSK_POOL_TYPE type;
     std::vector<int> unavailableMembers;
+    std::vector<uint8_t> signatures;    // pool signatures found on each member
+
+    static const uint8_t SIGNATURE_ZFS = 1;
+    static const uint8_t SIGNATURE_BTRFS = 2;
+
+    static void findMembers(const std::string &pathToFolder, std::vector<std::string> &paths);
+    void probeMembers(int &zfsMembers, int &btrfsMembers);
 
 public:
     TSK_POOL_INFO(TSK_ENDIAN_ENUM endian, std::string pathToFolder);
     ~TSK_POOL_INFO();
 
-    std::map<std::string, TSK_IMG_INFO*> members;
+    //path and image of each member, sorted by path and indexed by device number
+    std::vector<std::pair<std::string, TSK_IMG_INFO*>> members;
 
     TSK_POOL* createPoolObject();
+    TSK_POOL_TYPE getType() const { return type; }
     void displayAllDevices();
     void displayAllMembers();
     void readData(int device, TSK_OFF_T offset, std::vector<char>& buffer, size_t size);
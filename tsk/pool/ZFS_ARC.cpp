@@ -0,0 +1,178 @@
+/*
+ * ZFS_ARC.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file ZFS_ARC.cpp
+ * Cache of decompressed ZFS blocks, keyed by the block location and birth TXG
+ */
+
+#include "ZFS_ARC.h"
+
+using namespace std;
+
+const uint64_t ZFS_ARC::DEFAULT_METADATA_CAPACITY;
+const uint64_t ZFS_ARC::DEFAULT_DATA_CAPACITY;
+const int ZFS_ARC::NO_SHARDS;
+
+ZFS_ARC::ZFS_ARC(uint64_t metadataCapacity, uint64_t dataCapacity) {
+    for (auto &shard : shards) {
+        shard.usedBytes[0] = shard.usedBytes[1] = 0;
+        shard.hits = shard.misses = shard.evictions = 0;
+    }
+    setCapacity(metadataCapacity, dataCapacity);
+}
+
+size_t ZFS_ARC::KeyHash::operator()(const Key &key) const {
+    //offsets are multiples of 512, drop the constant low bits before mixing
+    uint64_t h = (key.offset >> 9) ^ (key.vdev << 56) ^ (key.birth * 0x9E3779B97F4A7C15ULL);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (size_t) h;
+}
+
+ZFS_ARC::Shard &ZFS_ARC::getShard(const Key &key) const {
+    return shards[KeyHash()(key) % NO_SHARDS];
+}
+
+/*
+ * Return the cached block, or nullptr on a miss. Callers that look up
+ * several copies of one block count the miss only on the last lookup.
+ */
+ZFS_ARC::Block ZFS_ARC::lookup(uint64_t vdev, uint64_t offset, uint64_t birth, bool countMiss) {
+    Key key = {vdev, offset, birth};
+    Shard &shard = getShard(key);
+    lock_guard<mutex> guard(shard.lock);
+
+    auto found = shard.entries.find(key);
+    if (found == shard.entries.end()) {
+        if (countMiss)
+            ++shard.misses;
+        return nullptr;
+    }
+
+    ++shard.hits;
+    list<Entry> &lru = shard.lru[found->second->metadata];
+    lru.splice(lru.begin(), lru, found->second);
+    return found->second->block;
+}
+
+/*
+ * Whether the block is cached, without counting it as a hit or a miss
+ * and without changing its position in the LRU list.
+ */
+bool ZFS_ARC::contains(uint64_t vdev, uint64_t offset, uint64_t birth) const {
+    Key key = {vdev, offset, birth};
+    Shard &shard = getShard(key);
+    lock_guard<mutex> guard(shard.lock);
+    return shard.entries.find(key) != shard.entries.end();
+}
+
+/*
+ * Add a block, dropping least recently used blocks of the same kind until
+ * its budget is met again.
+ */
+void ZFS_ARC::insert(uint64_t vdev, uint64_t offset, uint64_t birth, bool metadata, Block block) {
+    if (block == nullptr)
+        return;
+
+    Key key = {vdev, offset, birth};
+    Shard &shard = getShard(key);
+    lock_guard<mutex> guard(shard.lock);
+
+    //another reader may have added it meanwhile
+    if (shard.entries.find(key) != shard.entries.end())
+        return;
+
+    shard.lru[metadata].push_front(Entry{key, block, metadata});
+    shard.entries[key] = shard.lru[metadata].begin();
+    shard.usedBytes[metadata] += block->size();
+    evict(shard, metadata);
+}
+
+//must be called with the shard lock held
+void ZFS_ARC::evict(Shard &shard, bool metadata) {
+    list<Entry> &lru = shard.lru[metadata];
+    while (shard.usedBytes[metadata] > shard.capacity[metadata] && !lru.empty()) {
+        shard.usedBytes[metadata] -= lru.back().block->size();
+        shard.entries.erase(lru.back().key);
+        lru.pop_back();
+        ++shard.evictions;
+    }
+}
+
+void ZFS_ARC::setCapacity(uint64_t metadataCapacity, uint64_t dataCapacity) {
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        shard.capacity[true] = metadataCapacity / NO_SHARDS;
+        shard.capacity[false] = dataCapacity / NO_SHARDS;
+        evict(shard, true);
+        evict(shard, false);
+    }
+}
+
+void ZFS_ARC::clear() {
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        shard.entries.clear();
+        shard.lru[0].clear();
+        shard.lru[1].clear();
+        shard.usedBytes[0] = shard.usedBytes[1] = 0;
+    }
+}
+
+uint64_t ZFS_ARC::getCapacity(bool metadata) const {
+    uint64_t sum = 0;
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        sum += shard.capacity[metadata];
+    }
+    return sum;
+}
+
+uint64_t ZFS_ARC::getUsedBytes(bool metadata) const {
+    uint64_t sum = 0;
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        sum += shard.usedBytes[metadata];
+    }
+    return sum;
+}
+
+uint64_t ZFS_ARC::getHits() const {
+    uint64_t sum = 0;
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        sum += shard.hits;
+    }
+    return sum;
+}
+
+uint64_t ZFS_ARC::getMisses() const {
+    uint64_t sum = 0;
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        sum += shard.misses;
+    }
+    return sum;
+}
+
+uint64_t ZFS_ARC::getEvictions() const {
+    uint64_t sum = 0;
+    for (auto &shard : shards) {
+        lock_guard<mutex> guard(shard.lock);
+        sum += shard.evictions;
+    }
+    return sum;
+}
+
+void ZFS_ARC::printStatistics(std::ostream &os) const {
+    os << "Block cache: " << getHits() << " hits, " << getMisses() << " misses, " << getEvictions() << " evictions, "
+       << getUsedBytes(true) << "/" << getCapacity(true) << " metadata bytes, "
+       << getUsedBytes(false) << "/" << getCapacity(false) << " data bytes" << endl;
+}
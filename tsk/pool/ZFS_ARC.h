@@ -0,0 +1,97 @@
+/*
+ * ZFS_ARC.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file ZFS_ARC.h
+ * Cache of decompressed ZFS blocks, keyed by the block location and birth TXG
+ */
+
+#ifndef ZFS_FTK_ZFS_ARC_H
+#define ZFS_FTK_ZFS_ARC_H
+
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <tsk/libtsk.h>
+
+/*
+ * A block is identified by its top-level vdev, its offset and the TXG it was
+ * born in, so a rewritten location is never served from a stale entry.
+ * Metadata (indirect blocks, object sets, ZAPs, ...) and file data have
+ * separate byte budgets, so reading large files does not push the MOS and
+ * directories out of the cache. Entries are spread over several shards,
+ * each with its own lock and LRU lists.
+ */
+class ZFS_ARC {
+
+public:
+    typedef std::shared_ptr<const std::vector<char>> Block;
+
+    ZFS_ARC(uint64_t metadataCapacity = DEFAULT_METADATA_CAPACITY, uint64_t dataCapacity = DEFAULT_DATA_CAPACITY);
+    ~ZFS_ARC() = default;
+
+    Block lookup(uint64_t vdev, uint64_t offset, uint64_t birth, bool countMiss = true);
+    bool contains(uint64_t vdev, uint64_t offset, uint64_t birth) const;
+    void insert(uint64_t vdev, uint64_t offset, uint64_t birth, bool metadata, Block block);
+    void setCapacity(uint64_t metadataCapacity, uint64_t dataCapacity);
+    void clear();
+
+    uint64_t getCapacity(bool metadata) const;
+    uint64_t getUsedBytes(bool metadata) const;
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getEvictions() const;
+    void printStatistics(std::ostream &os) const;
+
+    static const uint64_t DEFAULT_METADATA_CAPACITY = 64 * 1024 * 1024;
+    static const uint64_t DEFAULT_DATA_CAPACITY = 128 * 1024 * 1024;
+    static const int NO_SHARDS = 16;
+
+private:
+    struct Key {
+        uint64_t vdev;
+        uint64_t offset;
+        uint64_t birth;
+
+        bool operator==(const Key &other) const {
+            return vdev == other.vdev && offset == other.offset && birth == other.birth;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry {
+        Key key;
+        Block block;
+        bool metadata;
+    };
+
+    //one LRU list per kind of block, most recently used first
+    struct Shard {
+        mutable std::mutex lock;
+        std::list<Entry> lru[2];
+        uint64_t capacity[2];
+        uint64_t usedBytes[2];
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> entries;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+    };
+
+    mutable Shard shards[NO_SHARDS];
+
+    Shard &getShard(const Key &key) const;
+    void evict(Shard &shard, bool metadata);
+};
+
+#endif //ZFS_FTK_ZFS_ARC_H
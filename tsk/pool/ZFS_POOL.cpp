@@ -16,10 +16,20 @@
 #include "../fs/zfs/ObjectSet.h"
 #include "../fs/zfs/Dnode.h"
 #include "../fs/zfs/ZAP.h"
+#include "../fs/zfs/Catalog.h"
+#include "RAIDZ.h"
+#include "ZFS_Scrub.h"
+#include "../fs/zfs/Compression.h"
+#include <algorithm>
+#include <functional>
+#include "../utils/ThreadPool.h"
+
+//bytes icat reads from an object before writing them out
+static const uint64_t ICAT_CHUNK_SIZE = 1024 * 1024;
 
 ZFS_POOL::ZFS_POOL(TSK_POOL_INFO *pool)
-        : vdevs(), availableIDs(), no_all_vdevs(0), pool_guid(0), name(""), reconstructable(true), pool(pool),
-          uberblock_array(nullptr) {
+        : vdevs(), vdevsByID(), availableIDs(), no_all_vdevs(0), pool_guid(0), name(""), reconstructable(true), pool(pool),
+          uberblock_array(nullptr), damagedCopies(), arc(), catalogs() {
     NVList *list = nullptr;
     NVList *vdev_tree = nullptr; //part of the list containing information about subtree
     std::vector<char> diskData(112 * 1024);
@@ -47,11 +57,20 @@ ZFS_POOL::ZFS_POOL(TSK_POOL_INFO *pool)
             initialized = true;
         }
 
+        //top-level vdev IDs are numbered from 0 to vdev_children - 1
+        if (vdev_tree->getIntValue("id") >= no_all_vdevs) {
+            delete list;
+            throw "No valid ZFS Pool";
+        }
+
         //if vdev not yet created
         auto temp = getVdevByID(vdev_tree->getIntValue("id"));
         if (temp == nullptr) {
             temp = new ZFS_VDEV(list);
             vdevs.push_back(temp);
+            if (temp->getID() >= vdevsByID.size())
+                vdevsByID.resize(temp->getID() + 1, nullptr);
+            vdevsByID[temp->getID()] = temp;
         }
         delete list;
 
@@ -61,25 +80,51 @@ ZFS_POOL::ZFS_POOL(TSK_POOL_INFO *pool)
     }
     checkReconstructable();
 
-    //get uberblock array
-    //TODO: multiple uberblock arrays from available disks
-    //until then: get the array with the most recent block
-    //get any child that is available
-    int highestTXG = 0;
-    UberblockArray* temp_array = nullptr;
-    for (int i = 0; i < vdevs.size(); i++){
-        pool->readData(vdevs.at(i)->getID(), UberblockArray::START_UBERBLOCKARRAY, diskData, UberblockArray::SIZE_UBERBLOCKARRAY);
-        uberblock_array = new UberblockArray(TSK_LIT_ENDIAN, (uint8_t *) diskData.data(), this);
-        if(uberblock_array->getMostrecent()->getTXG() > highestTXG){
-            delete temp_array;
-            temp_array = uberblock_array;
-            highestTXG = uberblock_array->getMostrecent()->getTXG();
+    //read the uberblock arrays of all four labels of all available devices concurrently
+    struct LabelRead {
+        TSK_IMG_INFO *img;
+        uint64_t offset;
+        std::vector<char> data;
+    };
+    std::vector<LabelRead> labels;
+    for (auto vdev : vdevs) {
+        for (uint64_t i = 0; i < vdev->getNoChildren(); i++) {
+            const ZFS_DEVICE &device = vdev->getChild(i);
+            if (!device.available || device.img == nullptr ||
+                device.img->size < UberblockArray::NO_LABELS * UberblockArray::SIZE_LABEL)
+                continue;
+            for (int label = 0; label < UberblockArray::NO_LABELS; label++)
+                labels.push_back({device.img, UberblockArray::getLabelOffset(device.img->size, label), {}});
         }
     }
-    uberblock_array = temp_array;
+
+    std::vector<std::future<void>> pending;
+    for (auto &label : labels) {
+        pending.push_back(ThreadPool::shared().submit([&label]() {
+            label.data.resize(UberblockArray::SIZE_UBERBLOCKARRAY);
+            if (tsk_img_read(label.img, label.offset + UberblockArray::START_UBERBLOCKARRAY, label.data.data(),
+                             label.data.size()) != (ssize_t) label.data.size())
+                label.data.clear();
+        }));
+    }
+    ThreadPool::waitAll(pending);
+
+    //merge them into one index of all TXGs, in label order so the result does not depend on timing
+    uberblock_array = new UberblockArray(TSK_LIT_ENDIAN, this);
+    for (auto &label : labels) {
+        if (!label.data.empty())
+            uberblock_array->addArray((uint8_t *) label.data.data(), label.offset);
+    }
+    uberblock_array->finish();
+    if (tsk_verbose)
+        tsk_fprintf(stderr, "ZFS_POOL: %" PRIuSIZE " uberblocks with distinct TXGs in %" PRIuSIZE " labels\n",
+                    uberblock_array->getUberblocks().size(), labels.size());
 }
 
 ZFS_POOL::~ZFS_POOL() {
+    invalidateCatalogs();
+    if (tsk_verbose)
+        arc.printStatistics(cerr);
     for (auto it : vdevs) {
         delete it;
     }
@@ -106,18 +151,122 @@ void ZFS_POOL::checkReconstructable() {
 }
 
 ZFS_VDEV *ZFS_POOL::getVdevByID(uint64_t id) {
-    for (int i = 0; i < vdevs.size(); i++) {
-        if (vdevs.at(i)->getID() == id)
-            return vdevs.at(i);
-    }
-    return nullptr;
+    if (id >= vdevsByID.size())
+        return nullptr;
+    return vdevsByID[id];
 }
 
 void ZFS_POOL::readRawData(int dev, uint64_t offset, uint64_t size, vector<char> &buffer) {
     pool->readData(dev, offset, buffer, size);
 }
 
-void ZFS_POOL::readData(int tvdev_id, uint64_t offset, uint64_t length, vector<char> &buffer) {
+/*
+ * Read the columns first to last - 1 of a raidz row. Each child has its own
+ * reader, so the columns are read concurrently, the calling thread reads
+ * the first one itself. Columns whose child is unavailable or whose read
+ * fails are zero filled and marked as not present.
+ */
+static void readRaidzColumns(ZFS_VDEV *vdev, const vector<RAIDZ_COL> &dataCols, vector<vector<char>> &columns,
+                             vector<bool> &present, uint64_t first, uint64_t last) {
+    if (first >= last)
+        return;
+
+    vector<char> success(last, 0);
+    auto readColumn = [&](uint64_t c) {
+        vector<char> &column = columns.at(c);
+        const ZFS_DEVICE &child = vdev->getChild(dataCols.at(c).devid);
+        if (column.empty()) {
+            success[c] = 1;
+        } else if (child.available && child.img != nullptr) {
+            ssize_t read = tsk_img_read(child.img, (dataCols.at(c).offset + 0x400000), column.data(), column.size());
+            success[c] = (read == (ssize_t) column.size());
+        }
+        if (!success[c])
+            std::fill(column.begin(), column.end(), 0);
+    };
+
+    vector<std::future<void>> pending;
+    for (uint64_t c = first + 1; c < last; c++) {
+        pending.push_back(vdev->getReader(dataCols.at(c).devid).submit([&readColumn, c]() { readColumn(c); }));
+    }
+    readColumn(first);
+    ThreadPool::waitAll(pending);
+
+    for (uint64_t c = first; c < last; c++)
+        present[c] = success[c];
+}
+
+static void assembleRaidzData(const vector<vector<char>> &columns, uint64_t nparity, vector<char> &buffer) {
+    buffer.resize(0);
+    for (uint64_t c = nparity; c < columns.size(); c++)
+        buffer.insert(buffer.end(), columns.at(c).begin(), columns.at(c).end());
+}
+
+/*
+ * A raidz row whose block fails its checksum has damaged columns that read
+ * without error. Rebuild each data column from parity in turn, then each
+ * pair and so on, up to as many columns as there is parity left, until the
+ * block matches its checksum. On success the row is replaced by the
+ * repaired one.
+ * Returns false if no combination matches.
+ */
+static bool repairRaidzRow(ZFS_VDEV *vdev, const vector<RAIDZ_COL> &dataCols, vector<vector<char>> &columns,
+                           const vector<bool> &present, uint64_t nparity, const Blkptr *blkptr,
+                           vector<char> &buffer) {
+    uint64_t missing = std::count(present.begin(), present.end(), false);
+    if (missing >= nparity)
+        return false;
+
+    vector<uint64_t> candidates;
+    for (uint64_t c = nparity; c < columns.size(); c++) {
+        if (present[c] && !columns[c].empty())
+            candidates.push_back(c);
+    }
+
+    for (uint64_t k = 1; k <= nparity - missing && k <= candidates.size(); k++) {
+        //first combination of k candidates, advanced like an odometer
+        vector<uint64_t> pick(k);
+        for (uint64_t i = 0; i < k; i++)
+            pick[i] = i;
+
+        while (true) {
+            vector<vector<char>> row(columns);
+            vector<bool> rowPresent(present);
+            for (uint64_t i : pick)
+                rowPresent[candidates[i]] = false;
+            if (raidzReconstruct(row, nparity, rowPresent)) {
+                assembleRaidzData(row, nparity, buffer);
+                if (blkptr->checksumMatches(buffer)) {
+                    for (uint64_t i : pick) {
+                        const RAIDZ_COL &col = dataCols.at(candidates[i]);
+                        cerr << "Rebuilt damaged column at " << std::hex << col.offset << std::dec << " on child "
+                             << col.devid << " of raidz vdev " << vdev->getID() << " from parity" << endl;
+                    }
+                    columns.swap(row);
+                    return true;
+                }
+            }
+
+            uint64_t i = k;
+            while (i > 0 && pick[i - 1] == candidates.size() - k + i - 1)
+                i--;
+            if (i == 0)
+                break;
+            pick[i - 1]++;
+            for (uint64_t j = i; j < k; j++)
+                pick[j] = pick[j - 1] + 1;
+        }
+    }
+    return false;
+}
+
+/*
+ * Read length bytes at offset of a top-level vdev. With a block pointer the
+ * data is checked against its checksum: other mirror sides are tried and
+ * damaged raidz columns are rebuilt from parity until it matches.
+ * Returns false if a block pointer is given and no data matches it.
+ */
+bool ZFS_POOL::readData(int tvdev_id, uint64_t offset, uint64_t length, vector<char> &buffer, const Blkptr *blkptr) {
     //get corresponding tvdev
     ZFS_VDEV *vdev = getVdevByID(tvdev_id);
     string vdev_type = vdev->getType();
@@ -126,16 +275,20 @@ void ZFS_POOL::readData(int tvdev_id, uint64_t offset, uint64_t length, vector<c
 
     if (vdev_type == "file" || vdev_type == "disk") {
         int s = tsk_img_read(vdev->getChild(0).img, (offset+0x400000), buffer.data(), length);
+        return blkptr == nullptr || blkptr->checksumMatches(buffer);
     } else if (vdev_type == "mirror") {
-        //get any child that is available
-        ZFS_DEVICE temp;
+        //read available children until one of them holds a good copy
         for (int i = 0; i < vdev->getNoChildren(); i++) {
-            temp = vdev->getChild(i);
+            const ZFS_DEVICE &temp = vdev->getChild(i);
             if (temp.available) {
                 tsk_img_read(temp.img, (offset+0x400000), buffer.data(), length);
-                break;
+                if (blkptr == nullptr || blkptr->checksumMatches(buffer))
+                    return true;
+                cerr << "Checksum mismatch for block at " << tvdev_id << ":" << std::hex << offset << std::dec
+                     << " on mirror child " << temp.id << endl;
             }
         }
+        return false;
     } else if (vdev_type == "raidz") {
         // algorithm based on: https://github.com/zfsonlinux/zfs/blob/master/module/zfs/vdev_raidz.c
         std::vector<RAIDZ_COL> dataCols;
@@ -209,54 +362,158 @@ void ZFS_POOL::readData(int tvdev_id, uint64_t offset, uint64_t length, vector<c
                 rm_skipstart = 1;
         }
 
-        buffer.resize(0);
-        vector<char> diskData;
-        for (c = rm_firstdatacol; c < dataCols.size(); c++){
-            diskData.resize(dataCols.at(c).size);
-            tsk_img_read(vdev->getChild(dataCols.at(c).devid).img, (dataCols.at(c).offset+0x400000),
-                                 diskData.data(), dataCols.at(c).size);
-            buffer.insert(buffer.end(), diskData.data(), diskData.data() + dataCols.at(c).size);
+        //columns from acols on are skip sectors without data
+        vector<vector<char>> columns(acols);
+        vector<bool> present(acols, false);
+        for (c = 0; c < acols; c++)
+            columns.at(c).resize(dataCols.at(c).size);
+
+        //parity is only read when a data column cannot be read or the block is damaged
+        bool parityRead = false;
+        readRaidzColumns(vdev, dataCols, columns, present, rm_firstdatacol, acols);
+        if (std::find(present.begin() + rm_firstdatacol, present.end(), false) != present.end()) {
+            readRaidzColumns(vdev, dataCols, columns, present, 0, rm_firstdatacol);
+            parityRead = true;
+            if (!raidzReconstruct(columns, rm_firstdatacol, present)) {
+                cerr << "Too many columns of raidz vdev " << vdev->getID() << " missing at offset " << std::hex
+                     << offset << std::dec << "!" << endl;
+            }
         }
+
+        assembleRaidzData(columns, rm_firstdatacol, buffer);
+        if (blkptr == nullptr || blkptr->checksumMatches(buffer))
+            return true;
+
+        if (!parityRead)
+            readRaidzColumns(vdev, dataCols, columns, present, 0, rm_firstdatacol);
+        return repairRaidzRow(vdev, dataCols, columns, present, rm_firstdatacol, blkptr, buffer);
     } else {
         cerr << "vdev type '" << vdev_type << "' is not supported!" << endl;
     }
+    return blkptr == nullptr;
 }
 
-void ZFS_POOL::readData(Blkptr *blkptr, vector<char> &buffer, bool decompress) {
-    ZFS_VDEV* vdev = nullptr;
-    dva goodDVA;
+/*
+ * Read the block a block pointer points to and verify its checksum on the
+ * data that was read. Copies are tried in DVA order until one matches.
+ * Copies that failed are remembered, so they are not read again; damage is
+ * rare, so this set stays small while good copies are never recorded.
+ * Decompressed blocks are kept in the block cache, so repeated reads of the
+ * same block are served from memory without reading or hashing them again.
+ * Returns false if no copy matches its checksum.
+ */
+bool ZFS_POOL::readData(const Blkptr *blkptr, vector<char> &buffer, bool decompress) {
+    uint64_t size = blkptr->getPsize();
+    uint64_t size_decompressed = blkptr->getLsize();
+    bool copyRead = false;
+    bool verified = false;
+    dva copy;
+
+    //blocks in the ARC were verified when they were read, the physical data
+    //of an uncompressed block is its logical data; a block counts one miss,
+    //not one per copy
+    if (decompress || blkptr->getCompression() == ZIO_COMPRESS_OFF) {
+        int lastCopy = -1;
+        for (int i = 0; i < 3; i++) {
+            if (blkptr->getDVA(i).asize != 0)
+                lastCopy = i;
+        }
+        for (int i = 0; i <= lastCopy; i++) {
+            copy = blkptr->getDVA(i);
+            if (copy.asize == 0)
+                continue;
+            ZFS_ARC::Block cached = arc.lookup(copy.vdev, copy.offset, blkptr->getBirthTXG(), i == lastCopy);
+            if (cached != nullptr) {
+                buffer.assign(cached->begin(), cached->end());
+                return true;
+            }
+        }
+    }
+
+    for (int i = 0; i < 3 && !verified; i++) {
+        copy = blkptr->getDVA(i);
+        if (copy.asize == 0 || this->getVdevByID(copy.vdev) == nullptr)
+            continue;
+
+        std::array<uint64_t, 6> key = {{copy.vdev, copy.offset, blkptr->getChecksum(0), blkptr->getChecksum(1),
+                                         blkptr->getChecksum(2), blkptr->getChecksum(3)}};
+        {
+            std::lock_guard<std::mutex> guard(damagedCopiesLock);
+            if (damagedCopies.count(key) != 0)
+                continue;
+        }
 
-    for (int i = 0; i < 3 && vdev == nullptr; i++) {
-        vdev = this->getVdevByID(blkptr->getDVA(i).vdev);
-        goodDVA = blkptr->getDVA(i);
+        verified = this->readData(copy.vdev, copy.offset, size, buffer, blkptr);
+        copyRead = true;
+        if (!verified) {
+            {
+                std::lock_guard<std::mutex> guard(damagedCopiesLock);
+                damagedCopies.insert(key);
+            }
+            cerr << "Checksum mismatch for block at " << copy.vdev << ":" << std::hex << copy.offset << std::dec
+                 << endl;
+        }
     }
 
-    if(vdev == nullptr){
+    if (!copyRead) {
+        //all copies of a block pointer that passed construction point to vdevs that are missing
+        bool missing = true;
+        for (int i = 0; i < 3; i++) {
+            dva copy = blkptr->getDVA(i);
+            if (copy.asize != 0 && this->getVdevByID(copy.vdev) != nullptr)
+                missing = false;
+        }
+        if (!missing)
+            return false;
+
         cerr << "No top-level vdev of DVA available!" << endl;
-        uint64_t size = blkptr->getPsize();
-        uint64_t size_decompressed = blkptr->getLsize();
         buffer.resize(size);
         if (buffer.size() != size_decompressed && decompress) {
             buffer.resize(size_decompressed);
         }
         //fill missing blocks with zeros
         std::fill(buffer.begin(), buffer.end(), 0);
-        return;
+        return true;
     }
 
-    uint64_t size = blkptr->getPsize();
-    uint64_t size_decompressed = blkptr->getLsize();
-    string vdev_type = vdev->getType();
+    if (!verified)
+        return false;
 
-    this->readData(goodDVA.vdev, goodDVA.offset, size, buffer);
+    if (decompress) {
+        if (!decompressBlock(blkptr, buffer)) {
+            cerr << "Cannot decompress block at " << copy.vdev << ":" << std::hex << copy.offset << std::dec
+                 << " (" << zioCompressionName(blkptr->getCompression()) << ")" << endl;
+            return false;
+        }
+        arc.insert(copy.vdev, copy.offset, blkptr->getBirthTXG(), blkptr->isMetadata(),
+                   std::make_shared<const vector<char>>(buffer));
+    }
+    return true;
+}
 
-    //decompress
-    if (buffer.size() != size_decompressed && decompress) {
-        vector<char> v(buffer);
-        buffer.resize(size_decompressed);
-        uint32_t bufferLength = read32Bit(TSK_BIG_ENDIAN, (uint8_t *) v.data());
-        LZ4_decompress_safe(v.data() + 4, buffer.data(), bufferLength, size_decompressed);
+/*
+ * Whether a verified copy of the block is in the block cache.
+ */
+bool ZFS_POOL::isCached(const Blkptr *blkptr) const {
+    for (int i = 0; i < 3; i++) {
+        dva copy = blkptr->getDVA(i);
+        if (copy.asize != 0 && arc.contains(copy.vdev, copy.offset, blkptr->getBirthTXG()))
+            return true;
     }
+    return false;
+}
+
+/*
+ * Turn the physical data of a block into its logical data, with the
+ * algorithm named in the block pointer.
+ * Returns false if the algorithm is not supported or the data is corrupt.
+ */
+bool ZFS_POOL::decompressBlock(const Blkptr *blkptr, vector<char> &buffer) {
+    vector<char> physical;
+    physical.swap(buffer);
+    buffer.resize(blkptr->getLsize());
+    return zioDecompress(blkptr->getCompression(), (uint8_t *) physical.data(), physical.size(),
+                         (uint8_t *) buffer.data(), buffer.size());
 }
 
 void ZFS_POOL::print(std::ostream &os) const {
@@ -288,7 +545,7 @@ ostream &operator<<(ostream &os, const ZFS_POOL &pool) {
 ObjectSet* ZFS_POOL::getMOS(Uberblock *uberblock) {
     //read MOS block pointer
     vector<char> diskData;;
-    Blkptr *mos_ptr = uberblock->getRootbp();
+    const Blkptr *mos_ptr = uberblock->getRootbp();
     this->readData(mos_ptr, diskData);
     return new ObjectSet(TSK_LIT_ENDIAN, (uint8_t *) diskData.data(), this);
 }
@@ -297,7 +554,8 @@ std::map<string, uint64_t> ZFS_POOL::getDatasets(ObjectSet *MOS) {
     std::map<string, uint64_t> datasets;
 
     auto rootDatasetDirectory = MOS->getDnode(getRootdatasetDirectoryID(MOS));
-    auto childDirID = rootDatasetDirectory->getBonusValue("dd_child_dir_zapobj");
+    const dsl_dir_phys *directory = rootDatasetDirectory->getDatasetDirectory();
+    auto childDirID = directory != nullptr ? directory->dd_child_dir_zapobj : 0;
     auto entries = getZapEntriesFromChildZapObject(MOS->getDnode(childDirID));
     auto path = this->getPoolName();
     datasets.insert(std::pair<string, uint64_t>(path, getRootdatasetDirectoryID(MOS)));
@@ -313,12 +571,53 @@ std::map<string, uint64_t> ZFS_POOL::getDatasets(ObjectSet *MOS) {
 }
 
 string ZFS_POOL::getPoolName() {
-    // extracts the pool name from the NV list at the beginning
-    vector<char> diskData;
-    this->readRawData(0, 0x4004, (112 * 1024), diskData);
-    NVList list(TSK_BIG_ENDIAN, (uint8_t *) diskData.data());
+    //read from the label when the pool was opened
+    return this->name;
+}
+
+/*
+ * Catalog of the datasets as of the uberblock with the given TXG, or as of
+ * the most recent uberblock for -1. Built on first use and kept until it
+ * is invalidated.
+ */
+Catalog *ZFS_POOL::getCatalog(int uberblock) {
+    Uberblock *usedUberblock;
 
-    return list.getStringValue("name");
+    if(uberblock == -1) {
+        usedUberblock = this->getMostrecentUberblock();
+    } else {
+        usedUberblock = this->getUberblockArray()->getByTXG(uberblock);
+        cerr << "Using TXG: " << uberblock << endl;
+    }
+
+    if (usedUberblock == nullptr) {
+        cerr << "No uberblock with TXG " << uberblock << " found!" << endl;
+        return nullptr;
+    }
+
+    auto found = catalogs.find(usedUberblock->getTXG());
+    if (found != catalogs.end())
+        return found->second;
+
+    Catalog *catalog = new Catalog(this, usedUberblock);
+    catalogs[usedUberblock->getTXG()] = catalog;
+    return catalog;
+}
+
+//drop the catalog of a TXG, e.g. after the uberblocks were read again
+void ZFS_POOL::invalidateCatalog(uint64_t txg) {
+    auto found = catalogs.find(txg);
+    if (found != catalogs.end()) {
+        delete found->second;
+        catalogs.erase(found);
+    }
+}
+
+void ZFS_POOL::invalidateCatalogs() {
+    for (auto &it : catalogs) {
+        delete it.second;
+    }
+    catalogs.clear();
 }
 
 ObjectSet* ZFS_POOL::getObjectSetFromDnode(Dnode *dnode) {
@@ -352,28 +651,28 @@ void ZFS_POOL::listFiles(ObjectSet *os, uint64_t dnodeID, std::map<string, uint6
         nextObjectSet = os;
     }
 
-    for (auto& it : zap->entries) {
-        uint64_t value = it.second;
-        uint8_t type = *(((uint8_t *) &(it.second)) + 7);
+    //entries are streamed from the directory, in on-disk order
+    zap->forEach([&](const string &name, uint64_t value) {
+        uint8_t type = *(((uint8_t *) &value) + 7);
         if (type == 0x80) {
-            cout << std::string(tabLevel * 4, tab) << "|---" << it.first << " : " << unsigned(value) << std::endl;
+            cout << std::string(tabLevel * 4, tab) << "|---" << name << " : " << unsigned(value) << std::endl;
         } else if (type == 0x40) {
             //for snapshots, this will never be the case (good to avoid inconsistencies)
-            if (datasets.find(path + "/" + it.first) == datasets.end()) {
-                cout << std::string(tabLevel * 4, tab) << "|---" << it.first << " : " << unsigned(value)
+            if (datasets.find(path + "/" + name) == datasets.end()) {
+                cout << std::string(tabLevel * 4, tab) << "|---" << name << " : " << unsigned(value)
                      << " (Directory)" << std::endl;
-                this->listFiles(nextObjectSet, unsigned(value), datasets, true, (path + "/" + it.first),
+                this->listFiles(nextObjectSet, unsigned(value), datasets, true, (path + "/" + name),
                           tabLevel + 1);
             } else {
-                cout << std::string(tabLevel * 4, tab) << "|---" << it.first << " : " << unsigned(value)
+                cout << std::string(tabLevel * 4, tab) << "|---" << name << " : " << unsigned(value)
                      << " (Dataset)" << std::endl;
-                this->listFiles(MOS, getHeaddatasetID(MOS, datasets[path + "/" + it.first]), datasets, FALSE,
-                          (path + "/" + it.first), tabLevel + 1);
+                this->listFiles(MOS, getHeaddatasetID(MOS, datasets[path + "/" + name]), datasets, FALSE,
+                          (path + "/" + name), tabLevel + 1);
             }
         } else {
-            cout << it.first << " : " << unsigned(value) << "(" << unsigned(type) << ")" << std::endl;
+            cout << name << " : " << unsigned(value) << "(" << unsigned(type) << ")" << std::endl;
         }
-    }
+    });
     if(!isDirectory) {
         delete nextObjectSet;
     }
@@ -384,20 +683,12 @@ void ZFS_POOL::listFiles(ObjectSet *os, uint64_t dnodeID, std::map<string, uint6
 //file system specific functions
 
 void ZFS_POOL::fsstat(string str_dataset, int uberblock) {
+    Catalog *catalog = this->getCatalog(uberblock);
+    if (catalog == nullptr)
+        return;
 
-    Uberblock *usedUberblock;
-
-    if(uberblock == -1) {
-        usedUberblock = this->getMostrecentUberblock();
-    } else {
-        usedUberblock = this->getUberblockArray()->getByTXG(uberblock);
-        cerr << "Using TXG: " << uberblock << endl;
-    }
-
-    ObjectSet *MOS = this->getMOS(usedUberblock);
-    //parse object set and create MOS
-    std::map<string, uint64_t> datasets = this->getDatasets(MOS);
-    uint64_t rootDatasetDirectoryID = getRootdatasetDirectoryID(MOS);
+    ObjectSet *MOS = catalog->getMOS();
+    const std::map<string, uint64_t> &datasets = catalog->getDatasets();
 
     if (str_dataset != "") {
         bool snapshot = false;
@@ -414,15 +705,17 @@ void ZFS_POOL::fsstat(string str_dataset, int uberblock) {
         else {
             if(not snapshot){
                 Dnode *dataset = MOS->getDnode(getHeaddatasetID(MOS,datasets.find(str_dataset)->second));
-                cout << "Creation Time: \t" << timestampToDateString(dataset->getBonusValue("ds_creation_time")) << endl;
-                cout << "Creation TXG: \t" << dataset->getBonusValue("ds_creation_txg") << endl;
-                cout << "FSID GUID: \t" << dataset->getBonusValue("ds_fsid_guid") << endl;
-                cout << "Parent Dir.: \t" << dataset->getBonusValue("ds_dir_obj") << endl;
-                //cout << "Number of Children: \t" << dataset->getBonusValue("ds_num_children") << endl;
-                cout << "Used Bytes: \t" << dataset->getBonusValue("ds_used_bytes") << endl;
-
-                std::map<string, uint64_t> snapshots;
-                getSnapshots(MOS, datasets.find(str_dataset)->second, &snapshots);
+                const dsl_dataset_phys *bonus = dataset != nullptr ? dataset->getDataset() : nullptr;
+                if (bonus != nullptr) {
+                    cout << "Creation Time: \t" << timestampToDateString(bonus->ds_creation_time) << endl;
+                    cout << "Creation TXG: \t" << bonus->ds_creation_txg << endl;
+                    cout << "FSID GUID: \t" << bonus->ds_fsid_guid << endl;
+                    cout << "Parent Dir.: \t" << bonus->ds_dir_obj << endl;
+                    //cout << "Number of Children: \t" << bonus->ds_num_children << endl;
+                    cout << "Used Bytes: \t" << bonus->ds_used_bytes << endl;
+                }
+
+                const std::map<string, uint64_t> &snapshots = catalog->getSnapshots(datasets.find(str_dataset)->second);
                 if(snapshots.size() > 0){
                     cout << endl << "Snapshots of dataset: " << str_dataset << endl;
                     cout << "-----------------------------------------------" << endl;
@@ -435,17 +728,19 @@ void ZFS_POOL::fsstat(string str_dataset, int uberblock) {
 
             }
             else if(snapshot){
-                std::map<string, uint64_t> snapshots;
-                getSnapshots(MOS, datasets.find(str_dataset)->second, &snapshots);
+                const std::map<string, uint64_t> &snapshots = catalog->getSnapshots(datasets.find(str_dataset)->second);
                 if (snapshots.find(str_snapshot) == snapshots.end())
                     cout << "Dataset " << str_dataset << " does not have a snapshot named " << str_snapshot << "!" << endl;
                 else{
                     Dnode *dataset = MOS->getDnode(snapshots.find(str_snapshot)->second);
-                    cout << "Creation Time: \t" << timestampToDateString(dataset->getBonusValue("ds_creation_time")) << endl;
-                    cout << "Creation TXG: \t" << dataset->getBonusValue("ds_creation_txg") << endl;
-                    cout << "FSID GUID: \t" << dataset->getBonusValue("ds_fsid_guid") << endl;
-                    //cout << "ID of most recent snapshot: \t" << dataset->getBonusValue("ds_next_snap_obj") << endl;
-                    cout << "Used Bytes: \t" << dataset->getBonusValue("ds_used_bytes") << endl;
+                    const dsl_dataset_phys *bonus = dataset != nullptr ? dataset->getDataset() : nullptr;
+                    if (bonus != nullptr) {
+                        cout << "Creation Time: \t" << timestampToDateString(bonus->ds_creation_time) << endl;
+                        cout << "Creation TXG: \t" << bonus->ds_creation_txg << endl;
+                        cout << "FSID GUID: \t" << bonus->ds_fsid_guid << endl;
+                        //cout << "ID of most recent snapshot: \t" << bonus->ds_next_snap_obj << endl;
+                        cout << "Used Bytes: \t" << bonus->ds_used_bytes << endl;
+                    }
                 }
             }
         }
@@ -458,187 +753,358 @@ void ZFS_POOL::fsstat(string str_dataset, int uberblock) {
 }
 
 void ZFS_POOL::fls(string str_dataset, int uberblock){
-    Uberblock *usedUberblock;
-
-    if(uberblock == -1) {
-        usedUberblock = this->getMostrecentUberblock();
-    } else {
-        usedUberblock = this->getUberblockArray()->getByTXG(uberblock);
-        cerr << "Using TXG: " << uberblock << endl;
-    }
+    Catalog *catalog = this->getCatalog(uberblock);
+    if (catalog == nullptr)
+        return;
 
-    ObjectSet *MOS = this->getMOS(usedUberblock);
-    std::map<string, uint64_t> datasets = this->getDatasets(MOS);
-    uint64_t rootDatasetDirectoryID = getRootdatasetDirectoryID(MOS);
+    ObjectSet *MOS = catalog->getMOS();
+    const std::map<string, uint64_t> &datasets = catalog->getDatasets();
 
     if (str_dataset != "") {
-        bool snapshot = false;
-        std::string str_snapshot = "";
-
-        if(string(str_dataset).find('@') != string::npos){
-            snapshot = true;
-            str_snapshot = string(str_dataset).substr(string(str_dataset).find('@')+1);
-            str_dataset = string(str_dataset).substr(0, string(str_dataset).find('@'));
-        }
-
-        if (datasets.find(str_dataset) == datasets.end()) {
-            cerr << "No dataset named " << str_dataset << " found!" << endl;
-        } else {
-            if (!snapshot) {
-                listFiles(MOS, getHeaddatasetID(MOS, datasets.find(str_dataset)->second), datasets, FALSE,
-                          str_dataset);
-            }
-            if (snapshot) {
-                std::map<string, uint64_t> snapshots;
-                getSnapshots(MOS, datasets.find(str_dataset)->second, &snapshots);
-                if (snapshots.find(str_snapshot) == snapshots.end()) {
-                    cerr << "Dataset " << str_dataset << " does not have a snapshot named " << str_snapshot << "!"
-                         << endl;
-                } else {
-                    listFiles(MOS, snapshots.find(str_snapshot)->second, datasets, FALSE, str_dataset);
-                }
-            }
+        uint64_t datasetID = catalog->findDataset(str_dataset);
+        if (datasetID != 0) {
+            listFiles(MOS, datasetID, datasets, FALSE, str_dataset.substr(0, str_dataset.find('@')));
         }
     } else {
-        listFiles(MOS, getHeaddatasetID(MOS, rootDatasetDirectoryID), datasets, FALSE, this->getPoolName());
+        listFiles(MOS, getHeaddatasetID(MOS, catalog->getRootDatasetDirectoryID()), datasets, FALSE,
+                  this->getPoolName());
+    }
+}
+
+/*
+ * Dnode of an object in a dataset or snapshot, or in the MOS.
+ * Returns nullptr if there is no such object.
+ */
+Dnode *ZFS_POOL::findObject(Catalog *catalog, int object_number, string str_dataset) {
+    if (str_dataset == ""){
+        str_dataset = this->name;
     }
 
-    delete MOS;
+    if (str_dataset == "MOS")
+        return catalog->getMOS()->getDnode(object_number);
+
+    uint64_t datasetID = catalog->findDataset(str_dataset);
+    if (datasetID == 0)
+        return nullptr;
+
+    ObjectSet *dataset = catalog->getObjectSet(datasetID);
+    if (dataset == nullptr)
+        return nullptr;
+    return dataset->getDnode(object_number);
 }
 
 void ZFS_POOL::istat(int object_number, string str_dataset, int uberblock) {
-    Uberblock *usedUberblock;
+    Catalog *catalog = this->getCatalog(uberblock);
+    if (catalog == nullptr)
+        return;
 
-    if(uberblock == -1) {
-        usedUberblock = this->getMostrecentUberblock();
+    Dnode *dnode = this->findObject(catalog, object_number, str_dataset);
+    if (dnode == nullptr) {
+        cerr << "object with number " << object_number << " does not exist!" << endl;
     } else {
-        usedUberblock = this->getUberblockArray()->getByTXG(uberblock);
-        cerr << "Using TXG: " << uberblock << endl;
+        cout << *dnode << endl;
     }
+}
 
-    ObjectSet *MOS = this->getMOS(usedUberblock);
-    std::map<string, uint64_t> datasets = this->getDatasets(MOS);
+void ZFS_POOL::icat(int object_number, string str_dataset, int uberblock) {
+    Catalog *catalog = this->getCatalog(uberblock);
+    if (catalog == nullptr)
+        return;
 
-    if (str_dataset == ""){
-        str_dataset = this->name;
+    Dnode *dnode = this->findObject(catalog, object_number, str_dataset);
+    if (dnode == nullptr) {
+        cerr << "object with number " << object_number << " does not exist!" << endl;
+        return;
+    } else if (dnode->getBlkptr(0) == nullptr) {
+        //e.g. a DSL dataset, its data is the object set its bonus block pointer refers to
+        std::vector<char> data;
+        dnode->getData(data);
+        std::cout.write(data.data(), data.size());
+    } else {
+        //stream the object a chunk at a time, so its size is not limited by memory
+        uint64_t size;
+        if (dnode->getType() == DMU_OT_DIRECTORY_CONTENTS)
+            size = (dnode->getMaxBlockID() + 1) * dnode->getDataBlockSize();
+        else
+            size = dnode->getSize();
+
+        uint64_t blockSize = dnode->getDataBlockSize();
+        if (blockSize == 0)
+            return;
+        uint64_t chunkSize = std::max<uint64_t>(ICAT_CHUNK_SIZE / blockSize, 1) * blockSize;
+        std::vector<char> chunk(chunkSize);
+        for (uint64_t offset = 0; offset < size && std::cout; offset += chunkSize) {
+            uint64_t length = std::min(chunkSize, size - offset);
+            dnode->read(offset, length, chunk.data());
+            std::cout.write(chunk.data(), length);
+        }
+        std::cout.flush();
     }
+}
+
+/*
+ * The data of a zvol. Reads go through Dnode::read, which reads the volume
+ * blocks of a range in parallel.
+ */
+class ZFS_VOLUME : public TSK_POOL_VOLUME {
+
+private:
+    Dnode *data;
+    uint64_t size;
 
-    std::string str_snapshot = "";
-    Dnode *dnode = nullptr;
+public:
+    ZFS_VOLUME(Dnode *data, uint64_t size) : data(data), size(size) {}
 
-    if(str_dataset == "MOS"){
-        dnode = MOS->getDnode(object_number);
+    uint64_t getSize() const { return size; }
+    uint64_t getBlockSize() const { return data->getDataBlockSize(); }
+
+    bool read(uint64_t offset, uint64_t length, char *buffer) {
+        return data->read(offset, length, buffer) == length;
     }
-    else{
-        bool snapshot = false;
-        if (str_dataset.find('@') != string::npos) {
-            snapshot = true;
-            str_snapshot = string(str_dataset).substr(string(str_dataset).find('@')+1);
-            str_dataset = string(str_dataset).substr(0, string(str_dataset).find('@'));
-        }
+};
 
-        if (datasets.find(str_dataset) == datasets.end()) {
-            cerr << "No dataset named " << str_dataset << " found!" << endl;
-            return;
-        } else {
-            if (!snapshot) {
-                Dnode *datasetDnode = MOS->getDnode(getHeaddatasetID(MOS, datasets.find(str_dataset)->second));
-                ObjectSet *dataset = this->getObjectSetFromDnode(datasetDnode);
-                dnode = dataset->getDnode(object_number);
-            }
-            if (snapshot) {
-                std::map<string, uint64_t> snapshots;
-                getSnapshots(MOS, datasets.find(str_dataset)->second, &snapshots);
-                if (snapshots.find(str_snapshot) == snapshots.end()) {
-                    cerr << "Dataset " << str_dataset << " does not have a snapshot named " << str_snapshot << "!"
-                         << endl;
-                    return;
-                } else {
-                    Dnode *datasetDnode = MOS->getDnode(snapshots.find(str_snapshot)->second);
-                    ObjectSet *dataset = this->getObjectSetFromDnode(datasetDnode);
-                    dnode = dataset->getDnode(object_number);
-                }
-            }
-        }
+/*
+ * Open a zvol given as "dataset" or "dataset@snapshot". Its data is object 1
+ * of the dataset, its size the "size" entry of the properties in object 2.
+ * The volume refers to the pool's catalog and must be closed before the pool.
+ */
+TSK_POOL_VOLUME *ZFS_POOL::openVolume(string str_volume, int uberblock) {
+    if (str_volume == "") {
+        cerr << "ZFS pools have no linear address space, specify a volume" << endl;
+        return nullptr;
     }
 
-    if (dnode == nullptr) {
-        cerr << "object with number " << object_number << " does not exist!" << endl;
-    } else {
-        cout << *dnode << endl;
+    Catalog *catalog = this->getCatalog(uberblock);
+    if (catalog == nullptr)
+        return nullptr;
+
+    Dnode *data = this->findObject(catalog, 1, str_volume);
+    Dnode *properties = this->findObject(catalog, 2, str_volume);
+    if (data == nullptr || data->getType() != DMU_OT_ZVOL || data->getDataBlockSize() == 0) {
+        cerr << str_volume << " is not a volume!" << endl;
+        return nullptr;
     }
 
-    delete MOS;
+    uint64_t size = (data->getMaxBlockID() + 1) * data->getDataBlockSize();
+    if (properties != nullptr && properties->getType() == DMU_OT_ZVOL_PROP) {
+        ZAP zap(TSK_LIT_ENDIAN, properties);
+        zap.lookup("size", size);
+    }
+    return new ZFS_VOLUME(data, size);
 }
 
-void ZFS_POOL::icat(int object_number, string str_dataset, int uberblock) {
+/*
+ * Read every copy of every block reachable from the uberblock, verify its
+ * checksum and report throughput and the copies that did not match.
+ */
+void ZFS_POOL::scrub(int uberblock) {
     Uberblock *usedUberblock;
-
-    if(uberblock == -1) {
+    if (uberblock == -1) {
         usedUberblock = this->getMostrecentUberblock();
     } else {
         usedUberblock = this->getUberblockArray()->getByTXG(uberblock);
         cerr << "Using TXG: " << uberblock << endl;
     }
 
-    ObjectSet *MOS = this->getMOS(usedUberblock);
-    std::map<string, uint64_t> datasets = this->getDatasets(MOS);
-    uint64_t rootDatasetDirectoryID = getRootdatasetDirectoryID(MOS);
-
-    if (str_dataset == ""){
-        str_dataset = this->name;
+    if (usedUberblock == nullptr) {
+        cerr << "No uberblock with TXG " << uberblock << " found!" << endl;
+        return;
     }
 
-    std::string str_snapshot = "";
-    Dnode *dnode = nullptr;
+    ZFS_Scrub scrub(this);
+    scrub.run(usedUberblock);
+    scrub.printReport(cout);
+}
 
-    if(str_dataset == "MOS"){
-        dnode = MOS->getDnode(object_number);
+/*
+ * Print a digest for every regular file of the dataset and its snapshots,
+ * of a single snapshot given as dataset@snapshot, or of all datasets and
+ * snapshots of the pool. Blocks shared between them are read and hashed
+ * once, unchanged files are not read again.
+ */
+void ZFS_POOL::hash(string str_dataset, int uberblock) {
+    Catalog *catalog = this->getCatalog(uberblock);
+    if (catalog == nullptr)
+        return;
+
+    vector<string> names;
+    if (str_dataset.find('@') != string::npos && catalog->findDataset(str_dataset) != 0)
+        names.push_back(str_dataset);
+    for (auto &it : catalog->getDatasets()) {
+        if (!names.empty() || (str_dataset != "" && it.first != str_dataset))
+            continue;
+        names.push_back(it.first);
+        for (auto &snapshot : catalog->getSnapshots(it.second))
+            names.push_back(it.first + "@" + snapshot.first);
     }
-    else{
-        bool snapshot = false;
-        if (str_dataset.find('@') != string::npos) {
-            snapshot = true;
-            str_snapshot = string(str_dataset).substr(string(str_dataset).find('@')+1);
-            str_dataset = string(str_dataset).substr(0, string(str_dataset).find('@'));
+    if (names.empty()) {
+        cerr << "No dataset named " << str_dataset << " found!" << endl;
+        return;
+    }
+
+    POOL_HASH hasher;
+    for (auto &name : names) {
+        uint64_t datasetID = catalog->findDataset(name);
+        ObjectSet *os = datasetID != 0 ? catalog->getObjectSet(datasetID) : nullptr;
+        Dnode *masterNode = os != nullptr ? os->getDnode(1) : nullptr;
+        //volumes and datasets without a file system have no master node
+        if (masterNode == nullptr || masterNode->getType() != DMU_OT_MASTER_NODE)
+            continue;
+
+        uint64_t rootDirectoryID = 0;
+        ZAP masterZAP(TSK_LIT_ENDIAN, masterNode);
+        if (masterZAP.lookup("ROOT", rootDirectoryID))
+            hashDirectory(os, rootDirectoryID, name, hasher);
+    }
+    hasher.printStatistics(cout);
+}
+
+void ZFS_POOL::hashDirectory(ObjectSet *os, uint64_t directoryID, string path, POOL_HASH &hasher) {
+    Dnode *directory = os->getDnode(directoryID);
+    if (directory == nullptr || directory->getType() != DMU_OT_DIRECTORY_CONTENTS)
+        return;
+
+    //the type of an entry is kept in its upper 4 bits, the object number in the lower 48
+    std::map<string, uint64_t> entries;
+    ZAP zap(TSK_LIT_ENDIAN, directory);
+    zap.forEach([&entries](const string &name, uint64_t value) { entries[name] = value; });
+
+    for (auto &it : entries) {
+        uint64_t objectID = it.second & 0xFFFFFFFFFFFFULL;
+        uint8_t type = it.second >> 60;
+        if (type == 4) {
+            hashDirectory(os, objectID, path + "/" + it.first, hasher);
+        } else if (type == 8) {
+            Dnode *file = os->getDnode(objectID);
+            POOL_HASH::Digest digest;
+            if (file != nullptr && hashObject(file, hasher, digest))
+                cout << POOL_HASH::toHex(digest) << "  " << path << "/" << it.first << endl;
+            else
+                cerr << "Cannot read " << path << "/" << it.first << endl;
         }
+    }
+}
 
-        if (datasets.find(str_dataset) == datasets.end()) {
-            cerr << "No dataset named " << str_dataset << " found!" << endl;
-            return;
-        } else {
-            if (!snapshot) {
-                Dnode *datasetDnode = MOS->getDnode(getHeaddatasetID(MOS, datasets.find(str_dataset)->second));
-                ObjectSet *dataset = this->getObjectSetFromDnode(datasetDnode);
-                dnode = dataset->getDnode(object_number);
-            }
-            if (snapshot) {
-                std::map<string, uint64_t> snapshots;
-                getSnapshots(MOS, datasets.find(str_dataset)->second, &snapshots);
-                if (snapshots.find(str_snapshot) == snapshots.end()) {
-                    cerr << "Dataset " << str_dataset << " does not have a snapshot named " << str_snapshot << "!"
-                         << endl;
+/*
+ * Hash the content of an object. The indirect blocks are walked depth
+ * first and the level 0 blocks that were not hashed before are read and
+ * hashed in parallel on the shared worker pool, in batches of twice the
+ * number of workers.
+ * Returns false if a block cannot be read.
+ */
+bool ZFS_POOL::hashObject(Dnode *dnode, POOL_HASH &hasher, POOL_HASH::Digest &digest) {
+    uint64_t size = dnode->getSize();
+    uint64_t blockSize = dnode->getDataBlockSize();
+    int levels = dnode->getLevels();
+    int shift = dnode->getIndirectBlockShift() - 7;
+    if (blockSize == 0 || levels < 1 || (levels > 1 && (shift <= 0 || shift * (levels - 1) >= 64)))
+        return false;
+
+    //the top-level block pointers checksum the whole tree below them
+    vector<uint8_t> layout((uint8_t *) &size, (uint8_t *) &size + sizeof(size));
+    for (int i = 0; i < 3; i++) {
+        const Blkptr *blkptr = dnode->getBlkptr(i);
+        if (blkptr != nullptr)
+            layout.insert(layout.end(), blkptr->getRaw(), blkptr->getRaw() + 128);
+    }
+    POOL_HASH::Digest layoutDigest = POOL_HASH::hashLayout(layout);
+    if (hasher.lookupFile(layoutDigest, digest))
+        return true;
+
+    //holes hash as zeros, the last block is cut at the end of the file
+    uint64_t noBlocks = (size + blockSize - 1) / blockSize;
+    vector<POOL_HASH::Digest> pieces(noBlocks, hasher.hashZeros(blockSize));
+    if (noBlocks > 0)
+        pieces.back() = hasher.hashZeros(size - (noBlocks - 1) * blockSize);
+
+    //leaves are read in batches, so only a few blocks are held at a time
+    ThreadPool &workers = ThreadPool::shared();
+    uint64_t batchSize = 2 * workers.size();
+    vector<std::pair<uint64_t, Blkptr>> batch;
+    auto flush = [&]() -> bool {
+        vector<char> batchFailed(batch.size(), 0);
+        vector<std::future<void>> pending;
+        for (size_t i = 0; i < batch.size(); i++) {
+            auto load = [&, i]() {
+                uint64_t blockID = batch[i].first;
+                const Blkptr &leaf = batch[i].second;
+                uint64_t length = std::min(blockSize, size - blockID * blockSize);
+                vector<char> data;
+                if (leaf.isEmbedded()) {
+                    try {
+                        leaf.getData(data);
+                    }
+                    catch (...) {
+                        //a damaged embedded block pointer fails only this object
+                        batchFailed[i] = 1;
+                        return;
+                    }
+                } else if (!this->readData(&leaf, data)) {
+                    batchFailed[i] = 1;
                     return;
-                } else {
-                    Dnode *datasetDnode = MOS->getDnode(snapshots.find(str_snapshot)->second);
-                    ObjectSet *dataset = this->getObjectSetFromDnode(datasetDnode);
-                    dnode = dataset->getDnode(object_number);
                 }
-            }
+                if (data.size() < length)
+                    data.resize(length, 0);
+                pieces[blockID] = hasher.hashPiece(data.data(), length);
+                if (!leaf.isEmbedded()) {
+                    dva copy = leaf.getDVA(0);
+                    hasher.insertPiece({{copy.vdev, copy.offset, leaf.getBirthTXG(), length}}, pieces[blockID]);
+                }
+            };
+            if (batch.size() == 1)
+                load();
+            else
+                pending.push_back(workers.submit(load));
         }
-    }
+        ThreadPool::waitAll(pending);
+        batch.clear();
+        for (char it : batchFailed) {
+            if (it)
+                return false;
+        }
+        return true;
+    };
 
-    if (dnode == nullptr) {
-        cerr << "object with number " << object_number << " does not exist!" << endl;
-        return;
-    } else {
-        std::vector<char> data;
-        dnode->getData(data);
+    //descend depth first, an indirect block at a time
+    std::function<bool(const Blkptr &, uint64_t, int)> collect =
+            [&](const Blkptr &blkptr, uint64_t firstBlockID, int level) -> bool {
+        if (firstBlockID >= noBlocks)
+            return true;
+        if (level == 0) {
+            uint64_t length = std::min(blockSize, size - firstBlockID * blockSize);
+            dva copy = blkptr.getDVA(0);
+            POOL_HASH::Location location = {{copy.vdev, copy.offset, blkptr.getBirthTXG(), length}};
+            if (!blkptr.isEmbedded() && hasher.lookupPiece(location, pieces[firstBlockID]))
+                return true;
+            batch.emplace_back(firstBlockID, blkptr);
+            return batch.size() < batchSize || flush();
+        }
 
-        auto it = dnode->dn_bonus.find("zp_size");
-        if(it != dnode->dn_bonus.end() and dnode->getType() != DMU_OT_DIRECTORY_CONTENTS)
-            std::copy(data.begin(), (data.begin() + dnode->dn_bonus["zp_size"]), ostream_iterator<char>(std::cout));
-        else
-            std::copy(data.begin(), data.end(), ostream_iterator<char>(std::cout));
+        vector<char> indirect;
+        if (!this->readData(&blkptr, indirect))
+            return false;
+        uint64_t span = 1ULL << (shift * (level - 1));
+        for (uint64_t i = 0; (i + 1) * 128 <= indirect.size(); i++) {
+            try {
+                Blkptr child(TSK_LIT_ENDIAN, (uint8_t *) indirect.data() + i * 128, this);
+                if (!collect(child, firstBlockID + i * span, level - 1))
+                    return false;
+            }
+            catch (...) {
+                //hole
+            }
+        }
+        return true;
+    };
+    uint64_t topSpan = levels > 1 ? 1ULL << (shift * (levels - 1)) : 1;
+    for (int i = 0; i < 3; i++) {
+        const Blkptr *blkptr = dnode->getBlkptr(i);
+        if (blkptr != nullptr && !collect(*blkptr, i * topSpan, levels - 1))
+            return false;
     }
+    if (!flush())
+        return false;
+    digest = POOL_HASH::compose(pieces);
+    hasher.insertFile(layoutDigest, digest);
+    return true;
 }
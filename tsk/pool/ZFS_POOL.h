@@ -16,9 +16,14 @@
 
 #include <tsk/libtsk.h>
 #include <map>
+#include <set>
+#include <array>
 #include <iterator>
+#include <mutex>
 #include "../fs/zfs/NVList.h"
 #include "ZFS_VDEV.h"
+#include "ZFS_ARC.h"
+#include "POOL_HASH.h"
 #include "TSK_POOL_INFO.h"
 #include "TSK_POOL.h"
 #include "../fs/zfs/UberblockArray.h"
@@ -27,10 +32,13 @@
 class Blkptr;
 class Uberblock;
 
+class Catalog;
+
 class ZFS_POOL : public TSK_POOL {
 
 private:
     vector<ZFS_VDEV*> vdevs;
+    vector<ZFS_VDEV*> vdevsByID;    // top-level vdevs indexed by their ID, nullptr if missing
     vector<uint64_t> availableIDs;
     uint64_t no_all_vdevs;
     uint64_t pool_guid;
@@ -38,6 +46,17 @@ class ZFS_POOL : public TSK_POOL {
     bool reconstructable;
     TSK_POOL_INFO *pool;
     UberblockArray* uberblock_array;
+    //block copies that failed their checksum, keyed by vdev, offset and expected checksum
+    std::set<std::array<uint64_t, 6>> damagedCopies;
+    std::mutex damagedCopiesLock;
+    //decompressed blocks that have been verified
+    ZFS_ARC arc;
+    //datasets as of each TXG that was queried
+    std::map<uint64_t, Catalog*> catalogs;
+
+    Dnode* findObject(Catalog* catalog, int object_number, string dataset);
+    void hashDirectory(ObjectSet* os, uint64_t directoryID, string path, POOL_HASH& hasher);
+    bool hashObject(Dnode* dnode, POOL_HASH& hasher, POOL_HASH::Digest& digest);
 
 public:
     ZFS_POOL(TSK_POOL_INFO *pool);
@@ -46,21 +65,30 @@ class ZFS_POOL : public TSK_POOL {
     ZFS_VDEV* getVdevByID(uint64_t i);
 
     void checkReconstructable();
-    void readData(Blkptr*, vector<char>& buffer, bool decompress=true);
-    void readData(int, uint64_t, uint64_t, vector<char>& buffer);
+    bool readData(const Blkptr*, vector<char>& buffer, bool decompress=true);
+    bool isCached(const Blkptr*) const;
+    bool decompressBlock(const Blkptr* blkptr, vector<char>& buffer);
+    bool readData(int, uint64_t, uint64_t, vector<char>& buffer, const Blkptr* blkptr = nullptr);
     void readRawData(int dev, uint64_t offset, uint64_t size, vector<char>& buffer);
     Uberblock* getMostrecentUberblock() const { return uberblock_array->getMostrecent(); }
     UberblockArray* getUberblockArray() const { return uberblock_array;};
+    ZFS_ARC& getARC() { return arc; }
     friend std::ostream& operator<<(std::ostream& os, const ZFS_POOL& pool);
     virtual void print(std::ostream& os) const;
     void fsstat(string dataset = "", int uberblock = -1);
     void fls(string dataset = "", int uberblock = -1);
     void istat(int object_number, string dataset = "", int uberblock = -1);
     void icat(int object_number, string dataset = "", int uberblock = -1);
+    void scrub(int uberblock = -1);
+    void hash(string dataset = "", int uberblock = -1);
+    TSK_POOL_VOLUME* openVolume(string volume = "", int uberblock = -1);
 
     ObjectSet* getMOS(Uberblock* uberblock);
     std::map<string, uint64_t> getDatasets(ObjectSet* MOS);
     string getPoolName();
+    Catalog* getCatalog(int uberblock = -1);
+    void invalidateCatalog(uint64_t txg);
+    void invalidateCatalogs();
     ObjectSet* getObjectSetFromDnode(Dnode* dnode);
     void listFiles(ObjectSet* os, uint64_t dnodeID,  std::map<string, uint64_t> datasets, bool isDirectory, string path, int tabLevel=0);
 
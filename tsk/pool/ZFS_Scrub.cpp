@@ -0,0 +1,236 @@
+/*
+ * ZFS_Scrub.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file ZFS_Scrub.cpp
+ * Verifies the checksums of all blocks reachable from an uberblock
+ */
+
+#include "ZFS_Scrub.h"
+#include "ZFS_POOL.h"
+#include "../fs/zfs/Blkptr.h"
+#include "../fs/zfs/Dnode.h"
+#include "../fs/zfs/Uberblock.h"
+#include "../fs/zfs/ZFS_Structures.h"
+#include "../utils/ThreadPool.h"
+
+#include <chrono>
+#include <iomanip>
+
+using namespace std;
+
+//size of a dnode slot and of a block pointer in bytes
+static const uint64_t DNODE_SIZE = 512;
+static const uint64_t BLKPTR_SIZE = 128;
+//offsets of the dnodes in an object set, the later ones only exist in larger object sets
+static const uint64_t OBJSET_DNODES[] = {0, 1024, 1536, 2048};
+//labels and boot block in front of the allocatable space of a device
+static const uint64_t VDEV_LABEL_START_SIZE = 0x400000;
+
+ZFS_Scrub::ZFS_Scrub(ZFS_POOL *pool)
+        : pool(pool), pending(0), blocks(0), copies(0), bytes(0), missingCopies(0), unrecoverable(0), seconds(0) {
+}
+
+/*
+ * Scrub all blocks reachable from the root block pointer of the uberblock
+ * and wait until the last one is done.
+ */
+void ZFS_Scrub::run(Uberblock *uberblock) {
+    auto start = chrono::steady_clock::now();
+
+    submit(*uberblock->getRootbp());
+    {
+        unique_lock<mutex> guard(lock);
+        idle.wait(guard, [this] { return pending == 0; });
+    }
+
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    seconds = elapsed.count();
+}
+
+void ZFS_Scrub::submit(const Blkptr &blkptr) {
+    {
+        lock_guard<mutex> guard(lock);
+        if (blkptr.isMetadata()) {
+            dva copy = blkptr.getDVA(0);
+            std::array<uint64_t, 3> key = {{copy.vdev, copy.offset, blkptr.getBirthTXG()}};
+            if (!visited.insert(key).second)
+                return;
+        }
+        pending++;
+    }
+
+    ThreadPool::shared().submit([this, blkptr]() {
+        try {
+            scrubBlock(blkptr);
+        }
+        catch (...) {
+            //a damaged block must not stop the scrub
+        }
+        finish();
+    });
+}
+
+void ZFS_Scrub::finish() {
+    lock_guard<mutex> guard(lock);
+    if (--pending == 0)
+        idle.notify_all();
+}
+
+/*
+ * Read and verify every copy of a block, on every side of a mirror. If one
+ * of them is good and the block holds block pointers or dnodes, go on with
+ * the blocks it points to.
+ */
+void ZFS_Scrub::scrubBlock(const Blkptr &blkptr) {
+    blocks++;
+
+    vector<char> data;
+    vector<char> good;
+    bool found = false;
+    uint64_t psize = blkptr.getPsize();
+    vector<BadCopy> bad;
+
+    if (blkptr.isEmbedded()) {
+        //the data is part of the block pointer itself
+        blkptr.getData(good);
+        found = true;
+    }
+
+    for (int i = 0; i < 3 && !blkptr.isEmbedded(); i++) {
+        dva copy = blkptr.getDVA(i);
+        if (copy.asize == 0)
+            continue;
+        ZFS_VDEV *vdev = pool->getVdevByID(copy.vdev);
+        if (vdev == nullptr) {
+            missingCopies++;
+            continue;
+        }
+
+        //every side of a mirror holds the copy, each of them is verified
+        vector<int64_t> sides;
+        if (vdev->getType() == "mirror") {
+            for (uint64_t c = 0; c < vdev->getNoChildren(); c++) {
+                if (vdev->getChild(c).available)
+                    sides.push_back(vdev->getChild(c).id);
+                else
+                    missingCopies++;
+            }
+        } else {
+            sides.push_back(-1);
+        }
+
+        for (int64_t side : sides) {
+            if (side < 0) {
+                pool->readData(copy.vdev, copy.offset, psize, data);
+            } else {
+                data.resize(psize);
+                tsk_img_read(vdev->getChild(side).img, copy.offset + VDEV_LABEL_START_SIZE, data.data(), psize);
+            }
+            copies++;
+            bytes += psize;
+            if (blkptr.checksumMatches(data)) {
+                if (!found)
+                    good.swap(data);
+                found = true;
+            } else {
+                bad.push_back({copy.vdev, copy.offset, blkptr.getBirthTXG(), side, false});
+            }
+        }
+    }
+
+    if (!found) {
+        if (bad.empty())
+            return;
+        unrecoverable++;
+        for (auto &it : bad)
+            it.unrecoverable = true;
+    }
+    if (!bad.empty()) {
+        lock_guard<mutex> guard(lock);
+        badCopies.insert(badCopies.end(), bad.begin(), bad.end());
+    }
+    if (!found)
+        return;
+
+    uint8_t type = blkptr.getType();
+    if (blkptr.getLevel() == 0 && type != DMU_OT_DNODE && type != DMU_OT_OBJSET)
+        return;
+
+    if (!blkptr.isEmbedded() && !pool->decompressBlock(&blkptr, good))
+        return;
+
+    if (blkptr.getLevel() > 0) {
+        for (uint64_t offset = 0; offset + BLKPTR_SIZE <= good.size(); offset += BLKPTR_SIZE) {
+            try {
+                submit(Blkptr(TSK_LIT_ENDIAN, (uint8_t *) good.data() + offset, pool));
+            }
+            catch (...) {
+                //hole
+            }
+        }
+    } else if (type == DMU_OT_DNODE) {
+        for (uint64_t offset = 0; offset + DNODE_SIZE <= good.size(); offset += DNODE_SIZE)
+            scrubDnode((uint8_t *) good.data() + offset);
+    } else {
+        //object set: its meta-dnode, then the dnodes of user, group and project space accounting
+        for (uint64_t offset : OBJSET_DNODES) {
+            if (offset + DNODE_SIZE <= good.size())
+                scrubDnode((uint8_t *) good.data() + offset);
+        }
+    }
+}
+
+/*
+ * Submit the block pointers of a dnode, and for DSL datasets the block
+ * pointer of their object set.
+ */
+void ZFS_Scrub::scrubDnode(const uint8_t *data) {
+    if (data[0] == DMU_OT_NONE)
+        return;
+
+    try {
+        Dnode dnode(TSK_LIT_ENDIAN, (uint8_t *) data, pool);
+        for (int i = 0; i < 3; i++) {
+            const Blkptr *blkptr = dnode.getBlkptr(i);
+            if (blkptr != nullptr)
+                submit(*blkptr);
+        }
+        if (dnode.getBonusBlkptr() != nullptr)
+            submit(*dnode.getBonusBlkptr());
+    }
+    catch (...) {
+        //free or damaged dnode slot
+    }
+}
+
+void ZFS_Scrub::printReport(std::ostream &os) const {
+    os << "Blocks scrubbed: \t" << blocks << endl;
+    os << "Copies verified: \t" << copies << " (" << bytes / (1024 * 1024) << " MB)" << endl;
+    if (missingCopies > 0)
+        os << "Copies on missing vdevs or mirror children: \t" << missingCopies << endl;
+    ios::fmtflags flags = os.flags();
+    streamsize precision = os.precision();
+    os << "Time: \t" << fixed << setprecision(2) << seconds << " s";
+    if (seconds > 0)
+        os << " (" << setprecision(1) << bytes / (1024.0 * 1024.0) / seconds << " MB/s)";
+    os << endl;
+    os.flags(flags);
+    os.precision(precision);
+
+    os << "Bad copies: \t" << badCopies.size() << endl;
+    os << "Unrecoverable blocks: \t" << unrecoverable << endl;
+    for (auto &it : badCopies) {
+        os << "  DVA " << it.vdev << ":" << hex << it.offset << dec << " (birth TXG " << it.birth << ")";
+        if (it.child >= 0)
+            os << " on mirror child " << it.child;
+        if (it.unrecoverable)
+            os << " - no good copy";
+        os << endl;
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ * ZFS_Scrub.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file ZFS_Scrub.h
+ * Verifies the checksums of all blocks reachable from an uberblock
+ */
+
+#ifndef ZFS_FTK_ZFS_SCRUB_H
+#define ZFS_FTK_ZFS_SCRUB_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <tsk/libtsk.h>
+
+class ZFS_POOL;
+class Uberblock;
+class Blkptr;
+
+/*
+ * Walks the block tree from the MOS down through every dnode, and from
+ * each DSL dataset into its object set, reading and checking every copy
+ * (DVA) of every block on every side of a mirror. Blocks are handled on
+ * the shared worker pool, so the copies of many blocks are read and hashed
+ * at the same time. Object sets are walked from their meta-dnode and their
+ * space accounting dnodes.
+ * Indirect and other metadata blocks are scrubbed once even when several
+ * snapshots point to them; data blocks are only reached through them.
+ */
+class ZFS_Scrub {
+
+public:
+    struct BadCopy {
+        uint64_t vdev;
+        uint64_t offset;
+        uint64_t birth;
+        int64_t child;          // mirror child holding the copy, -1 for other vdevs
+        bool unrecoverable;     // no copy of the block matched its checksum
+    };
+
+    ZFS_Scrub(ZFS_POOL* pool);
+    ~ZFS_Scrub() = default;
+
+    void run(Uberblock* uberblock);
+    void printReport(std::ostream& os) const;
+
+    uint64_t getBlocks() const { return blocks; }
+    uint64_t getBytes() const { return bytes; }
+    uint64_t getUnrecoverable() const { return unrecoverable; }
+    const std::vector<BadCopy>& getBadCopies() const { return badCopies; }
+
+private:
+    ZFS_POOL* pool;
+    std::mutex lock;
+    std::condition_variable idle;
+    uint64_t pending;                               // blocks submitted but not yet scrubbed
+    std::set<std::array<uint64_t, 3>> visited;      // metadata blocks by vdev, offset and birth
+    std::vector<BadCopy> badCopies;
+    std::atomic<uint64_t> blocks;
+    std::atomic<uint64_t> copies;
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> missingCopies;
+    std::atomic<uint64_t> unrecoverable;
+    double seconds;
+
+    void submit(const Blkptr& blkptr);
+    void finish();
+    void scrubBlock(const Blkptr& blkptr);
+    void scrubDnode(const uint8_t* data);
+};
+
+#endif //ZFS_FTK_ZFS_SCRUB_H
@@ -12,6 +12,7 @@
  */
 
 #include "ZFS_VDEV.h"
+#include <algorithm>
 
 //TODO: rename to ZFS_TLVDEV
 ZFS_VDEV::ZFS_VDEV(NVList *list) {
@@ -59,10 +60,20 @@ ZFS_VDEV::ZFS_VDEV(NVList *list) {
             temp.available = FALSE;
             temp.path = children.at(i)->getStringValue("path");
             temp.guid = children.at(i)->getIntValue("guid");
-            //TODO: order by ID
             this->children.push_back(temp);
         }
     }
+
+    //order by ID, so a child is usually found at the position of its ID
+    std::sort(this->children.begin(), this->children.end(),
+              [](const ZFS_DEVICE &a, const ZFS_DEVICE &b) { return a.id < b.id; });
+
+    //raidz columns are read through one reader per child, indexed by child ID
+    if (type == "raidz" && !this->children.empty()) {
+        this->readers.resize(this->children.back().id + 1);
+        for (auto &child : this->children)
+            this->readers[child.id].reset(new ThreadPool(1));
+    }
 }
 
 bool ZFS_VDEV::addDevice(uint64_t guid, std::pair<string, TSK_IMG_INFO *> img) {
@@ -97,17 +108,22 @@ void ZFS_VDEV::checkUsable() {
     }
 }
 
-//TODO: get child by ID
-ZFS_DEVICE ZFS_VDEV::getChild(uint64_t childID) {
+const ZFS_DEVICE &ZFS_VDEV::getChild(uint64_t childID) const {
+    static const ZFS_DEVICE missing = ZFS_DEVICE();
+
+    if (childID < children.size() && children[childID].id == childID)
+        return children[childID];
+
     if (childID > children.size()) {
         cout << "Child " << childID << " is not existent in this vdev!" << endl;
     } else {
-        for (auto it : children) {
+        for (auto &it : children) {
             if(it.id == childID){
                 return it;
             }
         }
     }
+    return missing;
 }
 
 ostream &operator<<(ostream &os, const ZFS_VDEV &vdev) {
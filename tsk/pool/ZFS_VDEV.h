@@ -18,7 +18,9 @@
 #include <tsk/libtsk.h>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include "../fs/zfs/NVList.h"
+#include "../utils/ThreadPool.h"
 
 using namespace std;
 
@@ -51,6 +53,7 @@ class ZFS_VDEV {
     uint64_t nparity;
     bool usable;
     int create_txg;
+    vector<unique_ptr<ThreadPool>> readers; // raidz: one single worker queue per child, by child ID
 
 public:
      ZFS_VDEV(NVList* list);
@@ -64,7 +67,8 @@ class ZFS_VDEV {
     bool isUsable() { return this->usable; };
     friend std::ostream& operator<<(std::ostream& os, const ZFS_VDEV& vdev);
     bool addDevice(uint64_t, std::pair<string, TSK_IMG_INFO*>);
-    ZFS_DEVICE getChild(uint64_t child);
+    const ZFS_DEVICE& getChild(uint64_t child) const;
+    ThreadPool& getReader(uint64_t child) { return *readers.at(child); };
     void checkUsable();
 };
 
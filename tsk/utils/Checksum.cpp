@@ -0,0 +1,342 @@
+/*
+ * Checksum.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Checksum.cpp
+ * Block checksums used by ZFS: fletcher-2, fletcher-4 and SHA-256
+ */
+
+#include "Checksum.h"
+#include "Tools.h"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define TSK_CHECKSUM_X86
+#endif
+
+using namespace std;
+
+void fletcher_2(const uint8_t *buf, uint64_t size, uint64_t *output) {
+    uint64_t a0 = 0, a1 = 0, b0 = 0, b1 = 0;
+    for (uint64_t i = 0; i + 16 <= size; i += 16) {
+        uint64_t w0, w1;
+        memcpy(&w0, buf + i, 8);
+        memcpy(&w1, buf + i + 8, 8);
+        a0 += w0;
+        a1 += w1;
+        b0 += a0;
+        b1 += a1;
+    }
+
+    output[0] = a0;
+    output[1] = a1;
+    output[2] = b0;
+    output[3] = b1;
+}
+
+namespace {
+    //number of 32 bit words the vector kernels interleave
+    const int FLETCHER_4_LANES = 4;
+
+    //n * (n + 1) / 2 and n * (n + 1) * (n + 2) / 6, also for negative n
+    int64_t sumOfOnes(int64_t n) {
+        return n * (n + 1) / 2;
+    }
+
+    int64_t sumOfSums(int64_t n) {
+        return n * (n + 1) * (n + 2) / 6;
+    }
+
+    /*
+     * Merge the sums of the interleaved lanes into the sums of a single
+     * pass. Lane j saw the words j, j + L, j + 2L, ..., so a word that is
+     * t steps from the end of its lane is n = L * t - j words from the end
+     * of the buffer. Its weight in each sum is a polynomial in t, written
+     * as a combination of the lane sums a, b, c and d.
+     */
+    void fletcher_4_combine(const uint64_t a[], const uint64_t b[], const uint64_t c[], const uint64_t d[],
+                            uint64_t *output) {
+        const int64_t L = FLETCHER_4_LANES;
+        uint64_t A = 0, B = 0, C = 0, D = 0;
+        for (int64_t j = 0; j < L; j++) {
+            int64_t c0 = sumOfOnes(-j);
+            int64_t c1 = c0 - sumOfOnes(-L - j);
+            int64_t d0 = sumOfSums(-j);
+            int64_t d1 = d0 - sumOfSums(-L - j);
+            int64_t d2 = sumOfSums(-2 * L - j) + 2 * d1 - d0;
+
+            A += a[j];
+            B += L * b[j] - j * a[j];
+            C += L * L * c[j] + c1 * b[j] + c0 * a[j];
+            D += L * L * L * d[j] + d2 * c[j] + d1 * b[j] + d0 * a[j];
+        }
+
+        output[0] = A;
+        output[1] = B;
+        output[2] = C;
+        output[3] = D;
+    }
+
+    //continue the sums over the words a vector kernel left over
+    void fletcher_4_tail(const uint8_t *buf, uint64_t size, uint64_t *output) {
+        uint64_t a = output[0], b = output[1], c = output[2], d = output[3];
+        for (uint64_t i = 0; i + 4 <= size; i += 4) {
+            uint32_t word;
+            memcpy(&word, buf + i, 4);
+            a += word;
+            b += a;
+            c += b;
+            d += c;
+        }
+
+        output[0] = a;
+        output[1] = b;
+        output[2] = c;
+        output[3] = d;
+    }
+}
+
+#ifdef TSK_CHECKSUM_X86
+//SSE2 is part of x86-64: the four lanes are held as two pairs of 64 bit sums
+static void fletcher_4_sse2(const uint8_t *buf, uint64_t size, uint64_t *output) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i aLow = zero, aHigh = zero, bLow = zero, bHigh = zero;
+    __m128i cLow = zero, cHigh = zero, dLow = zero, dHigh = zero;
+
+    uint64_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i words = _mm_loadu_si128((const __m128i *) (buf + i));
+        aLow = _mm_add_epi64(aLow, _mm_unpacklo_epi32(words, zero));
+        aHigh = _mm_add_epi64(aHigh, _mm_unpackhi_epi32(words, zero));
+        bLow = _mm_add_epi64(bLow, aLow);
+        bHigh = _mm_add_epi64(bHigh, aHigh);
+        cLow = _mm_add_epi64(cLow, bLow);
+        cHigh = _mm_add_epi64(cHigh, bHigh);
+        dLow = _mm_add_epi64(dLow, cLow);
+        dHigh = _mm_add_epi64(dHigh, cHigh);
+    }
+
+    uint64_t a[4], b[4], c[4], d[4];
+    _mm_storeu_si128((__m128i *) a, aLow);
+    _mm_storeu_si128((__m128i *) (a + 2), aHigh);
+    _mm_storeu_si128((__m128i *) b, bLow);
+    _mm_storeu_si128((__m128i *) (b + 2), bHigh);
+    _mm_storeu_si128((__m128i *) c, cLow);
+    _mm_storeu_si128((__m128i *) (c + 2), cHigh);
+    _mm_storeu_si128((__m128i *) d, dLow);
+    _mm_storeu_si128((__m128i *) (d + 2), dHigh);
+    fletcher_4_combine(a, b, c, d, output);
+    fletcher_4_tail(buf + i, size - i, output);
+}
+
+__attribute__((target("avx2")))
+static void fletcher_4_avx2(const uint8_t *buf, uint64_t size, uint64_t *output) {
+    __m256i a = _mm256_setzero_si256(), b = a, c = a, d = a;
+
+    uint64_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m256i words = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) (buf + i)));
+        a = _mm256_add_epi64(a, words);
+        b = _mm256_add_epi64(b, a);
+        c = _mm256_add_epi64(c, b);
+        d = _mm256_add_epi64(d, c);
+    }
+
+    uint64_t laneA[4], laneB[4], laneC[4], laneD[4];
+    _mm256_storeu_si256((__m256i *) laneA, a);
+    _mm256_storeu_si256((__m256i *) laneB, b);
+    _mm256_storeu_si256((__m256i *) laneC, c);
+    _mm256_storeu_si256((__m256i *) laneD, d);
+    fletcher_4_combine(laneA, laneB, laneC, laneD, output);
+    fletcher_4_tail(buf + i, size - i, output);
+}
+#endif
+
+//! Name of the kernel fletcher_4() dispatches to.
+const char *fletcher_4_implementation() {
+#ifdef TSK_CHECKSUM_X86
+    return __builtin_cpu_supports("avx2") ? "avx2" : "sse2";
+#else
+    return "software";
+#endif
+}
+
+void fletcher_4(const uint8_t *buf, uint64_t size, uint64_t *output) {
+    typedef void (*FletcherFunc)(const uint8_t *, uint64_t, uint64_t *);
+#ifdef TSK_CHECKSUM_X86
+    static const FletcherFunc impl = __builtin_cpu_supports("avx2") ? fletcher_4_avx2 : fletcher_4_sse2;
+#else
+    static const FletcherFunc impl = fletcher_4_native;
+#endif
+
+    impl(buf, size, output);
+}
+
+namespace {
+    const uint32_t SHA256_K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    const uint32_t SHA256_INIT[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    typedef void (*Sha256Blocks)(uint32_t state[8], const uint8_t *data, uint64_t blocks);
+
+    uint32_t rotr(uint32_t x, int n) {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    void sha256_blocks_software(uint32_t state[8], const uint8_t *data, uint64_t blocks) {
+        for (; blocks > 0; blocks--, data += 64) {
+            uint32_t w[64];
+            for (int t = 0; t < 16; t++)
+                w[t] = ((uint32_t) data[4 * t] << 24) | ((uint32_t) data[4 * t + 1] << 16)
+                       | ((uint32_t) data[4 * t + 2] << 8) | data[4 * t + 3];
+            for (int t = 16; t < 64; t++) {
+                uint32_t s0 = rotr(w[t - 15], 7) ^ rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+                uint32_t s1 = rotr(w[t - 2], 17) ^ rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+                w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int t = 0; t < 64; t++) {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[t] + w[t];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+
+    //hash whole blocks, then the padded remainder, and write the state big endian
+    void sha256_with(Sha256Blocks blocks, const uint8_t *buf, uint64_t size, uint8_t digest[32]) {
+        uint32_t state[8];
+        memcpy(state, SHA256_INIT, sizeof(state));
+        blocks(state, buf, size / 64);
+
+        uint8_t last[128];
+        uint64_t rest = size % 64;
+        memset(last, 0, sizeof(last));
+        memcpy(last, buf + size - rest, rest);
+        last[rest] = 0x80;
+        uint64_t lastLength = (rest < 56) ? 64 : 128;
+        uint64_t bits = size * 8;
+        for (int i = 0; i < 8; i++)
+            last[lastLength - 1 - i] = (uint8_t) (bits >> (8 * i));
+        blocks(state, last, lastLength / 64);
+
+        for (int i = 0; i < 8; i++) {
+            digest[4 * i] = (uint8_t) (state[i] >> 24);
+            digest[4 * i + 1] = (uint8_t) (state[i] >> 16);
+            digest[4 * i + 2] = (uint8_t) (state[i] >> 8);
+            digest[4 * i + 3] = (uint8_t) state[i];
+        }
+    }
+}
+
+void sha256_software(const uint8_t *buf, uint64_t size, uint8_t digest[32]) {
+    sha256_with(sha256_blocks_software, buf, size, digest);
+}
+
+#ifdef TSK_CHECKSUM_X86
+static bool sha_extensions_available() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (ebx & (1u << 29)) != 0 && __builtin_cpu_supports("sse4.1");
+}
+
+/*
+ * SHA-256 with the SHA extensions. The state is kept as ABEF and CDGH, the
+ * layout sha256rnds2 works on; each step runs four rounds and extends the
+ * message schedule by four words.
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const uint8_t *data, uint64_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state), 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) (state + 4)), 0x1B);
+    __m128i abef = _mm_alignr_epi8(abcd, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, abcd, 0xF0);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i abefSaved = abef;
+        __m128i cdghSaved = cdgh;
+        __m128i w[4];
+
+        for (int step = 0; step < 16; step++) {
+            if (step < 4) {
+                w[step] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16 * step)), byteSwap);
+            } else {
+                __m128i previous = w[(step - 1) & 3];
+                __m128i next = _mm_add_epi32(_mm_sha256msg1_epu32(w[step & 3], w[(step + 1) & 3]),
+                                             _mm_alignr_epi8(previous, w[(step - 2) & 3], 4));
+                w[step & 3] = _mm_sha256msg2_epu32(next, previous);
+            }
+
+            __m128i message = _mm_add_epi32(w[step & 3], _mm_loadu_si128((const __m128i *) (SHA256_K + 4 * step)));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(message, 0x0E));
+        }
+
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i *) state, _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i *) (state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+#endif
+
+//! Name of the implementation sha256() dispatches to.
+const char *sha256_implementation() {
+#ifdef TSK_CHECKSUM_X86
+    if (sha_extensions_available())
+        return "sha-ni";
+#endif
+    return "software";
+}
+
+void sha256(const uint8_t *buf, uint64_t size, uint8_t digest[32]) {
+#ifdef TSK_CHECKSUM_X86
+    static const Sha256Blocks impl = sha_extensions_available() ? sha256_blocks_shani : sha256_blocks_software;
+#else
+    static const Sha256Blocks impl = sha256_blocks_software;
+#endif
+
+    sha256_with(impl, buf, size, digest);
+}
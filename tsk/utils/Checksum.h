@@ -0,0 +1,35 @@
+/*
+ * Checksum.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Checksum.h
+ * Block checksums used by ZFS: fletcher-2, fletcher-4 and SHA-256
+ */
+
+#ifndef TSK_CHECKSUM_H
+#define TSK_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * The fletcher checksums read the buffer as native 32 bit (fletcher-4)
+ * or 64 bit (fletcher-2) words and write four 64 bit words. Trailing
+ * bytes that do not fill a word are ignored, as in ZFS.
+ *
+ * fletcher_4() and sha256() are dispatched once, on first use, to the
+ * fastest implementation the CPU supports.
+ */
+void fletcher_2(const uint8_t* buf, uint64_t size, uint64_t* output);
+void fletcher_4(const uint8_t* buf, uint64_t size, uint64_t* output);
+void sha256(const uint8_t* buf, uint64_t size, uint8_t digest[32]);
+void sha256_software(const uint8_t* buf, uint64_t size, uint8_t digest[32]);
+const char* fletcher_4_implementation();
+const char* sha256_implementation();
+
+#endif
@@ -0,0 +1,309 @@
+/*
+ * Decompress.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Decompress.cpp
+ * Block decompressors shared by the pool and file system code
+ */
+
+#include "tsk/tsk_config.h"
+#include "Decompress.h"
+#include <cstring>
+
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+bool zlibDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen)
+{
+    *outLen = 0;
+#ifdef HAVE_LIBZ
+    if (srcLen > UINT32_MAX || dstLen > UINT32_MAX)
+        return false;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    strm.next_in = (Bytef*) src;
+    strm.avail_in = (uInt) srcLen;
+    strm.next_out = (Bytef*) dst;
+    strm.avail_out = (uInt) dstLen;
+
+    if (inflateInit(&strm) != Z_OK)
+        return false;
+
+    // Data after the end of the stream is sector padding and is ignored.
+    int ret = inflate(&strm, Z_FINISH);
+    *outLen = dstLen - strm.avail_out;
+    inflateEnd(&strm);
+
+    return ret == Z_STREAM_END;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Read the extension bytes of an LZO run length. Each zero byte adds 255,
+ * the first non-zero byte and the base are added to the length.
+ */
+static bool lzoRunLength(const uint8_t*& ip, const uint8_t* ipEnd, size_t base, size_t& length)
+{
+    size_t zeros = 0;
+    while (true) {
+        if (ip >= ipEnd)
+            return false;
+        if (*ip != 0)
+            break;
+        ++zeros;
+        ++ip;
+    }
+    length += zeros * 255 + base + *ip++;
+    return true;
+}
+
+/*
+ * LZO1X decompressor with bounds checks on every input read, output write
+ * and back reference. Follows the reference lzo1x_decompress_safe().
+ */
+bool lzo1xDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen)
+{
+    const uint8_t* ip = src;
+    const uint8_t* const ipEnd = src + srcLen;
+    uint8_t* op = dst;
+    uint8_t* const opEnd = dst + dstLen;
+    size_t t;
+    size_t next;
+    size_t dist;
+    size_t state = 0;
+
+    *outLen = 0;
+    if (srcLen == 0)
+        return false;
+
+    // A first byte above 17 encodes a leading literal run.
+    if (*ip > 17) {
+        t = *ip++ - 17;
+        if ((size_t) (ipEnd - ip) < t || (size_t) (opEnd - op) < t)
+            return false;
+        memcpy(op, ip, t);
+        op += t;
+        ip += t;
+        state = t < 4 ? t : 4;
+    }
+
+    while (true) {
+        if (ip >= ipEnd)
+            return false;
+        t = *ip++;
+
+        if (t < 16 && state == 0) {
+            // Literal run.
+            if (t == 0 && !lzoRunLength(ip, ipEnd, 15, t))
+                return false;
+            t += 3;
+            if ((size_t) (ipEnd - ip) < t || (size_t) (opEnd - op) < t)
+                return false;
+            memcpy(op, ip, t);
+            op += t;
+            ip += t;
+            state = 4;
+            continue;
+        }
+
+        if (t < 16) {
+            // Short match, its form depends on the previous instruction.
+            if (ip >= ipEnd)
+                return false;
+            next = t & 3;
+            if (state != 4) {
+                dist = 1 + (t >> 2) + ((size_t) *ip++ << 2);
+                t = 2;
+            }
+            else {
+                dist = 1 + 0x800 + (t >> 2) + ((size_t) *ip++ << 2);
+                t = 3;
+            }
+        }
+        else if (t >= 64) {
+            if (ip >= ipEnd)
+                return false;
+            next = t & 3;
+            dist = 1 + ((t >> 2) & 7) + ((size_t) *ip++ << 3);
+            t = (t >> 5) + 1;
+        }
+        else if (t >= 32) {
+            t = (t & 31) + 2;
+            if (t == 2 && !lzoRunLength(ip, ipEnd, 31, t))
+                return false;
+            if (ipEnd - ip < 2)
+                return false;
+            next = ip[0] | ((size_t) ip[1] << 8);
+            ip += 2;
+            dist = 1 + (next >> 2);
+            next &= 3;
+        }
+        else {
+            dist = (size_t) (t & 8) << 11;
+            t = (t & 7) + 2;
+            if (t == 2 && !lzoRunLength(ip, ipEnd, 7, t))
+                return false;
+            if (ipEnd - ip < 2)
+                return false;
+            next = ip[0] | ((size_t) ip[1] << 8);
+            ip += 2;
+            dist += next >> 2;
+            next &= 3;
+            if (dist == 0) {
+                // End of stream marker.
+                *outLen = op - dst;
+                return t == 3;
+            }
+            dist += 0x4000;
+        }
+
+        // Copy the match byte by byte, source and destination may overlap.
+        if (dist > (size_t) (op - dst) || (size_t) (opEnd - op) < t)
+            return false;
+        const uint8_t* match = op - dist;
+        for (size_t i = 0; i < t; ++i)
+            op[i] = match[i];
+        op += t;
+
+        // Up to three literals trail each match.
+        if ((size_t) (ipEnd - ip) < next || (size_t) (opEnd - op) < next)
+            return false;
+        memcpy(op, ip, next);
+        op += next;
+        ip += next;
+        state = next;
+    }
+}
+
+bool zstdDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen)
+{
+    *outLen = 0;
+#ifdef HAVE_LIBZSTD
+    ZSTD_DStream* stream = ZSTD_createDStream();
+    if (stream == NULL)
+        return false;
+    ZSTD_initDStream(stream);
+
+    ZSTD_inBuffer in = { src, srcLen, 0 };
+    ZSTD_outBuffer out = { dst, dstLen, 0 };
+    bool ok = false;
+    while (true) {
+        size_t ret = ZSTD_decompressStream(stream, &out, &in);
+        if (ZSTD_isError(ret))
+            break;
+        if (ret == 0) {
+            // Frame complete, anything after it is sector padding.
+            ok = true;
+            break;
+        }
+        if (in.pos == in.size || out.pos == out.size)
+            break;
+    }
+    ZSTD_freeDStream(stream);
+
+    *outLen = out.pos;
+    return ok;
+#else
+    return false;
+#endif
+}
+
+/*
+ * LZJB as used by ZFS. Each control byte describes the next eight items,
+ * which are either a literal byte or a two byte match of 6 bits length and
+ * 10 bits distance. The output is always filled to dstLen.
+ */
+bool lzjbDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen)
+{
+    const int MATCH_BITS = 6;
+    const int MATCH_MIN = 3;
+    const int OFFSET_MASK = (1 << (16 - MATCH_BITS)) - 1;
+
+    const uint8_t* ip = src;
+    const uint8_t* ipEnd = src + srcLen;
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstLen;
+    int copymask = 1 << 7;
+    uint8_t copymap = 0;
+
+    *outLen = 0;
+    while (op < opEnd) {
+        if ((copymask <<= 1) == (1 << 8)) {
+            if (ip >= ipEnd)
+                return false;
+            copymask = 1;
+            copymap = *ip++;
+        }
+        if (copymap & copymask) {
+            if (ipEnd - ip < 2)
+                return false;
+            size_t length = (ip[0] >> (8 - MATCH_BITS)) + MATCH_MIN;
+            size_t distance = ((ip[0] << 8) | ip[1]) & OFFSET_MASK;
+            ip += 2;
+            if (distance == 0 || distance > (size_t) (op - dst))
+                return false;
+            if (length > (size_t) (opEnd - op))
+                length = opEnd - op;
+            // Byte by byte, a match may overlap its own output.
+            const uint8_t* match = op - distance;
+            while (length-- > 0)
+                *op++ = *match++;
+        } else {
+            if (ip >= ipEnd)
+                return false;
+            *op++ = *ip++;
+        }
+    }
+
+    *outLen = op - dst;
+    return true;
+}
+
+/*
+ * Zero length encoding as used by ZFS. A control byte n up to 63 is
+ * followed by n + 1 literal bytes, a larger one stands for n - 63 zeros.
+ */
+bool zleDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen)
+{
+    const size_t LITERAL_MAX = 64;
+
+    const uint8_t* ip = src;
+    const uint8_t* ipEnd = src + srcLen;
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstLen;
+
+    *outLen = 0;
+    while (ip < ipEnd && op < opEnd) {
+        size_t length = 1 + *ip++;
+        if (length <= LITERAL_MAX) {
+            if (length > (size_t) (ipEnd - ip) || length > (size_t) (opEnd - op))
+                return false;
+            memcpy(op, ip, length);
+            ip += length;
+        } else {
+            length -= LITERAL_MAX;
+            if (length > (size_t) (opEnd - op))
+                return false;
+            memset(op, 0, length);
+        }
+        op += length;
+    }
+
+    *outLen = op - dst;
+    return op == opEnd;
+}
@@ -0,0 +1,33 @@
+/*
+ * Decompress.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file Decompress.h
+ * Block decompressors shared by the pool and file system code
+ */
+
+#ifndef TSK_DECOMPRESS_H
+#define TSK_DECOMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * All decompressors write at most dstLen bytes to dst and store the number
+ * of bytes produced in outLen. They return false on corrupt input or when
+ * the algorithm is not available in this build. Input that would produce
+ * more than dstLen bytes is treated as corrupt.
+ */
+
+bool zlibDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen);
+bool lzo1xDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen);
+bool zstdDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen);
+bool lzjbDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen);
+bool zleDecompress(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen, size_t* outLen);
+
+#endif
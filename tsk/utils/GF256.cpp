@@ -0,0 +1,214 @@
+/*
+ * GF256.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file GF256.cpp
+ * Arithmetic in GF(2^8) and region kernels for parity reconstruction
+ */
+
+#include "GF256.h"
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define TSK_GF256_X86
+#endif
+
+using namespace std;
+
+namespace {
+    //logarithm and exponent tables, exp is doubled so products need no modulo
+    struct GF256Tables {
+        uint8_t exp[512];
+        uint8_t log[256];
+
+        GF256Tables() {
+            unsigned x = 1;
+            for (int i = 0; i < 255; i++) {
+                exp[i] = (uint8_t) x;
+                log[x] = (uint8_t) i;
+                x <<= 1;
+                if (x & 0x100)
+                    x ^= 0x11d;
+            }
+            for (int i = 255; i < 512; i++)
+                exp[i] = exp[i - 255];
+            log[0] = 0;
+        }
+    };
+
+    const GF256Tables &tables() {
+        static const GF256Tables t;
+        return t;
+    }
+
+    //products of c with every low and every high nibble, for table lookup kernels
+    void nibbleTables(uint8_t c, uint8_t low[16], uint8_t high[16]) {
+        for (int i = 0; i < 16; i++) {
+            low[i] = gf256Mul(c, (uint8_t) i);
+            high[i] = gf256Mul(c, (uint8_t) (i << 4));
+        }
+    }
+}
+
+uint8_t gf256Mul(uint8_t a, uint8_t b) {
+    if (a == 0 || b == 0)
+        return 0;
+    const GF256Tables &t = tables();
+    return t.exp[t.log[a] + t.log[b]];
+}
+
+//! Multiplicative inverse, 0 has none and maps to 0.
+uint8_t gf256Inverse(uint8_t a) {
+    if (a == 0)
+        return 0;
+    const GF256Tables &t = tables();
+    return t.exp[255 - t.log[a]];
+}
+
+uint8_t gf256Pow2(uint64_t exponent) {
+    return tables().exp[exponent % 255];
+}
+
+void xorRegion_software(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < len; i++)
+        dst[i] ^= src[i];
+}
+
+void gf256MulAddRegion_software(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c) {
+    if (c == 0)
+        return;
+    if (c == 1) {
+        xorRegion_software(dst, src, len);
+        return;
+    }
+
+    uint8_t low[16], high[16];
+    nibbleTables(c, low, high);
+    for (size_t i = 0; i < len; i++)
+        dst[i] ^= low[src[i] & 0x0f] ^ high[src[i] >> 4];
+}
+
+#ifdef TSK_GF256_X86
+//SSE2 is part of x86-64, so this kernel needs no runtime check
+static void xorRegion_sse2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(a, b));
+    }
+    xorRegion_software(dst + i, src + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void xorRegion_avx2(uint8_t *dst, const uint8_t *src, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *) (dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *) (src + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(a, b));
+    }
+    xorRegion_software(dst + i, src + i, len - i);
+}
+
+//multiplication by a constant as two 16 entry table lookups, one per nibble (pshufb needs SSSE3)
+__attribute__((target("ssse3")))
+static void gf256MulAddRegion_ssse3(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c) {
+    if (c == 0)
+        return;
+
+    uint8_t low[16], high[16];
+    nibbleTables(c, low, high);
+    const __m128i tableLow = _mm_loadu_si128((const __m128i *) low);
+    const __m128i tableHigh = _mm_loadu_si128((const __m128i *) high);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i l = _mm_and_si128(s, mask);
+        __m128i h = _mm_and_si128(_mm_srli_epi64(s, 4), mask);
+        __m128i product = _mm_xor_si128(_mm_shuffle_epi8(tableLow, l), _mm_shuffle_epi8(tableHigh, h));
+        __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(d, product));
+    }
+    gf256MulAddRegion_software(dst + i, src + i, len - i, c);
+}
+
+__attribute__((target("avx2")))
+static void gf256MulAddRegion_avx2(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c) {
+    if (c == 0)
+        return;
+
+    uint8_t low[16], high[16];
+    nibbleTables(c, low, high);
+    const __m256i tableLow = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) low));
+    const __m256i tableHigh = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) high));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i l = _mm256_and_si256(s, mask);
+        __m256i h = _mm256_and_si256(_mm256_srli_epi64(s, 4), mask);
+        __m256i product = _mm256_xor_si256(_mm256_shuffle_epi8(tableLow, l), _mm256_shuffle_epi8(tableHigh, h));
+        __m256i d = _mm256_loadu_si256((const __m256i *) (dst + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(d, product));
+    }
+    gf256MulAddRegion_software(dst + i, src + i, len - i, c);
+}
+#endif
+
+//! Name of the kernels the region functions dispatch to.
+const char *gf256_implementation() {
+#ifdef TSK_GF256_X86
+    if (__builtin_cpu_supports("avx2"))
+        return "avx2";
+    if (__builtin_cpu_supports("ssse3"))
+        return "ssse3";
+    return "sse2";
+#else
+    return "software";
+#endif
+}
+
+void xorRegion(uint8_t *dst, const uint8_t *src, size_t len) {
+    typedef void (*XorFunc)(uint8_t *, const uint8_t *, size_t);
+#ifdef TSK_GF256_X86
+    static const XorFunc impl = __builtin_cpu_supports("avx2") ? xorRegion_avx2 : xorRegion_sse2;
+#else
+    static const XorFunc impl = xorRegion_software;
+#endif
+
+    impl(dst, src, len);
+}
+
+void gf256MulAddRegion(uint8_t *dst, const uint8_t *src, size_t len, uint8_t c) {
+    typedef void (*MulAddFunc)(uint8_t *, const uint8_t *, size_t, uint8_t);
+#ifdef TSK_GF256_X86
+    static const MulAddFunc impl = __builtin_cpu_supports("avx2") ? gf256MulAddRegion_avx2 :
+                                   __builtin_cpu_supports("ssse3") ? gf256MulAddRegion_ssse3 :
+                                   gf256MulAddRegion_software;
+#else
+    static const MulAddFunc impl = gf256MulAddRegion_software;
+#endif
+
+    if (c == 1)
+        xorRegion(dst, src, len);
+    else
+        impl(dst, src, len, c);
+}
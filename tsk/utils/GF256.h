@@ -0,0 +1,39 @@
+/*
+ * GF256.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file GF256.h
+ * Arithmetic in GF(2^8) and region kernels for parity reconstruction
+ */
+
+#ifndef TSK_GF256_H
+#define TSK_GF256_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * The field uses the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d) with
+ * generator 2, as RAIDZ parity does.
+ */
+
+uint8_t gf256Mul(uint8_t a, uint8_t b);
+uint8_t gf256Inverse(uint8_t a);
+uint8_t gf256Pow2(uint64_t exponent);
+
+/*
+ * Region kernels: dst ^= src and dst ^= c * src over len bytes. They are
+ * dispatched once, on first use, to the widest vector unit the CPU has.
+ */
+void xorRegion(uint8_t* dst, const uint8_t* src, size_t len);
+void gf256MulAddRegion(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c);
+void xorRegion_software(uint8_t* dst, const uint8_t* src, size_t len);
+void gf256MulAddRegion_software(uint8_t* dst, const uint8_t* src, size_t len, uint8_t c);
+const char* gf256_implementation();
+
+#endif
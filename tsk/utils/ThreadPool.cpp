@@ -0,0 +1,122 @@
+/*
+ * ThreadPool.cpp
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file ThreadPool.cpp
+ * Fixed size worker pool used for parallel reads in the pool code
+ */
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+#ifdef TSK_MULTITHREAD_LIB
+
+ThreadPool::ThreadPool(size_t numThreads) : stopping(false) {
+    if (numThreads == 0)
+        numThreads = 1;
+    for (size_t i = 0; i < numThreads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(queueLock);
+        stopping = true;
+    }
+    queueSignal.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+}
+
+/**
+ * Queue a task. Exceptions thrown by the task are rethrown by the
+ * returned future.
+ */
+future<void> ThreadPool::submit(function<void()> task) {
+    packaged_task<void()> job(task);
+    future<void> result = job.get_future();
+    {
+        lock_guard<mutex> guard(queueLock);
+        tasks.push(move(job));
+    }
+    queueSignal.notify_one();
+    return result;
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        packaged_task<void()> job;
+        {
+            unique_lock<mutex> guard(queueLock);
+            queueSignal.wait(guard, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            job = move(tasks.front());
+            tasks.pop();
+        }
+        job();
+    }
+}
+
+/**
+ * Pool shared by callers that do not need dedicated workers,
+ * sized to the number of hardware threads.
+ */
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+#else
+
+ThreadPool::ThreadPool(size_t numThreads) {
+}
+
+ThreadPool::~ThreadPool() {
+}
+
+future<void> ThreadPool::submit(function<void()> task) {
+    packaged_task<void()> job(task);
+    future<void> result = job.get_future();
+    job();
+    return result;
+}
+
+size_t ThreadPool::size() const {
+    return 1;
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(1);
+    return pool;
+}
+
+#endif
+
+/**
+ * Wait for all futures, then rethrow the first exception raised by any of them.
+ */
+void ThreadPool::waitAll(vector<future<void>>& futures) {
+    exception_ptr error;
+    for (auto &result : futures) {
+        try {
+            result.get();
+        } catch (...) {
+            if (!error)
+                error = current_exception();
+        }
+    }
+    futures.clear();
+    if (error)
+        rethrow_exception(error);
+}
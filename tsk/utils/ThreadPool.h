@@ -0,0 +1,59 @@
+/*
+ * ThreadPool.h
+ * The Sleuth Kit
+ *
+ * This software is distributed under the Common Public License 1.0
+ *
+ */
+
+/**
+ * \file ThreadPool.h
+ * Fixed size worker pool used for parallel reads in the pool code
+ */
+
+#ifndef TSK_THREAD_POOL_H
+#define TSK_THREAD_POOL_H
+
+#include <tsk/libtsk.h>
+#include <functional>
+#include <future>
+#include <vector>
+
+#ifdef TSK_MULTITHREAD_LIB
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#endif
+
+/**
+ * Runs tasks on a fixed number of worker threads in submission order.
+ * Without multithreading support, tasks run inline in submit().
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t numThreads);
+    ~ThreadPool();
+
+    std::future<void> submit(std::function<void()> task);
+    size_t size() const;
+
+    static ThreadPool& shared();
+    static void waitAll(std::vector<std::future<void>>& futures);
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+#ifdef TSK_MULTITHREAD_LIB
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::packaged_task<void()>> tasks;
+    std::mutex queueLock;
+    std::condition_variable queueSignal;
+    bool stopping;
+#endif
+};
+
+#endif
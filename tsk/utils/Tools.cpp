@@ -12,8 +12,14 @@
  */
 
 #include "Tools.h"
+#include <cstring>
 #include <ctime>
 
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <nmmintrin.h>
+#define TSK_CRC32C_SSE42
+#endif
+
 using namespace std;
 
 const string timestampToDateString(uint64_t timestamp){
@@ -45,6 +51,93 @@ void fletcher_4_native(const uint8_t *buf, uint64_t size, uint64_t* output)
 
 }
 
+//! Slicing-by-8 lookup tables for the reflected CRC-32C (Castagnoli)
+//! polynomial 0x82F63B78. Table 0 is the classic byte-wise table, table k
+//! advances a byte through k further zero bytes.
+struct Crc32cTable {
+    uint32_t entries[8][256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            for (int j = 0; j < 8; j++)
+                crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+            entries[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++)
+                entries[k][i] = (entries[k - 1][i] >> 8) ^ entries[0][entries[k - 1][i] & 0xFF];
+        }
+    }
+};
+
+//! Portable CRC-32C, processes eight bytes per step with slicing-by-8.
+uint32_t crc32c_software(uint32_t crc, const uint8_t *buf, uint64_t size)
+{
+    static const Crc32cTable table;
+    const uint32_t (*t)[256] = table.entries;
+
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t lo = crc ^ (buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24));
+        uint32_t hi = buf[4] | (buf[5] << 8) | (buf[6] << 16) | ((uint32_t) buf[7] << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        buf += 8;
+        size -= 8;
+    }
+    while (size-- > 0)
+        crc = t[0][(crc ^ *buf++) & 0xFF] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+#ifdef TSK_CRC32C_SSE42
+//! CRC-32C with the SSE4.2 crc32 instruction, eight bytes per instruction.
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t *buf, uint64_t size)
+{
+    uint64_t crc64 = ~crc;
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, buf, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        buf += 8;
+        size -= 8;
+    }
+    uint32_t crc32 = (uint32_t) crc64;
+    while (size-- > 0)
+        crc32 = _mm_crc32_u8(crc32, *buf++);
+
+    return ~crc32;
+}
+#endif
+
+//! Return true if crc32c() uses the CPU's crc32 instruction.
+bool crc32c_hardware_available()
+{
+#ifdef TSK_CRC32C_SSE42
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+//! CRC-32C as used for BTRFS metadata and data checksums.
+//! Pass 0 as crc for a fresh checksum, or a previous result to continue it.
+//! The implementation is chosen once, on first use, from the CPU features.
+uint32_t crc32c(uint32_t crc, const uint8_t *buf, uint64_t size)
+{
+    typedef uint32_t (*Crc32cFunc)(uint32_t, const uint8_t *, uint64_t);
+#ifdef TSK_CRC32C_SSE42
+    static const Crc32cFunc impl = crc32c_hardware_available() ? crc32c_sse42 : crc32c_software;
+#else
+    static const Crc32cFunc impl = crc32c_software;
+#endif
+
+    return impl(crc, buf, size);
+}
+
 int roundUp(int numToRound, int multiple)
 {
     if (multiple == 0)
@@ -18,5 +18,8 @@
 
 const std::string timestampToDateString(uint64_t timestamp);
 void fletcher_4_native(const uint8_t* buf, uint64_t size, uint64_t* output);
+uint32_t crc32c(uint32_t crc, const uint8_t* buf, uint64_t size);
+uint32_t crc32c_software(uint32_t crc, const uint8_t* buf, uint64_t size);
+bool crc32c_hardware_available();
 
 #endif
\ No newline at end of file